@@ -0,0 +1,225 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace pinyin{
+
+/**
+ * MemoryArena:
+ *
+ * The bump allocator for the short lived scratch data,
+ * all allocations are released at once by MemoryArena::reset.
+ *
+ * Note: the blocks are kept after reset, and coalesced into one block,
+ *   so the allocations are malloc free in the steady state.
+ *
+ */
+
+class MemoryArena{
+private:
+    /* Disallow used outside. */
+    MemoryArena(const MemoryArena & arena);
+    MemoryArena & operator = (const MemoryArena & arena);
+
+private:
+    /* the header of the block, the data follows it. */
+    struct block_t{
+        block_t * m_prev;
+        size_t m_capacity;
+    };
+
+    static const size_t alignment = 2 * sizeof(void *);
+
+    static size_t align(size_t size){
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    static char * block_begin(block_t * block){
+        return (char *) block + align(sizeof(block_t));
+    }
+
+    /* the current block is the last one. */
+    block_t * m_block;
+    char * m_cur;
+    char * m_end;
+
+    /* the total capacity of all blocks. */
+    size_t m_capacity;
+    /* the used bytes in the previous blocks. */
+    size_t m_used;
+
+    void add_block(size_t capacity){
+        block_t * block = (block_t *)
+            malloc(align(sizeof(block_t)) + capacity);
+        assert(NULL != block);
+
+        block->m_prev = m_block;
+        block->m_capacity = capacity;
+
+        if (m_block)
+            m_used += m_cur - block_begin(m_block);
+
+        m_block = block;
+        m_cur = block_begin(block);
+        m_end = m_cur + capacity;
+        m_capacity += capacity;
+    }
+
+    void free_blocks(){
+        while (m_block) {
+            block_t * prev = m_block->m_prev;
+            free(m_block);
+            m_block = prev;
+        }
+
+        m_cur = m_end = NULL;
+        m_capacity = m_used = 0;
+    }
+
+public:
+    /**
+     * MemoryArena::MemoryArena:
+     * @capacity: the capacity of the first block.
+     *
+     * The constructor of the MemoryArena.
+     *
+     */
+    MemoryArena(size_t capacity = 4096){
+        m_block = NULL;
+        m_cur = m_end = NULL;
+        m_capacity = m_used = 0;
+
+        add_block(align(capacity));
+    }
+
+    /**
+     * MemoryArena::~MemoryArena:
+     *
+     * The destructor of the MemoryArena.
+     *
+     */
+    ~MemoryArena(){
+        free_blocks();
+    }
+
+    /**
+     * MemoryArena::allocate:
+     * @size: the size of the memory.
+     * @returns: the aligned memory, valid until the next reset.
+     *
+     * Allocate the memory from the arena.
+     *
+     */
+    void * allocate(size_t size){
+        size = align(size);
+
+        if (m_cur + size > m_end) {
+            /* double the total capacity. */
+            size_t capacity = m_capacity;
+            if (capacity < size)
+                capacity = size;
+            add_block(capacity);
+        }
+
+        void * data = m_cur;
+        m_cur += size;
+        return data;
+    }
+
+    /**
+     * MemoryArena::allocate_array:
+     * @num: the number of the elements.
+     * @returns: the uninitialized array, valid until the next reset.
+     *
+     * Allocate the array of the plain old data from the arena.
+     *
+     */
+    template<typename T>
+    T * allocate_array(size_t num){
+        return (T *) allocate(num * sizeof(T));
+    }
+
+    /**
+     * MemoryArena::allocate_array0:
+     * @num: the number of the elements.
+     * @returns: the zeroed array, valid until the next reset.
+     *
+     * Allocate the zeroed array of the plain old data from the arena.
+     *
+     */
+    template<typename T>
+    T * allocate_array0(size_t num){
+        T * data = allocate_array<T>(num);
+        memset(data, 0, num * sizeof(T));
+        return data;
+    }
+
+    /**
+     * MemoryArena::reset:
+     *
+     * Release all allocations, and keep the memory for the next use.
+     *
+     */
+    void reset(){
+        if (NULL != m_block->m_prev) {
+            /* coalesce the blocks into one block. */
+            size_t capacity = m_capacity;
+            free_blocks();
+            add_block(capacity);
+            return;
+        }
+
+        m_cur = block_begin(m_block);
+        m_used = 0;
+    }
+
+    /**
+     * MemoryArena::size:
+     * @returns: the allocated bytes since the last reset.
+     *
+     * Get the allocated bytes since the last reset.
+     *
+     */
+    size_t size() const {
+        return m_used + (m_cur - block_begin(m_block));
+    }
+
+    /**
+     * MemoryArena::capacity:
+     * @returns: the total capacity of the blocks.
+     *
+     * Get the total capacity of the blocks.
+     *
+     */
+    size_t capacity() const {
+        return m_capacity;
+    }
+};
+
+};
+
+#endif
@@ -432,6 +432,30 @@ public:
         close(fd);
         return true;
     }
+
+    /**
+     * MemoryChunk::append:
+     * @filename: append this MemoryChunk to the filename.
+     * @returns: whether the append is successful.
+     *
+     * Append the content to the end of the filename.
+     *
+     */
+    bool append(const char * filename){
+        int fd = open(filename, O_CREAT|O_WRONLY|O_APPEND, 0644);
+        if ( -1 == fd )
+            return false;
+
+        size_t data_len = write(fd, begin(), size());
+        if ( data_len != size()){
+            close(fd);
+            return false;
+        }
+
+        fsync(fd);
+        close(fd);
+        return true;
+    }
 };
 
 };
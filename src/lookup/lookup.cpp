@@ -25,6 +25,91 @@
 
 namespace pinyin{
 
+FlatStepIndex::FlatStepIndex(){
+    m_slots = NULL;
+    m_capacity = 0;
+    m_shift = 32;
+    m_size = 0;
+    m_stamp = 1;
+}
+
+FlatStepIndex::~FlatStepIndex(){
+    free(m_slots);
+    m_slots = NULL;
+    m_capacity = 0;
+    m_size = 0;
+}
+
+void FlatStepIndex::clear(){
+    m_size = 0;
+    ++m_stamp;
+
+    /* the stamp wraps around, reset all slots. */
+    if (0 == m_stamp) {
+        if (m_slots)
+            memset(m_slots, 0, sizeof(slot_t) * m_capacity);
+        m_stamp = 1;
+    }
+}
+
+void FlatStepIndex::resize(guint32 capacity){
+    assert(0 == (capacity & (capacity - 1)));
+
+    slot_t * old_slots = m_slots;
+    const guint32 old_capacity = m_capacity;
+
+    /* zero stamp is never used, so all new slots are empty. */
+    m_slots = (slot_t *) calloc(capacity, sizeof(slot_t));
+    assert(m_slots);
+    m_capacity = capacity;
+    m_shift = 32;
+    for (guint32 i = capacity; i > 1; i >>= 1)
+        --m_shift;
+    m_size = 0;
+
+    const guint32 stamp = m_stamp;
+    for (guint32 i = 0; i < old_capacity; ++i) {
+        const slot_t * slot = old_slots + i;
+        if (stamp == slot->m_stamp)
+            insert(slot->m_key, slot->m_value);
+    }
+
+    free(old_slots);
+}
+
+FlatStepContent::FlatStepContent(){
+    m_prev_tokens = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    m_tokens = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    m_lengths = g_array_new(FALSE, FALSE, sizeof(gint32));
+    m_poss = g_array_new(FALSE, FALSE, sizeof(gfloat));
+    m_last_steps = g_array_new(FALSE, FALSE, sizeof(gint32));
+}
+
+FlatStepContent::~FlatStepContent(){
+    g_array_free(m_prev_tokens, TRUE);
+    g_array_free(m_tokens, TRUE);
+    g_array_free(m_lengths, TRUE);
+    g_array_free(m_poss, TRUE);
+    g_array_free(m_last_steps, TRUE);
+}
+
+void FlatStepContent::clear(){
+    g_array_set_size(m_prev_tokens, 0);
+    g_array_set_size(m_tokens, 0);
+    g_array_set_size(m_lengths, 0);
+    g_array_set_size(m_poss, 0);
+    g_array_set_size(m_last_steps, 0);
+}
+
+guint32 FlatStepContent::append(const lookup_value_t & value){
+    g_array_append_val(m_prev_tokens, value.m_handles[0]);
+    g_array_append_val(m_tokens, value.m_handles[1]);
+    g_array_append_val(m_lengths, value.m_length);
+    g_array_append_val(m_poss, value.m_poss);
+    g_array_append_val(m_last_steps, value.m_last_step);
+    return m_poss->len - 1;
+}
+
 bool convert_to_utf8(FacadePhraseIndex * phrase_index,
                      MatchResults match_results,
                      /* in */ const char * delimiter,
@@ -29,6 +29,7 @@
 
 #include "novel_types.h"
 #include <limits.h>
+#include <assert.h>
 
 namespace pinyin{
 
@@ -73,6 +74,280 @@ typedef GHashTable * LookupStepIndex;
 /* Key: lookup_key_t, Value: int m, index to m_steps_content[i][m] */
 typedef GArray * LookupStepContent; /* array of lookup_value_t */
 
+
+/**
+ * FlatStepIndex:
+ *
+ * The open addressing hash table from lookup_key_t to the index of
+ * lookup step content, used in place of LookupStepIndex.
+ *
+ * The slots are kept across the clear calls, and only the slots with
+ * the current stamp are valid, so clear is O(1) instead of reallocation.
+ *
+ */
+class FlatStepIndex{
+private:
+    struct slot_t{
+        lookup_key_t m_key;
+        guint32 m_stamp;
+        guint32 m_value;
+    };
+
+    slot_t * m_slots;
+    /* the capacity is always the power of two. */
+    guint32 m_capacity;
+    /* the capacity is 1 << (32 - m_shift). */
+    guint32 m_shift;
+    guint32 m_size;
+    guint32 m_stamp;
+
+    /* Disallow used outside. */
+    FlatStepIndex(const FlatStepIndex & index);
+    FlatStepIndex & operator = (const FlatStepIndex & index);
+
+    guint32 hash(lookup_key_t key) const {
+        /* Fibonacci hashing, keep the high bits of the product,
+           as the tokens differ in the library bits. */
+        return (key * 2654435761U) >> m_shift;
+    }
+
+    const slot_t * find_slot(lookup_key_t key) const {
+        const guint32 mask = m_capacity - 1;
+        guint32 pos = hash(key);
+
+        while (true) {
+            const slot_t * slot = m_slots + pos;
+            if (m_stamp != slot->m_stamp || key == slot->m_key)
+                return slot;
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    void resize(guint32 capacity);
+
+public:
+    /**
+     * FlatStepIndex::FlatStepIndex:
+     *
+     * The constructor of the FlatStepIndex.
+     *
+     */
+    FlatStepIndex();
+
+    /**
+     * FlatStepIndex::~FlatStepIndex:
+     *
+     * The destructor of the FlatStepIndex.
+     *
+     */
+    ~FlatStepIndex();
+
+    /**
+     * FlatStepIndex::size:
+     * @returns: the number of keys in this index.
+     *
+     * Get the number of keys in this index.
+     *
+     */
+    guint32 size() const {
+        return m_size;
+    }
+
+    /**
+     * FlatStepIndex::clear:
+     *
+     * Remove all keys, but keep the allocated slots.
+     *
+     */
+    void clear();
+
+    /**
+     * FlatStepIndex::lookup:
+     * @key: the lookup key.
+     * @value: the index to the lookup step content.
+     * @returns: whether the key exists.
+     *
+     * Lookup the index of the key in the lookup step content.
+     *
+     */
+    bool lookup(/* in */ lookup_key_t key, /* out */ guint32 & value) const {
+        if (0 == m_size)
+            return false;
+
+        const slot_t * slot = find_slot(key);
+        if (m_stamp != slot->m_stamp)
+            return false;
+
+        value = slot->m_value;
+        return true;
+    }
+
+    /**
+     * FlatStepIndex::insert:
+     * @key: the lookup key.
+     * @value: the index to the lookup step content.
+     *
+     * Insert or replace the index of the key.
+     *
+     */
+    void insert(/* in */ lookup_key_t key, /* in */ guint32 value) {
+        /* keep the load factor under 3/4. */
+        if ((m_size + 1) * 4 > m_capacity * 3)
+            resize(m_capacity ? m_capacity * 2 : 64);
+
+        slot_t * slot = (slot_t *) find_slot(key);
+        if (m_stamp != slot->m_stamp) {
+            slot->m_key = key;
+            slot->m_stamp = m_stamp;
+            ++m_size;
+        }
+        slot->m_value = value;
+    }
+};
+
+/**
+ * FlatStepContent:
+ *
+ * The structure of arrays of the lookup values in one step,
+ * used in place of LookupStepContent.
+ *
+ * The possibilities are stored continuously, so the beam pruning
+ * only scans one array of gfloat.
+ *
+ */
+class FlatStepContent{
+private:
+    /* m_handles[0] of lookup_value_t */
+    GArray * m_prev_tokens;
+    /* m_handles[1] of lookup_value_t */
+    GArray * m_tokens;
+    GArray * m_lengths;
+    GArray * m_poss;
+    GArray * m_last_steps;
+
+    /* Disallow used outside. */
+    FlatStepContent(const FlatStepContent & content);
+    FlatStepContent & operator = (const FlatStepContent & content);
+
+public:
+    /**
+     * FlatStepContent::FlatStepContent:
+     *
+     * The constructor of the FlatStepContent.
+     *
+     */
+    FlatStepContent();
+
+    /**
+     * FlatStepContent::~FlatStepContent:
+     *
+     * The destructor of the FlatStepContent.
+     *
+     */
+    ~FlatStepContent();
+
+    /**
+     * FlatStepContent::size:
+     * @returns: the number of the lookup values.
+     *
+     * Get the number of the lookup values.
+     *
+     */
+    guint32 size() const {
+        return m_poss->len;
+    }
+
+    /**
+     * FlatStepContent::clear:
+     *
+     * Remove all lookup values, but keep the allocated arrays.
+     *
+     */
+    void clear();
+
+    /**
+     * FlatStepContent::append:
+     * @value: the lookup value.
+     * @returns: the index of the appended lookup value.
+     *
+     * Append one lookup value.
+     *
+     */
+    guint32 append(/* in */ const lookup_value_t & value);
+
+    /**
+     * FlatStepContent::get_value:
+     * @index: the index of the lookup value.
+     * @value: the lookup value.
+     *
+     * Get the lookup value at the index.
+     *
+     */
+    void get_value(/* in */ guint32 index,
+                   /* out */ lookup_value_t & value) const {
+        assert(index < size());
+        value.m_handles[0] = g_array_index(m_prev_tokens, phrase_token_t, index);
+        value.m_handles[1] = g_array_index(m_tokens, phrase_token_t, index);
+        value.m_length = g_array_index(m_lengths, gint32, index);
+        value.m_poss = g_array_index(m_poss, gfloat, index);
+        value.m_last_step = g_array_index(m_last_steps, gint32, index);
+    }
+
+    /**
+     * FlatStepContent::set_value:
+     * @index: the index of the lookup value.
+     * @value: the lookup value.
+     *
+     * Replace the lookup value at the index.
+     *
+     */
+    void set_value(/* in */ guint32 index,
+                   /* in */ const lookup_value_t & value) {
+        assert(index < size());
+        g_array_index(m_prev_tokens, phrase_token_t, index) = value.m_handles[0];
+        g_array_index(m_tokens, phrase_token_t, index) = value.m_handles[1];
+        g_array_index(m_lengths, gint32, index) = value.m_length;
+        g_array_index(m_poss, gfloat, index) = value.m_poss;
+        g_array_index(m_last_steps, gint32, index) = value.m_last_step;
+    }
+
+    /**
+     * FlatStepContent::get_token:
+     * @index: the index of the lookup value.
+     * @returns: the current token of the lookup value.
+     *
+     * Get the current token of the lookup value.
+     *
+     */
+    phrase_token_t get_token(/* in */ guint32 index) const {
+        return g_array_index(m_tokens, phrase_token_t, index);
+    }
+
+    /**
+     * FlatStepContent::get_length:
+     * @index: the index of the lookup value.
+     * @returns: the sentence length of the lookup value.
+     *
+     * Get the sentence length of the lookup value.
+     *
+     */
+    gint32 get_length(/* in */ guint32 index) const {
+        return g_array_index(m_lengths, gint32, index);
+    }
+
+    /**
+     * FlatStepContent::get_all_poss:
+     * @returns: the possibilities of all lookup values.
+     *
+     * Get the possibilities of all lookup values, valid until
+     * the next append or clear call.
+     *
+     */
+    const gfloat * get_all_poss() const {
+        return (const gfloat *) m_poss->data;
+    }
+};
+
 bool convert_to_utf8(FacadePhraseIndex * phrase_index,
                      MatchResults match_results,
                      /* in */ const char * delimiter,
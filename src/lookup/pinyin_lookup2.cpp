@@ -32,7 +32,9 @@ using namespace pinyin;
 */
 
 /* internal definition */
-static const size_t nbeam = 32;
+static const size_t default_beam_width = 32;
+/* the beam width never shrinks below it on the long inputs. */
+static const size_t minimum_beam_width = 4;
 
 bool dump_max_value(GPtrArray * values){
     if (0 == values->len)
@@ -70,59 +72,57 @@ bool dump_all_values(GPtrArray * values) {
     return true;
 }
 
-/* populate the candidates. */
-static bool populate_candidates(/* out */ GPtrArray * candidates,
-                                /* in */ LookupStepContent step) {
-    g_ptr_array_set_size(candidates, 0);
-
-    if (0 == step->len)
-        return false;
-
-    for (size_t i = 0; i < step->len; ++i) {
-        lookup_value_t * value = &g_array_index
-            (step, lookup_value_t, i);
-
-        g_ptr_array_add(candidates, value);
-    }
-
-    /* dump_max_value(candidates); */
-
-    return true;
+static bool poss_greater_than(gfloat lhs, gfloat rhs){
+    return lhs > rhs;
 }
 
-static bool lookup_value_less_than(lookup_value_t * lhs, lookup_value_t * rhs){
-    return lhs->m_poss < rhs->m_poss;
-}
-
-/* use maximum heap to get the topest results. */
-static bool get_top_results(/* out */ GPtrArray * topresults,
-                            /* in */ GPtrArray * candidates) {
-    g_ptr_array_set_size(topresults, 0);
-
-    if (0 == candidates->len)
-        return false;
-
-    lookup_value_t ** begin =
-        (lookup_value_t **) &g_ptr_array_index(candidates, 0);
-    lookup_value_t ** end =
-        (lookup_value_t **) &g_ptr_array_index(candidates, candidates->len);
-
-    std_lite::make_heap(begin, end, lookup_value_less_than);
-
-    while (end != begin) {
-        lookup_value_t * one = *begin;
-        g_ptr_array_add(topresults, one);
-
-        std_lite::pop_heap(begin, end, lookup_value_less_than);
-        --end;
-
-        if (topresults->len >= nbeam)
-            break;
+/* select the indices of the topest results in the descending order,
+   returns the number of the top results.
+   the scratch holds at least the size of the step. */
+static size_t get_top_results(/* out */ guint32 * topresults,
+                              /* in */ const FlatStepContent * step,
+                              /* in */ size_t nbeam,
+                              /* in */ gfloat * scratch) {
+    const size_t len = step->size();
+    const gfloat * poss = step->get_all_poss();
+
+    size_t ntop = 0;
+    if (len <= nbeam) {
+        for (size_t i = 0; i < len; ++i)
+            topresults[ntop++] = i;
+    } else {
+        /* find the nbeam-th largest possibility as the threshold. */
+        memcpy(scratch, poss, len * sizeof(gfloat));
+        std_lite::nth_element(scratch, scratch + nbeam - 1, scratch + len,
+                              poss_greater_than);
+        const gfloat threshold = scratch[nbeam - 1];
+
+        size_t nabove = 0;
+        for (size_t i = 0; i < len; ++i)
+            nabove += poss[i] > threshold;
+
+        /* the ties at the threshold fill the rest of the beam. */
+        size_t nequal = nbeam - nabove;
+        for (size_t i = 0; i < len; ++i) {
+            if (poss[i] > threshold) {
+                topresults[ntop++] = i;
+            } else if (nequal && poss[i] == threshold) {
+                topresults[ntop++] = i;
+                --nequal;
+            }
+        }
     }
 
-    /* dump_all_values(topresults); */
+    /* insertion sort of the few top results. */
+    for (size_t i = 1; i < ntop; ++i) {
+        const guint32 index = topresults[i];
+        size_t k = i;
+        for (; k > 0 && poss[topresults[k - 1]] < poss[index]; --k)
+            topresults[k] = topresults[k - 1];
+        topresults[k] = index;
+    }
 
-    return true;
+    return ntop;
 }
 
 static bool populate_prefixes(GPtrArray * steps_index,
@@ -136,52 +136,104 @@ static bool populate_prefixes(GPtrArray * steps_index,
         lookup_value_t initial_value(log(1.f));
         initial_value.m_handles[1] = token;
 
-        LookupStepContent initial_step_content = (LookupStepContent)
+        FlatStepContent * initial_step_content = (FlatStepContent *)
             g_ptr_array_index(steps_content, 0);
-        initial_step_content = g_array_append_val
-            (initial_step_content, initial_value);
+        guint32 initial_index = initial_step_content->append(initial_value);
 
-        LookupStepIndex initial_step_index = (LookupStepIndex)
+        FlatStepIndex * initial_step_index = (FlatStepIndex *)
             g_ptr_array_index(steps_index, 0);
-        g_hash_table_insert(initial_step_index,
-                            GUINT_TO_POINTER(initial_key),
-                            GUINT_TO_POINTER(initial_step_content->len - 1));
+        initial_step_index->insert(initial_key, initial_index);
     }
 
     return true;
 }
 
+static void clear_steps(GPtrArray * steps_index, GPtrArray * steps_content){
+    /* clear steps_index */
+    for ( size_t i = 0; i < steps_index->len; ++i){
+        FlatStepIndex * index = (FlatStepIndex *)
+            g_ptr_array_index(steps_index, i);
+        delete index;
+        g_ptr_array_index(steps_index, i) = NULL;
+    }
+    g_ptr_array_set_size(steps_index, 0);
+
+    /* clear steps_content */
+    for ( size_t i = 0; i < steps_content->len; ++i){
+        FlatStepContent * content = (FlatStepContent *)
+            g_ptr_array_index(steps_content, i);
+        delete content;
+        g_ptr_array_index(steps_content, i) = NULL;
+    }
+    g_ptr_array_set_size(steps_content, 0);
+}
+
+/* reuse the steps allocated by the previous calls,
+   and keep the first nvalid steps. */
 static bool init_steps(GPtrArray * steps_index,
                        GPtrArray * steps_content,
-                       int nstep){
+                       int nstep, int nvalid){
+    assert(steps_index->len == steps_content->len);
+    assert(nvalid <= nstep);
+
+    /* release the extra steps */
+    for (size_t i = nstep; i < steps_index->len; ++i) {
+        delete (FlatStepIndex *) g_ptr_array_index(steps_index, i);
+        delete (FlatStepContent *) g_ptr_array_index(steps_content, i);
+    }
+
+    const size_t oldlen = std_lite::min(steps_index->len, (guint) nstep);
     /* add null start step */
     g_ptr_array_set_size(steps_index, nstep);
     g_ptr_array_set_size(steps_content, nstep);
 
-    for (int i = 0; i < nstep; ++i) {
+    for (size_t i = nvalid; i < oldlen; ++i) {
+        /* reset steps_index */
+        ((FlatStepIndex *) g_ptr_array_index(steps_index, i))->clear();
+        /* reset steps_content */
+        ((FlatStepContent *) g_ptr_array_index(steps_content, i))->clear();
+    }
+
+    for (size_t i = oldlen; i < (size_t) nstep; ++i) {
         /* initialize steps_index */
-        g_ptr_array_index(steps_index, i) = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_ptr_array_index(steps_index, i) = new FlatStepIndex;
         /* initialize steps_content */
-        g_ptr_array_index(steps_content, i) = g_array_new(FALSE, FALSE, sizeof(lookup_value_t));
+        g_ptr_array_index(steps_content, i) = new FlatStepContent;
     }
 
     return true;
 }
 
-static void clear_steps(GPtrArray * steps_index, GPtrArray * steps_content){
-    /* clear steps_index */
-    for ( size_t i = 0; i < steps_index->len; ++i){
-        GHashTable * table = (GHashTable *) g_ptr_array_index(steps_index, i);
-        g_hash_table_destroy(table);
-        g_ptr_array_index(steps_index, i) = NULL;
+/* same as init_steps, for the alternative transitions. */
+static bool init_alternatives(GPtrArray * steps_alternatives,
+                              int nstep, int nvalid){
+    for (size_t i = nstep; i < steps_alternatives->len; ++i) {
+        g_array_free((GArray *)
+                     g_ptr_array_index(steps_alternatives, i), TRUE);
     }
 
-    /* clear steps_content */
-    for ( size_t i = 0; i < steps_content->len; ++i){
-        GArray * array = (GArray *) g_ptr_array_index(steps_content, i);
-        g_array_free(array, TRUE);
-        g_ptr_array_index(steps_content, i) = NULL;
+    const size_t oldlen = std_lite::min
+        (steps_alternatives->len, (guint) nstep);
+    g_ptr_array_set_size(steps_alternatives, nstep);
+
+    for (size_t i = nvalid; i < oldlen; ++i) {
+        g_array_set_size((GArray *)
+                         g_ptr_array_index(steps_alternatives, i), 0);
     }
+
+    for (size_t i = oldlen; i < (size_t) nstep; ++i) {
+        g_ptr_array_index(steps_alternatives, i) =
+            g_array_new(FALSE, FALSE, sizeof(lookup_value_t));
+    }
+
+    return true;
+}
+
+/* the same order as final_step. */
+static inline bool lookup_value_better(const lookup_value_t * lhs,
+                                       const lookup_value_t * rhs){
+    return lhs->m_length < rhs->m_length ||
+        (lhs->m_length == rhs->m_length && lhs->m_poss > rhs->m_poss);
 }
 
 
@@ -189,7 +241,8 @@ PinyinLookup2::PinyinLookup2(const gfloat lambda,
                              FacadeChewingTable2 * pinyin_table,
                              FacadePhraseIndex * phrase_index,
                              Bigram * system_bigram,
-                             Bigram * user_bigram)
+                             Bigram * user_bigram,
+                             SingleGramCache * single_gram_cache)
     : bigram_lambda(lambda),
       unigram_lambda(1. - lambda)
 {
@@ -197,126 +250,359 @@ PinyinLookup2::PinyinLookup2(const gfloat lambda,
     m_phrase_index = phrase_index;
     m_system_bigram = system_bigram;
     m_user_bigram = user_bigram;
+    m_single_gram_cache = single_gram_cache;
 
     m_steps_index = g_ptr_array_new();
     m_steps_content = g_ptr_array_new();
+    m_steps_stop = g_array_new(FALSE, FALSE, sizeof(gint32));
+
+    m_nbest = 1;
+    m_steps_alternatives = g_ptr_array_new();
+
+    m_last_prefixes = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    m_last_constraints = g_array_new
+        (TRUE, FALSE, sizeof(lookup_constraint_t));
+    m_last_nbest = 0;
+    m_last_beam_width = 0;
+
+    memset(m_ranges, 0, sizeof(PhraseIndexRanges));
+    m_bigram_phrase_items = g_array_new
+        (FALSE, FALSE, sizeof(BigramPhraseItem));
 
     m_cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
 
+    m_beam_width = default_beam_width;
+    m_beam_margin = 0.;
+    m_long_input_length = 0;
+    memset(&m_beam_statistics, 0, sizeof(beam_statistics_t));
+
     /* the member variables below are saved in get_best_match call. */
     m_matrix = NULL;
     m_constraints = NULL;
+    m_search_cache = NULL;
 }
 
 PinyinLookup2::~PinyinLookup2(){
     clear_steps(m_steps_index, m_steps_content);
     g_ptr_array_free(m_steps_index, TRUE);
     g_ptr_array_free(m_steps_content, TRUE);
+    g_array_free(m_steps_stop, TRUE);
+
+    init_alternatives(m_steps_alternatives, 0, 0);
+    g_ptr_array_free(m_steps_alternatives, TRUE);
+    g_array_free(m_last_prefixes, TRUE);
+    g_array_free(m_last_constraints, TRUE);
     g_array_free(m_cached_keys, TRUE);
+
+    m_phrase_index->destroy_ranges(m_ranges);
+    g_array_free(m_bigram_phrase_items, TRUE);
+}
+
+static bool equal_constraint(const lookup_constraint_t * lhs,
+                             const lookup_constraint_t * rhs) {
+    if (lhs->m_type != rhs->m_type)
+        return false;
+
+    switch (lhs->m_type) {
+    case NO_CONSTRAINT:
+        return true;
+    case CONSTRAINT_ONESTEP:
+        return lhs->m_token == rhs->m_token && lhs->m_end == rhs->m_end;
+    case CONSTRAINT_NOSEARCH:
+        return lhs->m_constraint_step == rhs->m_constraint_step;
+    }
+
+    assert(FALSE);
+    return false;
+}
+
+/* Note:
+ *   the transitions into step m only depend on the matrix columns
+ *   and the constraints before or at m, so the steps before
+ *   the first changed column or constraint are still valid.
+ */
+size_t PinyinLookup2::compute_valid_steps(TokenVector prefixes,
+                                          size_t beam_width) {
+    /* the saved alternative transitions depend on m_nbest. */
+    if (m_last_nbest != m_nbest)
+        return 0;
+
+    /* the saved steps are pruned with the beam width,
+       which shrinks on the long inputs. */
+    if (m_last_beam_width != beam_width)
+        return 0;
+
+    if (m_last_prefixes->len != prefixes->len)
+        return 0;
+
+    if (0 != memcmp(m_last_prefixes->data, prefixes->data,
+                    prefixes->len * sizeof(phrase_token_t)))
+        return 0;
+
+    if (0 == m_steps_content->len)
+        return 0;
+
+    size_t nvalid = m_matrix->get_common_prefix_size(&m_last_matrix);
+    /* the search from the last step is never done. */
+    nvalid = std_lite::min(nvalid, (size_t) m_steps_content->len - 1);
+
+    const size_t length = std_lite::min
+        ((size_t) m_constraints->len, (size_t) m_last_constraints->len);
+    nvalid = std_lite::min(nvalid, length);
+
+    for (size_t i = 0; i < nvalid; ++i) {
+        const lookup_constraint_t * constraint = &g_array_index
+            (m_constraints, lookup_constraint_t, i);
+        const lookup_constraint_t * last_constraint = &g_array_index
+            (m_last_constraints, lookup_constraint_t, i);
+
+        if (!equal_constraint(constraint, last_constraint))
+            return i;
+    }
+
+    return nvalid;
+}
+
+bool PinyinLookup2::save_last_inputs(TokenVector prefixes,
+                                     size_t beam_width) {
+    g_array_set_size(m_last_prefixes, 0);
+    g_array_append_vals(m_last_prefixes, prefixes->data, prefixes->len);
+
+    g_array_set_size(m_last_constraints, 0);
+    g_array_append_vals(m_last_constraints, m_constraints->data,
+                        m_constraints->len);
+
+    m_last_nbest = m_nbest;
+    m_last_beam_width = beam_width;
+
+    return m_last_matrix.copy(m_matrix);
+}
+
+bool PinyinLookup2::set_beam_options(size_t beam_width,
+                                     gfloat beam_margin,
+                                     size_t long_input_length) {
+    if (beam_margin < 0.)
+        return false;
+
+    if (0 == beam_width)
+        beam_width = default_beam_width;
+
+    m_beam_width = beam_width;
+    m_beam_margin = beam_margin;
+    m_long_input_length = long_input_length;
+
+    /* the saved steps are searched with the old beam. */
+    return invalidate_steps();
+}
+
+/* shrink the beam on the long inputs, to bound the latency. */
+size_t PinyinLookup2::compute_beam_width(size_t nstep) const {
+    if (0 == m_long_input_length || nstep <= m_long_input_length)
+        return m_beam_width;
+
+    size_t beam_width = m_beam_width * m_long_input_length / nstep;
+    beam_width = std_lite::max(beam_width, minimum_beam_width);
+    return std_lite::min(beam_width, m_beam_width);
+}
+
+/* select the top results, then drop the ones far below the best. */
+size_t PinyinLookup2::prune_top_results(FlatStepContent * step,
+                                        guint32 * topresults,
+                                        size_t beam_width,
+                                        gfloat * scratch) {
+    size_t ntop = get_top_results(topresults, step, beam_width, scratch);
+    m_beam_statistics.m_width_pruned += step->size() - ntop;
+
+    if (ntop > 0 && m_beam_margin > 0.) {
+        const gfloat * poss = step->get_all_poss();
+        const gfloat threshold = poss[topresults[0]] - m_beam_margin;
+
+        size_t nkept = ntop;
+        while (nkept > 1 && poss[topresults[nkept - 1]] < threshold)
+            --nkept;
+
+        m_beam_statistics.m_margin_pruned += ntop - nkept;
+        ntop = nkept;
+    }
+
+    m_beam_statistics.m_expanded += ntop;
+    return ntop;
+}
+
+bool PinyinLookup2::invalidate_steps() {
+    /* the beam width is never zero in the search,
+       keep the last matrix columns for the next copy. */
+    m_last_beam_width = 0;
+    g_array_set_size(m_last_prefixes, 0);
+    g_array_set_size(m_last_constraints, 0);
+    return true;
 }
 
 
 bool PinyinLookup2::get_best_match(TokenVector prefixes,
                                    PhoneticKeyMatrix * matrix,
                                    CandidateConstraints constraints,
-                                   MatchResults & results){
+                                   MatchResults & results,
+                                   PhoneticSearchCache * search_cache){
     m_constraints = constraints;
     m_matrix = matrix;
+    m_search_cache = search_cache;
+    m_nbest = 1;
+
+    if (!search_steps(prefixes))
+        return false;
+
+    return final_step(results);
+}
 
+bool PinyinLookup2::get_nbest_match(size_t nbest,
+                                    TokenVector prefixes,
+                                    PhoneticKeyMatrix * matrix,
+                                    CandidateConstraints constraints,
+                                    GPtrArray * results,
+                                    PhoneticSearchCache * search_cache){
+    assert(nbest > 0);
+
+    m_constraints = constraints;
+    m_matrix = matrix;
+    m_search_cache = search_cache;
+    m_nbest = nbest;
+
+    if (!search_steps(prefixes))
+        return false;
+
+    return final_nbest_steps(nbest, results);
+}
+
+bool PinyinLookup2::search_steps(TokenVector prefixes){
     int nstep = m_matrix->size();
     if (0 == nstep)
         return false;
 
-    clear_steps(m_steps_index, m_steps_content);
+    const size_t beam_width = compute_beam_width(nstep);
 
-    init_steps(m_steps_index, m_steps_content, nstep);
+    /* the steps before nvalid are kept from the previous call. */
+    const int nvalid = compute_valid_steps(prefixes, beam_width);
 
-    populate_prefixes(m_steps_index, m_steps_content, prefixes);
+    init_steps(m_steps_index, m_steps_content, nstep, nvalid);
+    init_alternatives(m_steps_alternatives, nstep, nvalid);
+    g_array_set_size(m_steps_stop, nstep);
 
-    PhraseIndexRanges ranges;
-    memset(ranges, 0, sizeof(PhraseIndexRanges));
-    m_phrase_index->prepare_ranges(ranges);
+    /* the phrase items may be changed after the last search. */
+    m_span_cache.reset(m_matrix);
 
-    GPtrArray * candidates = g_ptr_array_new();
-    GPtrArray * topresults = g_ptr_array_new();
+    if (0 == nvalid)
+        populate_prefixes(m_steps_index, m_steps_content, prefixes);
+
+    save_last_inputs(prefixes, beam_width);
+
+    /* release the scratch data of the previous search. */
+    m_arena.reset();
+
+    /* the sub phrase indices may be loaded or unloaded. */
+    PhraseIndexRanges & ranges = m_ranges;
+    m_phrase_index->update_ranges(ranges);
+
+    guint32 * topresults = m_arena.allocate_array<guint32>(beam_width);
 
     /* begin the viterbi beam search. */
     for ( int i = 0; i < nstep - 1; ++i ){
         lookup_constraint_t * cur_constraint = &g_array_index
             (m_constraints, lookup_constraint_t, i);
+        gint32 & stop = g_array_index(m_steps_stop, gint32, i);
 
         if (CONSTRAINT_NOSEARCH == cur_constraint->m_type)
             continue;
 
-        LookupStepContent step = (LookupStepContent)
+        /* the search from the valid step stopped before changes. */
+        if (i < nvalid && stop < nvalid)
+            continue;
+
+        FlatStepContent * step = (FlatStepContent *)
             g_ptr_array_index(m_steps_content, i);
 
-        populate_candidates(candidates, step);
-        get_top_results(topresults, candidates);
+        gfloat * scratch = NULL;
+        if (step->size() > beam_width)
+            scratch = m_arena.allocate_array<gfloat>(step->size());
+        const size_t ntop = prune_top_results
+            (step, topresults, beam_width, scratch);
 
-        if (0 == topresults->len)
+        if (0 == ntop) {
+            stop = i;
             continue;
+        }
 
         if (CONSTRAINT_ONESTEP == cur_constraint->m_type) {
             int m = cur_constraint->m_end;
+            stop = m;
 
             m_phrase_index->clear_ranges(ranges);
 
             /* do one pinyin table search. */
-            int retval = search_matrix(m_pinyin_table, m_matrix,
-                                       i, m, ranges);
+            int retval = search_ranges(i, m, ranges);
 
             if (retval & SEARCH_OK) {
                 /* assume topresults always contains items. */
-                search_bigram2(topresults, i, m, ranges),
-                    search_unigram2(topresults, i, m, ranges);
+                search_bigram2(step, topresults, ntop, i, m, ranges),
+                    search_unigram2(step, topresults, ntop, i, m, ranges);
             }
 
             continue;
         }
 
-        for ( int m = i + 1; m < nstep; ++m ){
+        /* the valid step already searched until nvalid. */
+        stop = nstep;
+        for ( int m = std_lite::max(i + 1, nvalid); m < nstep; ++m ){
             lookup_constraint_t * next_constraint = &g_array_index
                 (m_constraints, lookup_constraint_t, m);
 
-            if (CONSTRAINT_NOSEARCH == next_constraint->m_type)
+            if (CONSTRAINT_NOSEARCH == next_constraint->m_type) {
+                stop = m;
                 break;
+            }
 
             m_phrase_index->clear_ranges(ranges);
 
             /* do one pinyin table search. */
-            int retval = search_matrix(m_pinyin_table, m_matrix,
-                                       i, m, ranges);
+            int retval = search_ranges(i, m, ranges);
 
             if (retval & SEARCH_OK) {
                 /* assume topresults always contains items. */
-                search_bigram2(topresults, i, m, ranges),
-                    search_unigram2(topresults, i, m, ranges);
+                search_bigram2(step, topresults, ntop, i, m, ranges),
+                    search_unigram2(step, topresults, ntop, i, m, ranges);
             }
 
             /* no longer pinyin */
-            if (!(retval & SEARCH_CONTINUED))
+            if (!(retval & SEARCH_CONTINUED)) {
+                stop = m;
                 break;
+            }
         }
     }
 
-    m_phrase_index->destroy_ranges(ranges);
+    return true;
+}
 
-    g_ptr_array_free(candidates, TRUE);
-    g_ptr_array_free(topresults, TRUE);
+int PinyinLookup2::search_ranges(int start, int end,
+                                 PhraseIndexRanges ranges) {
+    if (m_search_cache)
+        return m_search_cache->search(m_pinyin_table, m_matrix,
+                                      start, end, ranges);
 
-    return final_step(results);
+    return search_matrix(m_pinyin_table, m_matrix, start, end, ranges);
 }
 
-bool PinyinLookup2::search_unigram2(GPtrArray * topresults,
+bool PinyinLookup2::search_unigram2(FlatStepContent * step,
+                                    guint32 * topresults, size_t ntop,
                                     int start, int end,
                                     PhraseIndexRanges ranges) {
 
-    if (0 == topresults->len)
+    if (0 == ntop)
         return false;
 
-    lookup_value_t * max = (lookup_value_t *)
-        g_ptr_array_index(topresults, 0);
+    lookup_value_t max_value;
+    step->get_value(topresults[0], max_value);
+    lookup_value_t * max = &max_value;
 
     lookup_constraint_t * constraint =
         &g_array_index(m_constraints, lookup_constraint_t, start);
@@ -347,7 +633,8 @@ bool PinyinLookup2::search_unigram2(GPtrArray * topresults,
     return found;
 }
 
-bool PinyinLookup2::search_bigram2(GPtrArray * topresults,
+bool PinyinLookup2::search_bigram2(FlatStepContent * step,
+                                   guint32 * topresults, size_t ntop,
                                    int start, int end,
                                    PhraseIndexRanges ranges) {
 
@@ -355,29 +642,39 @@ bool PinyinLookup2::search_bigram2(GPtrArray * topresults,
         &g_array_index(m_constraints, lookup_constraint_t, start);
 
     bool found = false;
-    BigramPhraseArray bigram_phrase_items = g_array_new
-        (FALSE, FALSE, sizeof(BigramPhraseItem));
+    BigramPhraseArray bigram_phrase_items = m_bigram_phrase_items;
 
-    for (size_t i = 0; i < topresults->len; ++i) {
-        lookup_value_t * value = (lookup_value_t *)
-            g_ptr_array_index(topresults, i);
+    lookup_value_t cur_value;
+    for (size_t i = 0; i < ntop; ++i) {
+        step->get_value(topresults[i], cur_value);
+        lookup_value_t * value = &cur_value;
 
         phrase_token_t index_token = value->m_handles[1];
 
-        SingleGram * system = NULL, * user = NULL;
-        m_system_bigram->load(index_token, system);
-        m_user_bigram->load(index_token, user);
+        const SingleGram * merged = NULL;
 
-        if ( !merge_single_gram(&m_merged_single_gram, system, user) )
-            continue;
+        if (m_single_gram_cache) {
+            if (!m_single_gram_cache->load(index_token, merged))
+                continue;
+        } else {
+            SingleGram * system = NULL, * user = NULL;
+            if (m_system_bigram->load_view(index_token, m_system_single_gram))
+                system = &m_system_single_gram;
+            if (m_user_bigram->load_view(index_token, m_user_single_gram))
+                user = &m_user_single_gram;
+
+            if ( !merge_single_gram(&m_merged_single_gram, system, user) )
+                continue;
+            merged = &m_merged_single_gram;
+        }
 
         if ( CONSTRAINT_ONESTEP == constraint->m_type ){
             phrase_token_t token = constraint->m_token;
 
             guint32 freq;
-            if( m_merged_single_gram.get_freq(token, freq) ){
+            if( merged->get_freq(token, freq) ){
                 guint32 total_freq;
-                m_merged_single_gram.get_total_freq(total_freq);
+                merged->get_total_freq(total_freq);
                 gfloat bigram_poss = freq / (gfloat) total_freq;
                 found = bigram_gen_next_step(start, constraint->m_end,
                                              value, token, bigram_poss) || found;
@@ -394,7 +691,7 @@ bool PinyinLookup2::search_bigram2(GPtrArray * topresults,
                         &g_array_index(array, PhraseIndexRange, n);
 
                     g_array_set_size(bigram_phrase_items, 0);
-                    m_merged_single_gram.search(range, bigram_phrase_items);
+                    merged->search(range, bigram_phrase_items);
                     for( size_t k = 0; k < bigram_phrase_items->len; ++k) {
                         BigramPhraseItem * item = &g_array_index(bigram_phrase_items, BigramPhraseItem, k);
                         found = bigram_gen_next_step(start, end, value, item->m_token, item->m_freq) || found;
@@ -402,13 +699,8 @@ bool PinyinLookup2::search_bigram2(GPtrArray * topresults,
                 }
             }
         }
-        if (system)
-            delete system;
-        if (user)
-            delete user;
     }
 
-    g_array_free(bigram_phrase_items, TRUE);
     return found;
 }
 
@@ -417,17 +709,17 @@ bool PinyinLookup2::unigram_gen_next_step(int start, int end,
                                           lookup_value_t * cur_step,
                                           phrase_token_t token) {
 
-    if (m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+    phrase_hot_item_t hot_item;
+    if (m_phrase_index->get_hot_item(token, hot_item))
         return false;
 
-    size_t phrase_length = m_cached_phrase_item.get_phrase_length();
-    gdouble elem_poss = m_cached_phrase_item.get_unigram_frequency() / (gdouble)
+    size_t phrase_length = hot_item.m_phrase_length;
+    gdouble elem_poss = hot_item.m_unigram_frequency / (gdouble)
         m_phrase_index->get_phrase_index_total_freq();
     if ( elem_poss < DBL_EPSILON )
         return false;
 
-    gfloat pinyin_poss = compute_pronunciation_possibility
-        (m_matrix, start, end, m_cached_keys, m_cached_phrase_item);
+    gfloat pinyin_poss = compute_span_possibility(start, end, token);
     if (pinyin_poss < FLT_EPSILON )
         return false;
 
@@ -445,17 +737,17 @@ bool PinyinLookup2::bigram_gen_next_step(int start, int end,
                                          phrase_token_t token,
                                          gfloat bigram_poss) {
 
-    if (m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+    phrase_hot_item_t hot_item;
+    if (m_phrase_index->get_hot_item(token, hot_item))
         return false;
 
-    size_t phrase_length = m_cached_phrase_item.get_phrase_length();
-    gdouble unigram_poss = m_cached_phrase_item.get_unigram_frequency() /
+    size_t phrase_length = hot_item.m_phrase_length;
+    gdouble unigram_poss = hot_item.m_unigram_frequency /
         (gdouble) m_phrase_index->get_phrase_index_total_freq();
     if ( bigram_poss < FLT_EPSILON && unigram_poss < DBL_EPSILON )
         return false;
 
-    gfloat pinyin_poss = compute_pronunciation_possibility
-                       (m_matrix, start, end, m_cached_keys, m_cached_phrase_item);
+    gfloat pinyin_poss = compute_span_possibility(start, end, token);
     if ( pinyin_poss < FLT_EPSILON )
         return false;
 
@@ -469,38 +761,52 @@ bool PinyinLookup2::bigram_gen_next_step(int start, int end,
     return save_next_step(end, cur_step, &next_step);
 }
 
+gfloat PinyinLookup2::compute_span_possibility(int start, int end,
+                                               phrase_token_t token) {
+    gfloat pinyin_poss = 0.;
+    if (m_span_cache.lookup_pronunciation_possibility
+        (start, end, token, pinyin_poss))
+        return pinyin_poss;
+
+    /* only get the phrase item when the possibility is not memorized. */
+    if (m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+        return 0.;
+
+    return m_span_cache.compute_pronunciation_possibility
+        (start, end, token, m_cached_phrase_item);
+}
+
 bool PinyinLookup2::save_next_step(int next_step_pos,
                                    lookup_value_t * cur_step,
                                    lookup_value_t * next_step){
 
     lookup_key_t next_key = next_step->m_handles[1];
-    LookupStepIndex next_lookup_index = (LookupStepIndex)
+    FlatStepIndex * next_lookup_index = (FlatStepIndex *)
         g_ptr_array_index(m_steps_index, next_step_pos);
-    LookupStepContent next_lookup_content = (LookupStepContent)
+    FlatStepContent * next_lookup_content = (FlatStepContent *)
         g_ptr_array_index(m_steps_content, next_step_pos);
 
-    gpointer key = NULL, value = NULL;
-    gboolean lookup_result = g_hash_table_lookup_extended
-        (next_lookup_index, GUINT_TO_POINTER(next_key), &key, &value);
+    guint32 step_index = 0;
+    bool lookup_result = next_lookup_index->lookup(next_key, step_index);
 
     if ( !lookup_result ){
-        g_array_append_val(next_lookup_content, *next_step);
-        g_hash_table_insert(next_lookup_index, GUINT_TO_POINTER(next_key), GUINT_TO_POINTER(next_lookup_content->len - 1));
+        step_index = next_lookup_content->append(*next_step);
+        next_lookup_index->insert(next_key, step_index);
+
+        if (m_nbest > 1)
+            save_alternative(next_step_pos, step_index, next_step);
         return true;
     }else{
-        size_t step_index = GPOINTER_TO_UINT(value);
-        lookup_value_t * orig_next_value = &g_array_index
-            (next_lookup_content, lookup_value_t, step_index);
+        if (m_nbest > 1)
+            save_alternative(next_step_pos, step_index, next_step);
+
+        lookup_value_t orig_next_value;
+        next_lookup_content->get_value(step_index, orig_next_value);
 
-        if (orig_next_value->m_length > next_step->m_length ||
-            (orig_next_value->m_length == next_step->m_length &&
-             orig_next_value->m_poss < next_step->m_poss)) {
+        if (lookup_value_better(next_step, &orig_next_value)) {
             /* found better result. */
-            orig_next_value->m_handles[0] = next_step->m_handles[0];
-            assert(orig_next_value->m_handles[1] == next_step->m_handles[1]);
-            orig_next_value->m_length = next_step->m_length;
-            orig_next_value->m_poss = next_step->m_poss;
-            orig_next_value->m_last_step = next_step->m_last_step;
+            assert(orig_next_value.m_handles[1] == next_step->m_handles[1]);
+            next_lookup_content->set_value(step_index, *next_step);
             return true;
         }
 
@@ -508,6 +814,64 @@ bool PinyinLookup2::save_next_step(int next_step_pos,
     }
 }
 
+/* keep the best m_nbest transitions into the node, sorted. */
+bool PinyinLookup2::save_alternative(int next_step_pos,
+                                     guint32 node_index,
+                                     lookup_value_t * next_step){
+    GArray * alternatives = (GArray *)
+        g_ptr_array_index(m_steps_alternatives, next_step_pos);
+
+    const size_t base = node_index * m_nbest;
+    if (alternatives->len < base + m_nbest) {
+        /* the new node. */
+        const size_t oldlen = alternatives->len;
+        assert(oldlen == base);
+        g_array_set_size(alternatives, base + m_nbest);
+
+        const lookup_value_t empty;
+        for (size_t i = oldlen; i < alternatives->len; ++i)
+            g_array_index(alternatives, lookup_value_t, i) = empty;
+    }
+
+    lookup_value_t * values = &g_array_index
+        (alternatives, lookup_value_t, base);
+
+    /* the same transition may come from both bi-gram and uni-gram. */
+    for (size_t i = 0; i < m_nbest; ++i) {
+        lookup_value_t * value = values + i;
+        if (-1 == value->m_last_step)
+            break;
+
+        if (value->m_last_step == next_step->m_last_step &&
+            value->m_handles[0] == next_step->m_handles[0]) {
+            if (!lookup_value_better(next_step, value))
+                return false;
+
+            /* remove the worse one. */
+            memmove(value, value + 1,
+                    (m_nbest - i - 1) * sizeof(lookup_value_t));
+            values[m_nbest - 1] = lookup_value_t();
+            break;
+        }
+    }
+
+    size_t pos = 0;
+    for (; pos < m_nbest; ++pos) {
+        lookup_value_t * value = values + pos;
+        if (-1 == value->m_last_step ||
+            lookup_value_better(next_step, value))
+            break;
+    }
+
+    if (pos == m_nbest)
+        return false;
+
+    memmove(values + pos + 1, values + pos,
+            (m_nbest - pos - 1) * sizeof(lookup_value_t));
+    values[pos] = *next_step;
+    return true;
+}
+
 bool PinyinLookup2::final_step(MatchResults & results){
 
     /* reset results */
@@ -520,43 +884,46 @@ bool PinyinLookup2::final_step(MatchResults & results){
     /* find max element */
     size_t last_step_pos = m_steps_content->len - 1;
     /* skip the preceding "'" characters for constraints? */
-    GArray * last_step_array = (GArray *)g_ptr_array_index(m_steps_content, last_step_pos);
-    if ( last_step_array->len == 0 )
+    FlatStepContent * last_step_content = (FlatStepContent *)
+        g_ptr_array_index(m_steps_content, last_step_pos);
+    if ( last_step_content->size() == 0 )
         return false;
 
-    lookup_value_t * max_value = &g_array_index(last_step_array, lookup_value_t, 0);
-    for ( size_t i = 1; i < last_step_array->len; ++i){
-        lookup_value_t * cur_value = &g_array_index(last_step_array, lookup_value_t, i);
-        if (cur_value->m_length < max_value->m_length ||
-            (cur_value->m_length == max_value->m_length &&
-             cur_value->m_poss > max_value->m_poss))
-            max_value = cur_value;
+    const gfloat * poss = last_step_content->get_all_poss();
+    guint32 max_index = 0;
+    for ( size_t i = 1; i < last_step_content->size(); ++i){
+        const gint32 cur_length = last_step_content->get_length(i);
+        const gint32 max_length = last_step_content->get_length(max_index);
+        if (cur_length < max_length ||
+            (cur_length == max_length && poss[i] > poss[max_index]))
+            max_index = i;
     }
 
+    lookup_value_t max_value;
+    last_step_content->get_value(max_index, max_value);
+
     /* backtracing */
     while( true ){
-        int cur_step_pos = max_value->m_last_step;
+        int cur_step_pos = max_value.m_last_step;
         if ( -1 == cur_step_pos )
             break;
 
         phrase_token_t * token = &g_array_index
             (results, phrase_token_t, cur_step_pos);
-        *token = max_value->m_handles[1];
+        *token = max_value.m_handles[1];
 
-        phrase_token_t last_token = max_value->m_handles[0];
-        LookupStepIndex lookup_step_index = (LookupStepIndex)
+        phrase_token_t last_token = max_value.m_handles[0];
+        FlatStepIndex * lookup_step_index = (FlatStepIndex *)
             g_ptr_array_index(m_steps_index, cur_step_pos);
 
-        gpointer key = NULL, value = NULL;
-        gboolean result = g_hash_table_lookup_extended
-            (lookup_step_index, GUINT_TO_POINTER(last_token), &key, &value);
+        guint32 value = 0;
+        bool result = lookup_step_index->lookup(last_token, value);
         if (!result)
             return false;
 
-        LookupStepContent lookup_step_content = (LookupStepContent)
+        FlatStepContent * lookup_step_content = (FlatStepContent *)
             g_ptr_array_index(m_steps_content, cur_step_pos);
-        max_value = &g_array_index
-            (lookup_step_content, lookup_value_t, GPOINTER_TO_UINT(value));
+        lookup_step_content->get_value(value, max_value);
     }
 
     /* no need to reverse the result */
@@ -564,6 +931,365 @@ bool PinyinLookup2::final_step(MatchResults & results){
 }
 
 
+/* Note:
+ *   the lazy k-best backtrace, the derivations of each node are
+ *   computed on demand from the saved alternative transitions.
+ *   As the transition only depends on the best value of the previous node,
+ *   the k-th derivation through one transition uses
+ *   the k-th derivation of the previous node.
+ */
+
+struct nbest_derivation_t{
+    /* the sentence length */
+    gint32 m_length;
+    /* the possibility of the derivation */
+    gfloat m_poss;
+    /* the index of the transition in the alternatives of the node */
+    guint32 m_edge;
+    /* the rank in the derivations of the previous node,
+       -1 for the prefixes. */
+    gint32 m_rank;
+};
+
+/* the arrays of the node are in the arena. */
+struct nbest_node_t{
+    /* the computed derivations, sorted */
+    nbest_derivation_t * m_derivations;
+    guint32 m_num_derivations;
+    guint32 m_derivations_capacity;
+    /* the heap of the next derivations, at most m_nbest ones,
+       as each pop of the heap pushes at most one successor. */
+    nbest_derivation_t * m_candidates;
+    guint32 m_num_candidates;
+};
+
+struct nbest_context_t{
+    GPtrArray * m_steps_index;
+    GPtrArray * m_steps_content;
+    GPtrArray * m_steps_alternatives;
+    size_t m_nbest;
+    /* the nodes of each step in the arena, created on demand. */
+    MemoryArena * m_arena;
+    nbest_node_t *** m_nodes;
+};
+
+static bool nbest_derivation_less_than(const nbest_derivation_t & lhs,
+                                       const nbest_derivation_t & rhs){
+    /* the worse derivation is less than. */
+    return rhs.m_length < lhs.m_length ||
+        (rhs.m_length == lhs.m_length && rhs.m_poss > lhs.m_poss);
+}
+
+static nbest_node_t * get_nbest_node(nbest_context_t * context,
+                                     int step, guint32 node_index){
+    FlatStepContent * content = (FlatStepContent *)
+        g_ptr_array_index(context->m_steps_content, step);
+    assert(node_index < content->size());
+
+    nbest_node_t ** & nodes = context->m_nodes[step];
+    if (NULL == nodes)
+        nodes = context->m_arena->allocate_array0<nbest_node_t *>
+            (content->size());
+
+    nbest_node_t * node = nodes[node_index];
+    if (node)
+        return node;
+
+    MemoryArena * arena = context->m_arena;
+    node = arena->allocate_array<nbest_node_t>(1);
+    node->m_derivations = NULL;
+    node->m_num_derivations = 0;
+    node->m_derivations_capacity = 0;
+    node->m_candidates = arena->allocate_array<nbest_derivation_t>
+        (context->m_nbest);
+    node->m_num_candidates = 0;
+    nodes[node_index] = node;
+
+    lookup_value_t node_value;
+    content->get_value(node_index, node_value);
+    const lookup_value_t * value = &node_value;
+
+    nbest_derivation_t derivation;
+    if (-1 == value->m_last_step) {
+        /* the prefixes only have one derivation. */
+        derivation.m_length = value->m_length;
+        derivation.m_poss = value->m_poss;
+        derivation.m_edge = 0;
+        derivation.m_rank = -1;
+        node->m_candidates[node->m_num_candidates++] = derivation;
+        return node;
+    }
+
+    GArray * alternatives = (GArray *)
+        g_ptr_array_index(context->m_steps_alternatives, step);
+    const lookup_value_t * values = &g_array_index
+        (alternatives, lookup_value_t, node_index * context->m_nbest);
+
+    for (size_t i = 0; i < context->m_nbest; ++i) {
+        if (-1 == values[i].m_last_step)
+            break;
+
+        derivation.m_length = values[i].m_length;
+        derivation.m_poss = values[i].m_poss;
+        derivation.m_edge = i;
+        derivation.m_rank = 0;
+        node->m_candidates[node->m_num_candidates++] = derivation;
+    }
+
+    nbest_derivation_t * begin = node->m_candidates;
+    std_lite::make_heap(begin, begin + node->m_num_candidates,
+                        nbest_derivation_less_than);
+    return node;
+}
+
+/* append the derivation, the array grows in the arena. */
+static void append_nbest_derivation(nbest_context_t * context,
+                                    nbest_node_t * node,
+                                    const nbest_derivation_t & derivation){
+    if (node->m_num_derivations == node->m_derivations_capacity) {
+        const guint32 capacity = std_lite::max
+            ((guint32) 4, node->m_derivations_capacity * 2);
+        nbest_derivation_t * derivations = context->m_arena->
+            allocate_array<nbest_derivation_t>(capacity);
+        if (node->m_num_derivations)
+            memcpy(derivations, node->m_derivations,
+                   node->m_num_derivations * sizeof(nbest_derivation_t));
+
+        node->m_derivations = derivations;
+        node->m_derivations_capacity = capacity;
+    }
+
+    node->m_derivations[node->m_num_derivations++] = derivation;
+}
+
+static const lookup_value_t * get_nbest_edge(nbest_context_t * context,
+                                             int step, guint32 node_index,
+                                             guint32 edge){
+    GArray * alternatives = (GArray *)
+        g_ptr_array_index(context->m_steps_alternatives, step);
+    return &g_array_index(alternatives, lookup_value_t,
+                          node_index * context->m_nbest + edge);
+}
+
+static bool get_nbest_prev_node(nbest_context_t * context,
+                                const lookup_value_t * edge,
+                                guint32 & prev_index){
+    FlatStepIndex * index = (FlatStepIndex *)
+        g_ptr_array_index(context->m_steps_index, edge->m_last_step);
+    return index->lookup(edge->m_handles[0], prev_index);
+}
+
+/* get the rank-th derivation of the node. */
+static bool get_nbest_derivation(nbest_context_t * context,
+                                 int step, guint32 node_index,
+                                 gint32 rank,
+                                 nbest_derivation_t & derivation){
+    nbest_node_t * node = get_nbest_node(context, step, node_index);
+
+    while (node->m_num_derivations <= (guint32) rank) {
+        if (node->m_num_derivations > 0) {
+            /* push the successor of the last derivation. */
+            const nbest_derivation_t last =
+                node->m_derivations[node->m_num_derivations - 1];
+
+            guint32 prev_index = 0;
+            const lookup_value_t * edge = NULL;
+            nbest_derivation_t prev_derivation;
+
+            bool found = false;
+            if (-1 != last.m_rank) {
+                edge = get_nbest_edge(context, step, node_index,
+                                      last.m_edge);
+                found = get_nbest_prev_node(context, edge, prev_index);
+                assert(found);
+            }
+
+            if (found &&
+                get_nbest_derivation(context, edge->m_last_step,
+                                     prev_index, last.m_rank + 1,
+                                     prev_derivation)) {
+                FlatStepContent * content = (FlatStepContent *)
+                    g_ptr_array_index(context->m_steps_content,
+                                      edge->m_last_step);
+                lookup_value_t prev_value;
+                content->get_value(prev_index, prev_value);
+                const lookup_value_t * prev_best = &prev_value;
+
+                nbest_derivation_t next = last;
+                next.m_length = edge->m_length - prev_best->m_length +
+                    prev_derivation.m_length;
+                next.m_poss = edge->m_poss - prev_best->m_poss +
+                    prev_derivation.m_poss;
+                next.m_rank = last.m_rank + 1;
+
+                assert(node->m_num_candidates < context->m_nbest);
+                node->m_candidates[node->m_num_candidates++] = next;
+                nbest_derivation_t * begin = node->m_candidates;
+                std_lite::push_heap(begin, begin + node->m_num_candidates,
+                                    nbest_derivation_less_than);
+            }
+        }
+
+        if (0 == node->m_num_candidates)
+            return false;
+
+        nbest_derivation_t * begin = node->m_candidates;
+        std_lite::pop_heap(begin, begin + node->m_num_candidates,
+                           nbest_derivation_less_than);
+        --node->m_num_candidates;
+        append_nbest_derivation(context, node,
+                                begin[node->m_num_candidates]);
+    }
+
+    derivation = node->m_derivations[rank];
+    return true;
+}
+
+static bool backtrace_nbest_derivation(nbest_context_t * context,
+                                       int step, guint32 node_index,
+                                       gint32 rank,
+                                       MatchResults results){
+    while (true) {
+        nbest_derivation_t derivation;
+        if (!get_nbest_derivation(context, step, node_index,
+                                  rank, derivation))
+            return false;
+
+        if (-1 == derivation.m_rank)
+            break;
+
+        const lookup_value_t * edge = get_nbest_edge
+            (context, step, node_index, derivation.m_edge);
+
+        phrase_token_t * token = &g_array_index
+            (results, phrase_token_t, edge->m_last_step);
+        *token = edge->m_handles[1];
+
+        guint32 prev_index = 0;
+        if (!get_nbest_prev_node(context, edge, prev_index))
+            return false;
+
+        step = edge->m_last_step;
+        node_index = prev_index;
+        rank = derivation.m_rank;
+    }
+
+    return true;
+}
+
+struct nbest_sentence_t{
+    nbest_derivation_t m_derivation;
+    /* the node in the last step */
+    guint32 m_node_index;
+    /* the rank in the derivations of the node */
+    gint32 m_rank;
+};
+
+static bool nbest_sentence_less_than(const nbest_sentence_t & lhs,
+                                     const nbest_sentence_t & rhs){
+    return nbest_derivation_less_than(lhs.m_derivation, rhs.m_derivation);
+}
+
+static bool has_same_results(GPtrArray * results, size_t start,
+                             MatchResults one){
+    for (size_t i = start; i < results->len; ++i) {
+        MatchResults other = (MatchResults) g_ptr_array_index(results, i);
+        assert(other->len == one->len);
+
+        if (0 == memcmp(other->data, one->data,
+                        one->len * sizeof(phrase_token_t)))
+            return true;
+    }
+    return false;
+}
+
+bool PinyinLookup2::final_nbest_steps(size_t nbest, GPtrArray * results){
+    const size_t start = results->len;
+
+    if (1 == nbest) {
+        MatchResults one = g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
+        if (!final_step(one)) {
+            g_array_free(one, TRUE);
+            return false;
+        }
+        g_ptr_array_add(results, one);
+        return true;
+    }
+
+    const size_t nstep = m_steps_content->len;
+    const int last_step_pos = nstep - 1;
+    FlatStepContent * last_step = (FlatStepContent *)
+        g_ptr_array_index(m_steps_content, last_step_pos);
+    if (0 == last_step->size())
+        return false;
+
+    nbest_context_t context;
+    context.m_steps_index = m_steps_index;
+    context.m_steps_content = m_steps_content;
+    context.m_steps_alternatives = m_steps_alternatives;
+    context.m_nbest = m_nbest;
+    context.m_arena = &m_arena;
+    context.m_nodes = m_arena.allocate_array0<nbest_node_t **>(nstep);
+
+    /* merge the derivations of all nodes in the last step,
+       the heap has at most one sentence of each node. */
+    nbest_sentence_t * sentences = m_arena.allocate_array<nbest_sentence_t>
+        (last_step->size());
+    size_t num_sentences = 0;
+    for (size_t i = 0; i < last_step->size(); ++i) {
+        nbest_sentence_t sentence;
+        sentence.m_node_index = i;
+        sentence.m_rank = 0;
+        if (get_nbest_derivation(&context, last_step_pos, i, 0,
+                                 sentence.m_derivation))
+            sentences[num_sentences++] = sentence;
+    }
+
+    std_lite::make_heap(sentences, sentences + num_sentences,
+                        nbest_sentence_less_than);
+
+    MatchResults one = NULL;
+    while (results->len - start < nbest && num_sentences > 0) {
+        std_lite::pop_heap(sentences, sentences + num_sentences,
+                           nbest_sentence_less_than);
+        nbest_sentence_t best = sentences[--num_sentences];
+
+        /* push the next derivation of the same node. */
+        nbest_sentence_t next = best;
+        next.m_rank = best.m_rank + 1;
+        if (get_nbest_derivation(&context, last_step_pos,
+                                 next.m_node_index, next.m_rank,
+                                 next.m_derivation)) {
+            sentences[num_sentences++] = next;
+            std_lite::push_heap(sentences, sentences + num_sentences,
+                                nbest_sentence_less_than);
+        }
+
+        if (NULL == one)
+            one = g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
+        g_array_set_size(one, nstep);
+        for (size_t i = 0; i < one->len; ++i)
+            g_array_index(one, phrase_token_t, i) = null_token;
+
+        if (!backtrace_nbest_derivation(&context, last_step_pos,
+                                        best.m_node_index, best.m_rank,
+                                        one))
+            continue;
+
+        /* different prefixes may produce the same sentence. */
+        if (has_same_results(results, start, one))
+            continue;
+
+        g_ptr_array_add(results, one);
+        one = NULL;
+    }
+
+    if (one)
+        g_array_free(one, TRUE);
+
+    return results->len > start;
+}
+
 bool PinyinLookup2::train_result2(PhoneticKeyMatrix * matrix,
                                   CandidateConstraints constraints,
                                   MatchResults results) {
@@ -624,6 +1350,8 @@ bool PinyinLookup2::train_result2(PhoneticKeyMatrix * matrix,
                 /* if total_freq is not overflow, then freq won't overflow. */
                 assert(user->set_freq(token, freq + seed));
                 assert(m_user_bigram->store(last_token, user));
+                if (m_single_gram_cache)
+                    m_single_gram_cache->invalidate(last_token);
             next:
                 assert(NULL != user);
                 if (user)
@@ -643,15 +1371,19 @@ bool PinyinLookup2::train_result2(PhoneticKeyMatrix * matrix,
             next_pos = std_lite::min(next_pos, constraints->len - 1);
 
             /* train uni-gram */
-            m_phrase_index->get_phrase_item(token, m_cached_phrase_item);
-            increase_pronunciation_possibility
+            m_phrase_index->get_writable_phrase_item(token, m_cached_phrase_item);
+            if (increase_pronunciation_possibility
                 (matrix, i, next_pos,
-                 m_cached_keys, m_cached_phrase_item, seed * pinyin_factor);
+                 m_cached_keys, m_cached_phrase_item, seed * pinyin_factor))
+                m_phrase_index->update_phrase_item(token);
             m_phrase_index->add_unigram_frequency
                 (token, seed * unigram_factor);
         }
         last_token = token;
     }
+
+    /* the phrase index and user bi-gram are changed. */
+    invalidate_steps();
     return true;
 }
 
@@ -27,9 +27,11 @@
 #include <float.h>
 #include <glib.h>
 #include "novel_types.h"
+#include "memory_arena.h"
 #include "chewing_key.h"
 #include "phrase_index.h"
 #include "ngram.h"
+#include "single_gram_cache.h"
 #include "lookup.h"
 #include "phonetic_key_matrix.h"
 
@@ -76,6 +78,22 @@ struct lookup_constraint_t{
 };
 
 
+/**
+ * beam_statistics_t:
+ *
+ * The counters of the beam pruning, accumulated across the searches.
+ *
+ */
+struct beam_statistics_t{
+    /* the hypotheses expanded in the search. */
+    guint64 m_expanded;
+    /* the hypotheses skipped by the beam width. */
+    guint64 m_width_pruned;
+    /* the hypotheses skipped by the beam margin. */
+    guint64 m_margin_pruned;
+};
+
+
 /**
  * PinyinLookup2:
  *
@@ -90,28 +108,74 @@ private:
     GArray * m_cached_keys;
     PhraseItem m_cached_phrase_item;
     SingleGram m_merged_single_gram;
+    /* the read-only views of the system and user single grams. */
+    SingleGram m_system_single_gram;
+    SingleGram m_user_single_gram;
+
+    /* the pronunciation possibilities in the current search. */
+    PhoneticSpanCache m_span_cache;
+
+    /* the beam options, see PinyinLookup2::set_beam_options. */
+    size_t m_beam_width;
+    gfloat m_beam_margin;
+    size_t m_long_input_length;
+    beam_statistics_t m_beam_statistics;
+
+    /* the scratch data of the current search, reset in search_steps. */
+    MemoryArena m_arena;
+    /* the ranges and bi-gram items, reused across get_best_match calls. */
+    PhraseIndexRanges m_ranges;
+    BigramPhraseArray m_bigram_phrase_items;
 
 protected:
     /* saved varibles */
     CandidateConstraints m_constraints;
     PhoneticKeyMatrix * m_matrix;
+    PhoneticSearchCache * m_search_cache;
 
     FacadeChewingTable2 * m_pinyin_table;
     FacadePhraseIndex * m_phrase_index;
     Bigram * m_system_bigram;
     Bigram * m_user_bigram;
+    SingleGramCache * m_single_gram_cache;
 
     /* internal step data structure */
     GPtrArray * m_steps_index;
-    /* Array of LookupStepIndex */
+    /* Array of FlatStepIndex, reused across get_best_match calls */
     GPtrArray * m_steps_content;
-    /* Array of LookupStepContent */
-
-
-    bool search_unigram2(GPtrArray * topresults,
+    /* Array of FlatStepContent */
+    GArray * m_steps_stop;
+    /* Array of gint32, where the search from the step stopped */
+
+    /* the number of the saved transitions for each node. */
+    size_t m_nbest;
+    GPtrArray * m_steps_alternatives;
+    /* Array of GArray of lookup_value_t,
+       the best m_nbest transitions into each node of FlatStepContent,
+       only used when m_nbest > 1. */
+
+    /* saved from the previous get_best_match call,
+       to reuse the steps which are not changed. */
+    PhoneticKeyMatrix m_last_matrix;
+    TokenVector m_last_prefixes;
+    CandidateConstraints m_last_constraints;
+    size_t m_last_nbest;
+    /* the beam width which pruned the saved steps. */
+    size_t m_last_beam_width;
+
+    size_t compute_valid_steps(TokenVector prefixes, size_t beam_width);
+    size_t compute_beam_width(size_t nstep) const;
+    size_t prune_top_results(FlatStepContent * step, guint32 * topresults,
+                             size_t beam_width, gfloat * scratch);
+    bool save_last_inputs(TokenVector prefixes, size_t beam_width);
+
+
+    bool search_unigram2(FlatStepContent * step,
+                         guint32 * topresults, size_t ntop,
                          int start, int end,
                          PhraseIndexRanges ranges);
-    bool search_bigram2(GPtrArray * topresults,
+    bool search_bigram2(FlatStepContent * step,
+                        guint32 * topresults, size_t ntop,
                         int start, int end,
                         PhraseIndexRanges ranges);
 
@@ -122,10 +186,18 @@ protected:
                               lookup_value_t * cur_step,
                               phrase_token_t token,
                               gfloat bigram_poss);
+    gfloat compute_span_possibility(int start, int end,
+                                    phrase_token_t token);
 
     bool save_next_step(int next_step_pos, lookup_value_t * cur_step, lookup_value_t * next_step);
+    bool save_alternative(int next_step_pos, guint32 node_index,
+                          lookup_value_t * next_step);
+
+    bool search_steps(TokenVector prefixes);
+    int search_ranges(int start, int end, PhraseIndexRanges ranges);
 
     bool final_step(MatchResults & results);
+    bool final_nbest_steps(size_t nbest, GPtrArray * results);
 
 public:
     /**
@@ -135,15 +207,20 @@ public:
      * @phrase_index: the phrase index.
      * @system_bigram: the system bi-gram.
      * @user_bigram: the user bi-gram.
+     * @single_gram_cache: the merged single gram cache, or NULL.
      *
      * The constructor of the PinyinLookup2.
      *
+     * Note: when the single gram cache is shared with others,
+     *   the owner must invalidate it after changing the user bi-gram.
+     *
      */
     PinyinLookup2(const gfloat lambda,
                   FacadeChewingTable2 * pinyin_table,
                   FacadePhraseIndex * phrase_index,
                   Bigram * system_bigram,
-                  Bigram * user_bigram);
+                  Bigram * user_bigram,
+                  SingleGramCache * single_gram_cache = NULL);
 
     /**
      * PinyinLookup2::~PinyinLookup2:
@@ -159,6 +236,7 @@ public:
      * @matrix: the matrix of the pinyin keys.
      * @constraints: the constraints on the guessed sentence.
      * @results: the guessed sentence in the form of the phrase tokens.
+     * @search_cache: the memorized search results of the matrix, or NULL.
      * @returns: whether the guess operation is successful.
      *
      * Guess the best sentence according to user inputs.
@@ -167,7 +245,73 @@ public:
     bool get_best_match(TokenVector prefixes,
                         PhoneticKeyMatrix * matrix,
                         CandidateConstraints constraints,
-                        MatchResults & results);
+                        MatchResults & results,
+                        PhoneticSearchCache * search_cache = NULL);
+
+    /**
+     * PinyinLookup2::get_nbest_match:
+     * @nbest: the maximum number of the guessed sentences.
+     * @prefixes: the phrase tokens before the guessed sentence.
+     * @matrix: the matrix of the pinyin keys.
+     * @constraints: the constraints on the guessed sentence.
+     * @results: the array of MatchResults to store the guessed sentences.
+     * @search_cache: the memorized search results of the matrix, or NULL.
+     * @returns: whether the guess operation is successful.
+     *
+     * Guess the best nbest sentences in one search, in the order of
+     * get_best_match. The new MatchResults are appended to the results,
+     * and should be freed by the caller.
+     *
+     */
+    bool get_nbest_match(size_t nbest,
+                         TokenVector prefixes,
+                         PhoneticKeyMatrix * matrix,
+                         CandidateConstraints constraints,
+                         GPtrArray * results,
+                         PhoneticSearchCache * search_cache = NULL);
+
+    /**
+     * PinyinLookup2::set_beam_options:
+     * @beam_width: the maximum number of the expanded hypotheses
+     *              in each step, 0 for the default.
+     * @beam_margin: the log possibility margin below the best hypothesis
+     *               in each step, 0 to disable.
+     * @long_input_length: the number of the steps, after which the beam
+     *                     width shrinks in proportion, 0 to disable.
+     * @returns: whether the set operation is successful.
+     *
+     * Trade the accuracy for the bounded latency of the search.
+     *
+     */
+    bool set_beam_options(size_t beam_width,
+                          gfloat beam_margin,
+                          size_t long_input_length);
+
+    /**
+     * PinyinLookup2::get_beam_statistics:
+     * @statistics: the counters of the beam pruning.
+     * @returns: whether the get operation is successful.
+     *
+     * Get the counters of the beam pruning since the construction.
+     *
+     */
+    bool get_beam_statistics(beam_statistics_t & statistics) const {
+        statistics = m_beam_statistics;
+        return true;
+    }
+
+    /**
+     * PinyinLookup2::invalidate_steps:
+     * @returns: whether the invalidate operation is successful.
+     *
+     * Drop the steps saved from the previous get_best_match call,
+     * must be called after the phrase index or bi-gram is changed.
+     *
+     * Note: get_best_match only re-computes the steps after
+     *   the first changed column in the matrix or the constraints.
+     *
+     */
+    bool invalidate_steps();
 
     /**
      * PinyinLookup2::train_result2:
@@ -37,6 +37,11 @@ typedef GArray * CandidateVector; /* GArray of lookup_candidate_t */
 struct _pinyin_context_t{
     pinyin_option_t m_options;
 
+    /* the beam options of the lookups. */
+    guint m_beam_width;
+    gfloat m_beam_margin;
+    guint m_long_input_length;
+
     /* input parsers. */
     FullPinyinParser2 * m_full_pinyin_parser;
     DoublePinyinParser2 * m_double_pinyin_parser;
@@ -48,10 +53,9 @@ struct _pinyin_context_t{
     FacadePhraseIndex * m_phrase_index;
     Bigram * m_system_bigram;
     Bigram * m_user_bigram;
-
-    /* lookups. */
-    PinyinLookup2 * m_pinyin_lookup;
-    PhraseLookup * m_phrase_lookup;
+    /* the merged single grams of the tokens in both bi-grams,
+       materialized when saving the user bi-gram. */
+    Bigram * m_merged_bigram;
 
     /* addon tables. */
     FacadeChewingTable2 * m_addon_pinyin_table;
@@ -61,8 +65,20 @@ struct _pinyin_context_t{
     char * m_system_dir;
     char * m_user_dir;
     bool m_modified;
+    /* rewrite the logger of difference instead of the journal tail. */
+    bool m_compact_journals;
+
+    /* the load time of the components in pinyin_init,
+       GArray of init_timing_t. */
+    GArray * m_init_timings;
 
     SystemTableInfo2 m_system_table_info;
+
+    /* the lookups hold the reader lock,
+       the changes of the user data hold the writer lock. */
+    GRWLock m_lock;
+    /* increased after the user data is changed. */
+    guint32 m_generation;
 };
 
 struct _pinyin_instance_t{
@@ -80,6 +96,23 @@ struct _pinyin_instance_t{
     CandidateConstraints m_constraints;
     MatchResults m_match_results;
     CandidateVector m_candidates;
+
+    /* the n-best sentences, array of MatchResults. */
+    GPtrArray * m_sentences;
+
+    /* the search results of the matrix,
+       shared by the sentence and candidates guess. */
+    PhoneticSearchCache m_search_cache;
+
+    /* merged single grams, reset after changing user bi-gram. */
+    SingleGramCache * m_single_gram_cache;
+
+    /* lookups, with the scratch state of the instance. */
+    PinyinLookup2 * m_pinyin_lookup;
+    PhraseLookup * m_phrase_lookup;
+
+    /* the generation of the context, when the caches are valid. */
+    guint32 m_generation;
 };
 
 struct _lookup_candidate_t{
@@ -115,6 +148,96 @@ struct _export_iterator_t{
     guint8 m_next_pronunciation;
 };
 
+/* hold the reader lock of the context in the scope. */
+class ContextReaderLock{
+private:
+    GRWLock * m_lock;
+
+public:
+    ContextReaderLock(pinyin_context_t * context){
+        m_lock = &context->m_lock;
+        g_rw_lock_reader_lock(m_lock);
+    }
+
+    ~ContextReaderLock(){
+        g_rw_lock_reader_unlock(m_lock);
+    }
+};
+
+/* hold the writer lock of the context in the scope. */
+class ContextWriterLock{
+private:
+    GRWLock * m_lock;
+
+public:
+    ContextWriterLock(pinyin_context_t * context){
+        m_lock = &context->m_lock;
+        g_rw_lock_writer_lock(m_lock);
+    }
+
+    ~ContextWriterLock(){
+        g_rw_lock_writer_unlock(m_lock);
+    }
+};
+
+/* must hold the writer lock, the instances drop their cached steps
+   and single grams before the next lookup. */
+static void _context_changed(pinyin_context_t * context){
+    ++context->m_generation;
+}
+
+/* must hold the writer lock, the instance already dropped
+   its stale cached steps and single grams. */
+static void _instance_changed(pinyin_instance_t * instance){
+    pinyin_context_t * context = instance->m_context;
+    bool synced = instance->m_generation == context->m_generation;
+
+    _context_changed(context);
+    if (synced)
+        instance->m_generation = context->m_generation;
+}
+
+/* must hold the reader or writer lock. */
+static void _sync_instance(pinyin_instance_t * instance){
+    pinyin_context_t * context = instance->m_context;
+    if (instance->m_generation == context->m_generation)
+        return;
+
+    instance->m_pinyin_lookup->set_beam_options
+        (context->m_beam_width, context->m_beam_margin,
+         context->m_long_input_length);
+    instance->m_pinyin_lookup->invalidate_steps();
+    instance->m_single_gram_cache->reset();
+    instance->m_generation = context->m_generation;
+}
+
+/* the journal is merged into the logger of difference beyond this size. */
+static const size_t journal_compact_threshold = 256 * 1024;
+
+static gchar * _build_journal_pathname(const char * user_dir,
+                                       const char * userfilename){
+    gchar * journalfilename = g_strdup_printf("%s.journal", userfilename);
+    gchar * pathname = g_build_filename(user_dir, journalfilename, NULL);
+    g_free(journalfilename);
+    return pathname;
+}
+
+/* append the journal tail, unless the journal should be compacted. */
+static bool _append_journal(const char * pathname, MemoryChunk * tail){
+    size_t journal_size = 0;
+    GStatBuf buf;
+    if (0 == g_stat(pathname, &buf))
+        journal_size = buf.st_size;
+
+    if (journal_size + tail->size() > journal_compact_threshold)
+        return false;
+
+    if (0 == tail->size())
+        return true;
+
+    return tail->append(pathname);
+}
+
 static bool _clean_user_files(const char * user_dir,
                               const pinyin_table_info_t * phrase_files){
     /* clean up files, if version mis-matches. */
@@ -133,6 +256,11 @@ static bool _clean_user_files(const char * user_dir,
         gchar * filename = g_build_filename(user_dir, userfilename, NULL);
         unlink(filename);
         g_free(filename);
+
+        /* remove journal file. */
+        filename = _build_journal_pathname(user_dir, userfilename);
+        unlink(filename);
+        g_free(filename);
     }
 
     return true;
@@ -236,6 +364,15 @@ static bool _load_phrase_library (const char * system_dir,
 
         /* merge the chunk log. */
         phrase_index->merge(index, log);
+
+        /* replay the journal after the chunk log. */
+        chunkfilename = _build_journal_pathname(user_dir, userfilename);
+        MemoryChunk * journal = new MemoryChunk;
+        journal->load(chunkfilename);
+        g_free(chunkfilename);
+
+        phrase_index->replay_journal(index, journal);
+        phrase_index->start_journal(index);
         return true;
     }
 
@@ -285,14 +422,182 @@ static bool _load_phrase_library (const char * system_dir,
     return false;
 }
 
+struct init_timing_t{
+    const char * m_component;
+    gint64 m_usec;
+};
+
+/* one independent load of pinyin_init, run in the thread pool. */
+struct init_task_t{
+    pinyin_context_t * m_context;
+    void (* m_load)(init_task_t * task);
+
+    /* the default phrase library, loaded into the private phrase index. */
+    const pinyin_table_info_t * m_table_info;
+    FacadePhraseIndex * m_phrase_index;
+
+    /* the load time of the component. */
+    const char * m_component;
+    gint64 m_usec;
+};
+
+/* the maximum number of the threads to load the components,
+   the loads mostly wait for the disk, so the pool is sized
+   by the tasks instead of the processors. */
+static const guint max_init_threads = 4;
+
+static void _load_pinyin_table(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    const bool packed = PINYIN_INDEX_PACKED_FORMAT ==
+        context->m_system_table_info.get_pinyin_index_file_format();
+
+    gchar * system_filename = g_build_filename
+        (context->m_system_dir, SYSTEM_PINYIN_INDEX, NULL);
+    gchar * user_filename = g_build_filename
+        (context->m_user_dir, USER_PINYIN_INDEX, NULL);
+    if (packed) {
+        gchar * packed_filename = g_build_filename
+            (context->m_system_dir, SYSTEM_PACKED_PINYIN_INDEX, NULL);
+        context->m_pinyin_table->load_packed
+            (packed_filename, system_filename, user_filename);
+        g_free(packed_filename);
+    } else {
+        context->m_pinyin_table->load(system_filename, user_filename);
+    }
+    g_free(user_filename);
+    g_free(system_filename);
+}
+
+static void _load_phrase_table(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    gchar * system_filename = g_build_filename
+        (context->m_system_dir, SYSTEM_PHRASE_INDEX, NULL);
+    gchar * user_filename = g_build_filename
+        (context->m_user_dir, USER_PHRASE_INDEX, NULL);
+    context->m_phrase_table->load(system_filename, user_filename);
+    g_free(user_filename);
+    g_free(system_filename);
+}
+
+static void _load_default_phrase_library(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    _load_phrase_library(context->m_system_dir, context->m_user_dir,
+                         task->m_phrase_index, task->m_table_info);
+}
+
+static void _load_system_bigram(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    gchar * filename = NULL;
+    bool attached = false;
+    if (BIGRAM_PACKED_FORMAT ==
+        context->m_system_table_info.get_bigram_file_format()) {
+        filename = g_build_filename(context->m_system_dir,
+                                    SYSTEM_PACKED_BIGRAM, NULL);
+        attached = context->m_system_bigram->attach_packed(filename);
+        g_free(filename);
+    }
+
+    /* fall back to the bi-gram database. */
+    if (!attached) {
+        filename = g_build_filename(context->m_system_dir,
+                                    SYSTEM_BIGRAM, NULL);
+        context->m_system_bigram->attach(filename, ATTACH_READONLY);
+        g_free(filename);
+    }
+}
+
+static void _load_user_bigram(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    gchar * filename = g_build_filename
+        (context->m_user_dir, USER_BIGRAM, NULL);
+    context->m_user_bigram->load_db(filename);
+    g_free(filename);
+}
+
+static void _load_addon_pinyin_table(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    const bool packed = PINYIN_INDEX_PACKED_FORMAT ==
+        context->m_system_table_info.get_pinyin_index_file_format();
+
+    gchar * system_filename = g_build_filename
+        (context->m_system_dir, ADDON_SYSTEM_PINYIN_INDEX, NULL);
+    if (packed) {
+        gchar * packed_filename = g_build_filename
+            (context->m_system_dir, ADDON_SYSTEM_PACKED_PINYIN_INDEX, NULL);
+        context->m_addon_pinyin_table->load_packed
+            (packed_filename, system_filename, NULL);
+        g_free(packed_filename);
+    } else {
+        context->m_addon_pinyin_table->load(system_filename, NULL);
+    }
+    g_free(system_filename);
+}
+
+static void _load_addon_phrase_table(init_task_t * task){
+    pinyin_context_t * context = task->m_context;
+
+    gchar * system_filename = g_build_filename
+        (context->m_system_dir, ADDON_SYSTEM_PHRASE_INDEX, NULL);
+    context->m_addon_phrase_table->load(system_filename, NULL);
+    g_free(system_filename);
+}
+
+static void _run_init_task(gpointer data, gpointer user_data){
+    init_task_t * task = (init_task_t *) data;
+
+    gint64 start = g_get_monotonic_time();
+    task->m_load(task);
+    task->m_usec = g_get_monotonic_time() - start;
+}
+
+static init_task_t * _add_init_task(GPtrArray * tasks,
+                                    pinyin_context_t * context,
+                                    void (* load)(init_task_t * task),
+                                    const char * component){
+    init_task_t * task = new init_task_t;
+    task->m_context = context;
+    task->m_load = load;
+    task->m_table_info = NULL;
+    task->m_phrase_index = NULL;
+    task->m_component = component;
+    task->m_usec = 0;
+    g_ptr_array_add(tasks, task);
+    return task;
+}
+
+static void _add_init_timing(pinyin_context_t * context,
+                             const char * component, gint64 usec){
+    init_timing_t timing;
+    timing.m_component = component;
+    timing.m_usec = usec;
+    g_array_append_val(context->m_init_timings, timing);
+}
+
 pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
+    gint64 start = g_get_monotonic_time();
     pinyin_context_t * context = new pinyin_context_t;
 
     context->m_options = USE_TONE;
 
+    context->m_beam_width = 0;
+    context->m_beam_margin = 0.;
+    context->m_long_input_length = 0;
+
     context->m_system_dir = g_strdup(systemdir);
     context->m_user_dir = g_strdup(userdir);
     context->m_modified = false;
+    context->m_compact_journals = false;
+    context->m_init_timings = g_array_new
+        (FALSE, FALSE, sizeof(init_timing_t));
+
+    g_rw_lock_init(&context->m_lock);
+    context->m_generation = 0;
 
     gchar * filename = g_build_filename
         (context->m_system_dir, SYSTEM_TABLE_INFO, NULL);
@@ -303,43 +608,22 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
     g_free(filename);
 
 
+    /* remove the user files before the loads. */
     check_format(context);
+    _add_init_timing(context, "table_info", g_get_monotonic_time() - start);
 
     context->m_full_pinyin_parser = new FullPinyinParser2;
     context->m_double_pinyin_parser = new DoublePinyinParser2;
     context->m_chewing_parser = new ZhuyinSimpleParser2;
 
-    /* load chewing table. */
-    context->m_pinyin_table = new FacadeChewingTable2;
+    /* the loads below are independent, and run in the thread pool. */
+    GPtrArray * tasks = g_ptr_array_new();
 
-    gchar * system_filename = g_build_filename
-        (context->m_system_dir, SYSTEM_PINYIN_INDEX, NULL);
-    gchar * user_filename = g_build_filename
-        (context->m_user_dir, USER_PINYIN_INDEX, NULL);
-    context->m_pinyin_table->load(system_filename, user_filename);
-    g_free(user_filename);
-    g_free(system_filename);
-
-
-    /* load phrase table */
-    context->m_phrase_table = new FacadePhraseTable3;
-
-    system_filename = g_build_filename
-        (context->m_system_dir, SYSTEM_PHRASE_INDEX, NULL);
-    user_filename = g_build_filename
-        (context->m_user_dir, USER_PHRASE_INDEX, NULL);
-    context->m_phrase_table->load(system_filename, user_filename);
-    g_free(user_filename);
-    g_free(system_filename);
-
-
-    context->m_phrase_index = new FacadePhraseIndex;
+    /* load all default tables into the private phrase indices. */
+    const pinyin_table_info_t * phrase_files =
+        context->m_system_table_info.get_default_tables();
 
-    /* load all default tables. */
     for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i){
-        const pinyin_table_info_t * phrase_files =
-            context->m_system_table_info.get_default_tables();
-
         const pinyin_table_info_t * table_info =
             phrase_files + i;
 
@@ -349,55 +633,97 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
         /* addon dictionary should not in default tables. */
         assert(DICTIONARY != table_info->m_file_type);
 
-        _load_phrase_library(context->m_system_dir, context->m_user_dir,
-                             context->m_phrase_index, table_info);
+        const char * component = SYSTEM_FILE == table_info->m_file_type ?
+            table_info->m_system_filename : table_info->m_user_filename;
+        init_task_t * task = _add_init_task
+            (tasks, context, _load_default_phrase_library, component);
+        task->m_table_info = table_info;
+        task->m_phrase_index = new FacadePhraseIndex;
     }
 
-    context->m_system_bigram = new Bigram;
-    filename = g_build_filename(context->m_system_dir, SYSTEM_BIGRAM, NULL);
-    context->m_system_bigram->attach(filename, ATTACH_READONLY);
-    g_free(filename);
-
-    context->m_user_bigram = new Bigram;
-    filename = g_build_filename(context->m_user_dir, USER_BIGRAM, NULL);
-    context->m_user_bigram->load_db(filename);
-    g_free(filename);
+    /* load chewing table. */
+    context->m_pinyin_table = new FacadeChewingTable2;
+    _add_init_task(tasks, context, _load_pinyin_table, "pinyin_table");
 
-    gfloat lambda = context->m_system_table_info.get_lambda();
+    /* load phrase table */
+    context->m_phrase_table = new FacadePhraseTable3;
+    _add_init_task(tasks, context, _load_phrase_table, "phrase_table");
 
-    context->m_pinyin_lookup = new PinyinLookup2
-        ( lambda,
-          context->m_pinyin_table, context->m_phrase_index,
-          context->m_system_bigram, context->m_user_bigram);
+    context->m_system_bigram = new Bigram;
+    _add_init_task(tasks, context, _load_system_bigram, "system_bigram");
 
-    context->m_phrase_lookup = new PhraseLookup
-        (lambda,
-         context->m_phrase_table, context->m_phrase_index,
-         context->m_system_bigram, context->m_user_bigram);
+    context->m_user_bigram = new Bigram;
+    _add_init_task(tasks, context, _load_user_bigram, "user_bigram");
 
     /* load addon chewing table. */
     context->m_addon_pinyin_table = new FacadeChewingTable2;
-
-    system_filename = g_build_filename
-        (context->m_system_dir, ADDON_SYSTEM_PINYIN_INDEX, NULL);
-    context->m_addon_pinyin_table->load(system_filename, NULL);
-    g_free(system_filename);
+    _add_init_task(tasks, context, _load_addon_pinyin_table,
+                   "addon_pinyin_table");
 
     /* load addon phrase table */
     context->m_addon_phrase_table = new FacadePhraseTable3;
+    _add_init_task(tasks, context, _load_addon_phrase_table,
+                   "addon_phrase_table");
+
+    guint num_threads = std_lite::min
+        (max_init_threads, (guint) tasks->len);
+    GThreadPool * pool = NULL;
+    if (num_threads > 1)
+        pool = g_thread_pool_new(_run_init_task, NULL, num_threads,
+                                 TRUE, NULL);
+
+    for (size_t i = 0; i < tasks->len; ++i) {
+        init_task_t * task = (init_task_t *) g_ptr_array_index(tasks, i);
+        /* run in this thread without the thread pool. */
+        if (NULL == pool || !g_thread_pool_push(pool, task, NULL))
+            _run_init_task(task, NULL);
+    }
 
-    system_filename = g_build_filename
-        (context->m_system_dir, ADDON_SYSTEM_PHRASE_INDEX, NULL);
-    context->m_addon_phrase_table->load(system_filename, NULL);
-    g_free(system_filename);
+    /* wait for all loads, before the lookups use the tables. */
+    if (pool)
+        g_thread_pool_free(pool, FALSE, TRUE);
+
+    context->m_phrase_index = new FacadePhraseIndex;
+
+    for (size_t i = 0; i < tasks->len; ++i) {
+        init_task_t * task = (init_task_t *) g_ptr_array_index(tasks, i);
+
+        if (task->m_phrase_index) {
+            context->m_phrase_index->move_sub_phrase
+                (task->m_table_info->m_dict_index, task->m_phrase_index);
+            delete task->m_phrase_index;
+        }
+
+        _add_init_timing(context, task->m_component, task->m_usec);
+        delete task;
+    }
+    g_ptr_array_free(tasks, TRUE);
+
+    context->m_merged_bigram = new Bigram;
+    context->m_merged_bigram->attach(NULL, ATTACH_CREATE|ATTACH_READWRITE);
 
     context->m_addon_phrase_index = new FacadePhraseIndex;
 
     /* don't load addon phrase libraries. */
 
+    _add_init_timing(context, "total", g_get_monotonic_time() - start);
     return context;
 }
 
+bool pinyin_get_init_timing(pinyin_context_t * context,
+                            guint index,
+                            const char ** component,
+                            gint64 * usec){
+    GArray * timings = context->m_init_timings;
+    if (index >= timings->len)
+        return false;
+
+    init_timing_t * timing = &g_array_index(timings, init_timing_t, index);
+    *component = timing->m_component;
+    *usec = timing->m_usec;
+    return true;
+}
+
 bool pinyin_load_phrase_library(pinyin_context_t * context,
                                 guint8 index){
     if (!(index < PHRASE_INDEX_LIBRARY_COUNT))
@@ -412,6 +738,9 @@ bool pinyin_load_phrase_library(pinyin_context_t * context,
     assert(SYSTEM_FILE == table_info->m_file_type
            || USER_FILE == table_info->m_file_type);
 
+    ContextWriterLock lock(context);
+    _context_changed(context);
+
     return _load_phrase_library(context->m_system_dir, context->m_user_dir,
                                 phrase_index, table_info);
 }
@@ -425,7 +754,9 @@ bool pinyin_unload_phrase_library(pinyin_context_t * context,
     if (GBK_DICTIONARY != index)
         return false;
 
+    ContextWriterLock lock(context);
     context->m_phrase_index->unload(index);
+    _context_changed(context);
     return true;
 }
 
@@ -445,6 +776,7 @@ bool pinyin_load_addon_phrase_library(pinyin_context_t * context,
     /* Only DICTIONARY is allowed here. */
     assert(DICTIONARY == table_info->m_file_type);
 
+    ContextWriterLock lock(context);
     return _load_phrase_library(context->m_system_dir, context->m_user_dir,
                                 phrase_index, table_info);
 }
@@ -454,6 +786,7 @@ bool pinyin_unload_addon_phrase_library(pinyin_context_t * context,
     assert(index < PHRASE_INDEX_LIBRARY_COUNT);
 
     /* addon table. */
+    ContextWriterLock lock(context);
     context->m_addon_phrase_index->unload(index);
     return true;
 }
@@ -598,8 +931,11 @@ bool pinyin_iterator_add_phrase(import_iterator_t * iter,
     if (0 == phrase_length || phrase_length >= MAX_PHRASE_LENGTH)
         return result;
 
-    result = _add_phrase(context, index, keys,
-                         ucs4_phrase, phrase_length, count);
+    {
+        ContextWriterLock lock(context);
+        result = _add_phrase(context, index, keys,
+                             ucs4_phrase, phrase_length, count);
+    }
 
     g_array_free(key_rests, TRUE);
     g_array_free(keys, TRUE);
@@ -608,9 +944,13 @@ bool pinyin_iterator_add_phrase(import_iterator_t * iter,
 }
 
 void pinyin_end_add_phrases(import_iterator_t * iter){
-    /* compact the content memory chunk of phrase index. */
-    iter->m_context->m_phrase_index->compact();
-    iter->m_context->m_modified = true;
+    {
+        ContextWriterLock lock(iter->m_context);
+        /* compact the content memory chunk of phrase index. */
+        iter->m_context->m_phrase_index->compact();
+        _context_changed(iter->m_context);
+        iter->m_context->m_modified = true;
+    }
     delete iter;
 }
 
@@ -622,6 +962,8 @@ export_iterator_t * pinyin_begin_get_phrases(pinyin_context_t * context,
     iter->m_next_token = null_token;
     iter->m_next_pronunciation = 0;
 
+    ContextReaderLock lock(context);
+
     /* probe next token. */
     PhraseIndexRange range;
     int retval = iter->m_context->m_phrase_index->get_range
@@ -657,6 +999,8 @@ bool pinyin_iterator_get_next_phrase(export_iterator_t * iter,
     /* count "-1" means default count. */
     *phrase = NULL; *pinyin = NULL; *count = -1;
 
+    ContextReaderLock lock(iter->m_context);
+
     PhraseItem item;
     int retval = iter->m_context->m_phrase_index->get_phrase_item
         (iter->m_next_token, item);
@@ -727,15 +1071,60 @@ void pinyin_end_get_phrases(export_iterator_t * iter){
     delete iter;
 }
 
+/* must hold the writer lock. */
+static bool _clear_merged_bigram(pinyin_context_t * context){
+    Bigram * merged_bigram = context->m_merged_bigram;
+
+    GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    merged_bigram->get_all_items(items);
+
+    for (size_t i = 0; i < items->len; ++i) {
+        phrase_token_t token = g_array_index(items, phrase_token_t, i);
+        merged_bigram->remove(token);
+    }
+
+    g_array_free(items, TRUE);
+    return true;
+}
+
+/* merge the single grams of the tokens in both bi-grams ahead of time,
+   then the lookups skip the merge. must hold the writer lock. */
+static bool _materialize_merged_bigram(pinyin_context_t * context){
+    Bigram * merged_bigram = context->m_merged_bigram;
+    _clear_merged_bigram(context);
+
+    GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    context->m_user_bigram->get_all_items(items);
+
+    SingleGram system_view, user_view, merged_gram;
+    for (size_t i = 0; i < items->len; ++i) {
+        phrase_token_t token = g_array_index(items, phrase_token_t, i);
+
+        /* the single grams only in one bi-gram need no merge. */
+        if (!context->m_system_bigram->load_view(token, system_view))
+            continue;
+        if (!context->m_user_bigram->load_view(token, user_view))
+            continue;
+
+        if (!merge_single_gram(&merged_gram, &system_view, &user_view))
+            continue;
+
+        merged_bigram->store(token, &merged_gram);
+    }
+
+    g_array_free(items, TRUE);
+    return true;
+}
+
 bool pinyin_save(pinyin_context_t * context){
     if (!context->m_user_dir)
         return false;
 
+    ContextWriterLock lock(context);
+
     if (!context->m_modified)
         return false;
 
-    context->m_phrase_index->compact();
-
     const pinyin_table_info_t * phrase_files =
         context->m_system_table_info.get_default_tables();
 
@@ -760,6 +1149,23 @@ bool pinyin_save(pinyin_context_t * context){
         if (SYSTEM_FILE == table_info->m_file_type ||
             DICTIONARY == table_info->m_file_type) {
             /* system phrase library */
+            MemoryChunk * tail = new MemoryChunk;
+            bool journaled = context->m_phrase_index->flush_journal(i, tail);
+            gchar * journalpathname = _build_journal_pathname
+                (context->m_user_dir, userfilename);
+
+            /* only append the changes since the last save. */
+            if (journaled && !context->m_compact_journals &&
+                _append_journal(journalpathname, tail)) {
+                g_free(journalpathname);
+                delete tail;
+                continue;
+            }
+            delete tail;
+
+            /* compact the journal into the chunk log. */
+            context->m_phrase_index->compact(i);
+
             MemoryChunk * chunk = new MemoryChunk;
             MemoryChunk * log = new MemoryChunk;
             const char * systemfilename = table_info->m_system_filename;
@@ -797,10 +1203,17 @@ bool pinyin_save(pinyin_context_t * context){
             g_free(chunkpathname);
             g_free(tmppathname);
             delete log;
+
+            /* the chunk log contains the journal now. */
+            if (journaled)
+                unlink(journalpathname);
+            g_free(journalpathname);
         }
 
         if (USER_FILE == table_info->m_file_type) {
             /* user phrase library */
+            context->m_phrase_index->compact(i);
+
             MemoryChunk * chunk = new MemoryChunk;
             context->m_phrase_index->store(i, chunk);
 
@@ -826,6 +1239,8 @@ bool pinyin_save(pinyin_context_t * context){
         }
     }
 
+    context->m_compact_journals = false;
+
     /* save user pinyin table */
     gchar * tmpfilename = g_build_filename
         (context->m_user_dir, USER_PINYIN_INDEX ".tmp", NULL);
@@ -875,6 +1290,9 @@ bool pinyin_save(pinyin_context_t * context){
     g_free(tmpfilename);
     g_free(filename);
 
+    /* the merged single grams are the same as the cached ones. */
+    _materialize_merged_bigram(context);
+
     mark_version(context);
 
     context->m_modified = false;
@@ -883,18 +1301,22 @@ bool pinyin_save(pinyin_context_t * context){
 
 bool pinyin_set_full_pinyin_scheme(pinyin_context_t * context,
                                    FullPinyinScheme scheme){
+    ContextWriterLock lock(context);
     context->m_full_pinyin_parser->set_scheme(scheme);
     return true;
 }
 
 bool pinyin_set_double_pinyin_scheme(pinyin_context_t * context,
                                      DoublePinyinScheme scheme){
+    ContextWriterLock lock(context);
     context->m_double_pinyin_parser->set_scheme(scheme);
     return true;
 }
 
 bool pinyin_set_zhuyin_scheme(pinyin_context_t * context,
                                ZhuyinScheme scheme){
+    ContextWriterLock lock(context);
+
     delete context->m_chewing_parser;
     context->m_chewing_parser = NULL;
 
@@ -935,8 +1357,7 @@ void pinyin_fini(pinyin_context_t * context){
     delete context->m_phrase_index;
     delete context->m_system_bigram;
     delete context->m_user_bigram;
-    delete context->m_pinyin_lookup;
-    delete context->m_phrase_lookup;
+    delete context->m_merged_bigram;
     delete context->m_addon_pinyin_table;
     delete context->m_addon_phrase_table;
     delete context->m_addon_phrase_index;
@@ -945,16 +1366,23 @@ void pinyin_fini(pinyin_context_t * context){
     g_free(context->m_user_dir);
     context->m_modified = false;
 
+    g_array_free(context->m_init_timings, TRUE);
+    context->m_init_timings = NULL;
+
+    g_rw_lock_clear(&context->m_lock);
+
     delete context;
 }
 
 bool pinyin_mask_out(pinyin_context_t * context,
                      phrase_token_t mask,
                      phrase_token_t value) {
+    ContextWriterLock lock(context);
 
     context->m_pinyin_table->mask_out(mask, value);
     context->m_phrase_table->mask_out(mask, value);
     context->m_user_bigram->mask_out(mask, value);
+    _clear_merged_bigram(context);
 
     const pinyin_table_info_t * phrase_files =
         context->m_system_table_info.get_default_tables();
@@ -1010,6 +1438,19 @@ bool pinyin_mask_out(pinyin_context_t * context,
 
             /* merge the chunk log with mask. */
             context->m_phrase_index->merge_with_mask(index, log, mask, value);
+
+            if (SYSTEM_FILE == table_info->m_file_type) {
+                /* replay the journal with mask. */
+                chunkfilename = _build_journal_pathname
+                    (context->m_user_dir, userfilename);
+                MemoryChunk * journal = new MemoryChunk;
+                journal->load(chunkfilename);
+                g_free(chunkfilename);
+
+                context->m_phrase_index->replay_journal_with_mask
+                    (index, journal, mask, value);
+                context->m_phrase_index->start_journal(index);
+            }
         }
 
         if (USER_FILE == table_info->m_file_type) {
@@ -1019,12 +1460,76 @@ bool pinyin_mask_out(pinyin_context_t * context,
     }
 
     context->m_phrase_index->compact();
+    /* the journals still contain the masked phrase items. */
+    context->m_compact_journals = true;
+    _context_changed(context);
+    return true;
+}
+
+/* compact the sub phrase index when a quarter of the writable content
+   is unreachable. */
+static const size_t compact_min_dead_bytes = 4096;
+
+static bool _need_compact(size_t live_bytes, size_t total_bytes){
+    const size_t dead_bytes = total_bytes - live_bytes;
+    return dead_bytes >= compact_min_dead_bytes &&
+        dead_bytes * 4 >= total_bytes;
+}
+
+bool pinyin_get_phrase_library_usage(pinyin_context_t * context,
+                                     guint8 index,
+                                     gsize * live_bytes,
+                                     gsize * total_bytes){
+    if (!(index < PHRASE_INDEX_LIBRARY_COUNT))
+        return false;
+
+    ContextReaderLock lock(context);
+
+    size_t live = 0, total = 0;
+    if (!context->m_phrase_index->get_content_usage(index, live, total))
+        return false;
+
+    *live_bytes = live;
+    *total_bytes = total;
     return true;
 }
 
+bool pinyin_compact_step(pinyin_context_t * context){
+    /* try again later when the lookups hold the lock. */
+    if (!g_rw_lock_writer_trylock(&context->m_lock))
+        return true;
+
+    FacadePhraseIndex * phrase_index = context->m_phrase_index;
+    bool compacted = false, pending = false;
+
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        size_t live_bytes = 0, total_bytes = 0;
+        if (!phrase_index->get_content_usage(i, live_bytes, total_bytes))
+            continue;
+
+        if (!_need_compact(live_bytes, total_bytes))
+            continue;
+
+        /* only compact one sub phrase index in each step. */
+        if (compacted) {
+            pending = true;
+            break;
+        }
+
+        phrase_index->compact(i);
+        compacted = true;
+    }
+
+    /* the tokens and the frequencies are unchanged,
+       the instances keep their caches. */
+    g_rw_lock_writer_unlock(&context->m_lock);
+    return pending;
+}
+
 /* copy from options to context->m_options. */
 bool pinyin_set_options(pinyin_context_t * context,
                         pinyin_option_t options){
+    ContextWriterLock lock(context);
     context->m_options = options;
 #if 0
     context->m_pinyin_table->set_options(context->m_options);
@@ -1033,8 +1538,38 @@ bool pinyin_set_options(pinyin_context_t * context,
     return true;
 }
 
+bool pinyin_set_beam_options(pinyin_context_t * context,
+                             guint beam_width,
+                             gfloat beam_margin,
+                             guint long_input_length){
+    if (beam_margin < 0.)
+        return false;
+
+    ContextWriterLock lock(context);
+    context->m_beam_width = beam_width;
+    context->m_beam_margin = beam_margin;
+    context->m_long_input_length = long_input_length;
+
+    /* the instances apply the beam options when synced. */
+    _context_changed(context);
+    return true;
+}
+
+
+static bool _free_sentences(GPtrArray * sentences) {
+    for (size_t i = 0; i < sentences->len; ++i) {
+        MatchResults results = (MatchResults)
+            g_ptr_array_index(sentences, i);
+        g_array_free(results, TRUE);
+    }
+    g_ptr_array_set_size(sentences, 0);
+
+    return true;
+}
 
 pinyin_instance_t * pinyin_alloc_instance(pinyin_context_t * context){
+    ContextReaderLock lock(context);
+
     pinyin_instance_t * instance = new pinyin_instance_t;
     instance->m_context = context;
 
@@ -1048,6 +1583,30 @@ pinyin_instance_t * pinyin_alloc_instance(pinyin_context_t * context){
         g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
     instance->m_candidates =
         g_array_new(TRUE, TRUE, sizeof(lookup_candidate_t));
+    instance->m_sentences = g_ptr_array_new();
+
+    /* the tables are shared, the lookups are owned by the instance. */
+    instance->m_single_gram_cache = new SingleGramCache
+        (context->m_system_bigram, context->m_user_bigram,
+         1024, context->m_merged_bigram);
+
+    gfloat lambda = context->m_system_table_info.get_lambda();
+
+    instance->m_pinyin_lookup = new PinyinLookup2
+        ( lambda,
+          context->m_pinyin_table, context->m_phrase_index,
+          context->m_system_bigram, context->m_user_bigram,
+          instance->m_single_gram_cache);
+    instance->m_pinyin_lookup->set_beam_options
+        (context->m_beam_width, context->m_beam_margin,
+         context->m_long_input_length);
+
+    instance->m_phrase_lookup = new PhraseLookup
+        (lambda,
+         context->m_phrase_table, context->m_phrase_index,
+         context->m_system_bigram, context->m_user_bigram);
+
+    instance->m_generation = context->m_generation;
 
     return instance;
 }
@@ -1057,6 +1616,12 @@ void pinyin_free_instance(pinyin_instance_t * instance){
     g_array_free(instance->m_constraints, TRUE);
     g_array_free(instance->m_match_results, TRUE);
     g_array_free(instance->m_candidates, TRUE);
+    _free_sentences(instance->m_sentences);
+    g_ptr_array_free(instance->m_sentences, TRUE);
+
+    delete instance->m_pinyin_lookup;
+    delete instance->m_phrase_lookup;
+    delete instance->m_single_gram_cache;
 
     delete instance;
 }
@@ -1066,30 +1631,73 @@ pinyin_context_t * pinyin_get_context (pinyin_instance_t * instance){
 }
 
 static bool pinyin_update_constraints(pinyin_instance_t * instance){
-    pinyin_context_t * & context = instance->m_context;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
     CandidateConstraints & constraints = instance->m_constraints;
 
-    context->m_pinyin_lookup->validate_constraint
+    instance->m_pinyin_lookup->validate_constraint
         (&matrix, constraints);
 
     return true;
 }
 
 
+/* must hold the reader or writer lock. */
+static bool _guess_sentence(pinyin_instance_t * instance){
+    PhoneticKeyMatrix & matrix = instance->m_matrix;
+
+    _sync_instance(instance);
+
+    g_array_set_size(instance->m_prefixes, 0);
+    g_array_append_val(instance->m_prefixes, sentence_start);
+
+    pinyin_update_constraints(instance);
+    bool retval = instance->m_pinyin_lookup->get_best_match
+        (instance->m_prefixes,
+         &matrix,
+         instance->m_constraints,
+         instance->m_match_results,
+         &instance->m_search_cache);
+
+    return retval;
+}
+
 bool pinyin_guess_sentence(pinyin_instance_t * instance){
+    ContextReaderLock lock(instance->m_context);
+    return _guess_sentence(instance);
+}
+
+bool pinyin_guess_n_sentences(pinyin_instance_t * instance,
+                              guint nbest){
     pinyin_context_t * & context = instance->m_context;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
+    _free_sentences(instance->m_sentences);
+    if (0 == nbest)
+        return false;
+
+    ContextReaderLock lock(context);
+    _sync_instance(instance);
+
     g_array_set_size(instance->m_prefixes, 0);
     g_array_append_val(instance->m_prefixes, sentence_start);
 
     pinyin_update_constraints(instance);
-    bool retval = context->m_pinyin_lookup->get_best_match
-        (instance->m_prefixes,
+    bool retval = instance->m_pinyin_lookup->get_nbest_match
+        (nbest,
+         instance->m_prefixes,
          &matrix,
          instance->m_constraints,
-         instance->m_match_results);
+         instance->m_sentences,
+         &instance->m_search_cache);
+
+    if (!retval)
+        return retval;
+
+    /* the best sentence is also saved as the guessed sentence. */
+    MatchResults best = (MatchResults)
+        g_ptr_array_index(instance->m_sentences, 0);
+    g_array_set_size(instance->m_match_results, 0);
+    g_array_append_vals(instance->m_match_results, best->data, best->len);
 
     return retval;
 }
@@ -1132,17 +1740,21 @@ bool pinyin_guess_sentence_with_prefix(pinyin_instance_t * instance,
     pinyin_context_t * & context = instance->m_context;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
+    ContextReaderLock lock(context);
+    _sync_instance(instance);
+
     g_array_set_size(instance->m_prefixes, 0);
     g_array_append_val(instance->m_prefixes, sentence_start);
 
     _compute_prefixes(instance, prefix);
 
     pinyin_update_constraints(instance);
-    bool retval = context->m_pinyin_lookup->get_best_match
+    bool retval = instance->m_pinyin_lookup->get_best_match
         (instance->m_prefixes,
          &matrix,
          instance->m_constraints,
-         instance->m_match_results);
+         instance->m_match_results,
+         &instance->m_search_cache);
 
     return retval;
 }
@@ -1157,46 +1769,98 @@ bool pinyin_phrase_segment(pinyin_instance_t * instance,
 
     g_return_val_if_fail(num_of_chars == ucs4_len, FALSE);
 
-    bool retval = context->m_phrase_lookup->get_best_match
+    ContextReaderLock lock(context);
+    _sync_instance(instance);
+
+    bool retval = instance->m_phrase_lookup->get_best_match
         (ucs4_len, ucs4_str, instance->m_match_results);
 
     g_free(ucs4_str);
     return retval;
 }
 
+/* must hold the reader or writer lock. */
+static bool _get_sentence(pinyin_instance_t * instance,
+                          char ** sentence){
+    pinyin_context_t * & context = instance->m_context;
+
+    bool retval = pinyin::convert_to_utf8
+        (context->m_phrase_index, instance->m_match_results,
+         NULL, false, *sentence);
+
+    return retval;
+}
+
 /* the returned sentence should be freed by g_free(). */
 bool pinyin_get_sentence(pinyin_instance_t * instance,
                          char ** sentence){
+    ContextReaderLock lock(instance->m_context);
+    return _get_sentence(instance, sentence);
+}
+
+bool pinyin_get_n_sentence(pinyin_instance_t * instance,
+                           guint * num){
+    *num = instance->m_sentences->len;
+    return true;
+}
+
+/* the returned sentence should be freed by g_free(). */
+bool pinyin_get_nth_sentence(pinyin_instance_t * instance,
+                             guint index,
+                             char ** sentence){
     pinyin_context_t * & context = instance->m_context;
 
+    *sentence = NULL;
+    if (index >= instance->m_sentences->len)
+        return false;
+
+    ContextReaderLock lock(context);
+
+    MatchResults results = (MatchResults)
+        g_ptr_array_index(instance->m_sentences, index);
     bool retval = pinyin::convert_to_utf8
-        (context->m_phrase_index, instance->m_match_results,
+        (context->m_phrase_index, results,
          NULL, false, *sentence);
 
     return retval;
 }
 
+bool pinyin_get_beam_statistics(pinyin_instance_t * instance,
+                                guint64 * expanded,
+                                guint64 * width_pruned,
+                                guint64 * margin_pruned){
+    beam_statistics_t statistics;
+    if (!instance->m_pinyin_lookup->get_beam_statistics(statistics))
+        return false;
+
+    *expanded = statistics.m_expanded;
+    *width_pruned = statistics.m_width_pruned;
+    *margin_pruned = statistics.m_margin_pruned;
+    return true;
+}
+
 bool pinyin_parse_full_pinyin(pinyin_instance_t * instance,
                               const char * onepinyin,
                               ChewingKey * onekey){
     pinyin_context_t * & context = instance->m_context;
 
+    ContextReaderLock lock(context);
+
     int pinyin_len = strlen(onepinyin);
     bool retval = context->m_full_pinyin_parser->parse_one_key
         ( context->m_options, *onekey, onepinyin, pinyin_len);
     return retval;
 }
 
-size_t pinyin_parse_more_full_pinyins(pinyin_instance_t * instance,
-                                      const char * pinyins){
+/* must hold the reader or writer lock. */
+static size_t _parse_more_full_pinyins(pinyin_instance_t * instance,
+                                       ChewingKeyVector keys,
+                                       ChewingKeyRestVector key_rests,
+                                       const char * pinyins){
     pinyin_context_t * & context = instance->m_context;
     pinyin_option_t & options = context->m_options;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
-    ChewingKeyVector keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
-    ChewingKeyRestVector key_rests =
-        g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
-
     int parsed_len = context->m_full_pinyin_parser->parse
         (options, keys,
          key_rests, pinyins, strlen(pinyins));
@@ -1211,16 +1875,135 @@ size_t pinyin_parse_more_full_pinyins(pinyin_instance_t * instance,
 
     fuzzy_syllable_step(options, &matrix);
 
+    return parsed_len;
+}
+
+size_t pinyin_parse_more_full_pinyins(pinyin_instance_t * instance,
+                                      const char * pinyins){
+    ContextReaderLock lock(instance->m_context);
+
+    ChewingKeyVector keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+    ChewingKeyRestVector key_rests =
+        g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+
+    size_t parsed_len = _parse_more_full_pinyins
+        (instance, keys, key_rests, pinyins);
+
     g_array_free(key_rests, TRUE);
     g_array_free(keys, TRUE);
     return parsed_len;
 }
 
+/* the items of one worker, which re-uses the instance
+   and the key arrays for all its items. */
+struct convert_batch_worker_t{
+    pinyin_context_t * m_context;
+    const char * const * m_pinyins;
+    char ** m_sentences;
+    size_t m_num;
+
+    /* convert the items from m_first with the step of m_step. */
+    size_t m_first;
+    size_t m_step;
+
+    size_t m_converted;
+};
+
+static gpointer _convert_batch_thread(gpointer data){
+    convert_batch_worker_t * worker = (convert_batch_worker_t *) data;
+    pinyin_instance_t * instance = pinyin_alloc_instance(worker->m_context);
+
+    ChewingKeyVector keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+    ChewingKeyRestVector key_rests =
+        g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+
+    for (size_t i = worker->m_first; i < worker->m_num;
+         i += worker->m_step) {
+        worker->m_sentences[i] = NULL;
+        if (NULL == worker->m_pinyins[i])
+            continue;
+
+        pinyin_reset(instance);
+
+        /* hold the reader lock for one item, not for the whole batch. */
+        ContextReaderLock lock(worker->m_context);
+
+        _parse_more_full_pinyins
+            (instance, keys, key_rests, worker->m_pinyins[i]);
+
+        if (!_guess_sentence(instance))
+            continue;
+
+        if (_get_sentence(instance, worker->m_sentences + i))
+            ++worker->m_converted;
+    }
+
+    g_array_free(key_rests, TRUE);
+    g_array_free(keys, TRUE);
+    pinyin_free_instance(instance);
+    return NULL;
+}
+
+size_t pinyin_convert_batch(pinyin_context_t * context,
+                            const char * const pinyins[],
+                            size_t num,
+                            char * sentences[],
+                            guint num_of_threads){
+    if (0 == num_of_threads)
+        num_of_threads = 1;
+    if (num_of_threads > num)
+        num_of_threads = num;
+
+    if (num_of_threads <= 1) {
+        convert_batch_worker_t worker;
+        worker.m_context = context;
+        worker.m_pinyins = pinyins;
+        worker.m_sentences = sentences;
+        worker.m_num = num;
+        worker.m_first = 0;
+        worker.m_step = 1;
+        worker.m_converted = 0;
+
+        _convert_batch_thread(&worker);
+        return worker.m_converted;
+    }
+
+    convert_batch_worker_t * workers =
+        g_new0(convert_batch_worker_t, num_of_threads);
+    GThread ** threads = g_new0(GThread *, num_of_threads);
+
+    for (size_t i = 0; i < num_of_threads; ++i) {
+        convert_batch_worker_t * worker = workers + i;
+        worker->m_context = context;
+        worker->m_pinyins = pinyins;
+        worker->m_sentences = sentences;
+        worker->m_num = num;
+        worker->m_first = i;
+        worker->m_step = num_of_threads;
+        worker->m_converted = 0;
+
+        threads[i] = g_thread_new("pinyin_convert_batch",
+                                  _convert_batch_thread, worker);
+    }
+
+    size_t converted = 0;
+    for (size_t i = 0; i < num_of_threads; ++i) {
+        g_thread_join(threads[i]);
+        converted += workers[i].m_converted;
+    }
+
+    g_free(threads);
+    g_free(workers);
+    return converted;
+}
+
 bool pinyin_parse_double_pinyin(pinyin_instance_t * instance,
                                 const char * onepinyin,
                                 ChewingKey * onekey){
     pinyin_context_t * & context = instance->m_context;
 
+    ContextReaderLock lock(context);
+
     int pinyin_len = strlen(onepinyin);
     bool retval = context->m_double_pinyin_parser->parse_one_key
         ( context->m_options, *onekey, onepinyin, pinyin_len);
@@ -1233,6 +2016,8 @@ size_t pinyin_parse_more_double_pinyins(pinyin_instance_t * instance,
     pinyin_option_t & options = context->m_options;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
+    ContextReaderLock lock(context);
+
     ChewingKeyVector keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
     ChewingKeyRestVector key_rests =
         g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
@@ -1257,6 +2042,8 @@ bool pinyin_parse_chewing(pinyin_instance_t * instance,
                           ChewingKey * onekey){
     pinyin_context_t * & context = instance->m_context;
 
+    ContextReaderLock lock(context);
+
     int chewing_len = strlen(onechewing);
     bool retval = context->m_chewing_parser->parse_one_key
         ( context->m_options, *onekey, onechewing, chewing_len );
@@ -1269,6 +2056,8 @@ size_t pinyin_parse_more_chewings(pinyin_instance_t * instance,
     pinyin_option_t & options = context->m_options;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
+    ContextReaderLock lock(context);
+
     ChewingKeyVector keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
     ChewingKeyRestVector key_rests =
         g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
@@ -1295,6 +2084,9 @@ size_t pinyin_get_parsed_input_length(pinyin_instance_t * instance) {
 bool pinyin_in_chewing_keyboard(pinyin_instance_t * instance,
                                 const char key, gchar *** symbols) {
     pinyin_context_t * & context = instance->m_context;
+
+    ContextReaderLock lock(context);
+
     return context->m_chewing_parser->in_chewing_scheme
         (context->m_options, key, *symbols);
 }
@@ -1426,7 +2218,7 @@ static void _append_items(PhraseIndexRanges ranges,
 
 static void _compute_frequency_of_items(pinyin_context_t * context,
                                         phrase_token_t prev_token,
-                                        SingleGram * merged_gram,
+                                        const SingleGram * merged_gram,
                                         CandidateVector items) {
     pinyin_option_t & options = context->m_options;
     ssize_t i;
@@ -1488,7 +2280,7 @@ static bool _prepend_sentence_candidate(pinyin_instance_t * instance,
                                         CandidateVector candidates) {
     /* check whether the best match candidate exists. */
     gchar * sentence = NULL;
-    pinyin_get_sentence(instance, &sentence);
+    _get_sentence(instance, &sentence);
     if (NULL == sentence)
         return false;
     g_free(sentence);
@@ -1546,7 +2338,7 @@ static bool _compute_phrase_strings_of_items(pinyin_instance_t * instance,
         switch(candidate->m_candidate_type) {
         case BEST_MATCH_CANDIDATE: {
             gchar * sentence = NULL;
-            pinyin_get_sentence(instance, &sentence);
+            _get_sentence(instance, &sentence);
             candidate->m_phrase_string = sentence;
             break;
         }
@@ -1703,6 +2495,9 @@ bool pinyin_guess_candidates(pinyin_instance_t * instance,
     PhoneticKeyMatrix & matrix = instance->m_matrix;
     CandidateVector candidates = instance->m_candidates;
 
+    ContextReaderLock lock(context);
+    _sync_instance(instance);
+
     _free_candidates(candidates);
 
     if (0 == matrix.size())
@@ -1715,14 +2510,15 @@ bool pinyin_guess_candidates(pinyin_instance_t * instance,
         prev_token = _get_previous_token(instance, offset);
     }
 
-    SingleGram merged_gram;
-    SingleGram * system_gram = NULL, * user_gram = NULL;
+    /* the merged single gram is owned by the cache. */
+    SingleGram empty_gram;
+    const SingleGram * merged_gram = &empty_gram;
 
     if (options & DYNAMIC_ADJUST) {
         if (null_token != prev_token) {
-            context->m_system_bigram->load(prev_token, system_gram);
-            context->m_user_bigram->load(prev_token, user_gram);
-            merge_single_gram(&merged_gram, system_gram, user_gram);
+            if (!instance->m_single_gram_cache->load
+                (prev_token, merged_gram))
+                merged_gram = &empty_gram;
         }
     }
 
@@ -1741,12 +2537,13 @@ bool pinyin_guess_candidates(pinyin_instance_t * instance,
     for (size_t end = start + 1; end < matrix.size();) {
         /* do pinyin search. */
         context->m_phrase_index->clear_ranges(ranges);
-        int retval = search_matrix(context->m_pinyin_table, &matrix,
-                                   start, end, ranges);
+        int retval = instance->m_search_cache.search
+            (context->m_pinyin_table, &matrix, start, end, ranges);
 
         context->m_addon_phrase_index->clear_ranges(addon_ranges);
-        retval = search_matrix(context->m_addon_pinyin_table, &matrix,
-                               start, end, addon_ranges) | retval;
+        retval = instance->m_search_cache.search
+            (context->m_addon_pinyin_table, &matrix,
+             start, end, addon_ranges) | retval;
 
         if ( !(retval & SEARCH_OK) ) {
             ++end;
@@ -1786,16 +2583,12 @@ bool pinyin_guess_candidates(pinyin_instance_t * instance,
     }
 
     context->m_phrase_index->destroy_ranges(ranges);
-    if (system_gram)
-        delete system_gram;
-    if (user_gram)
-        delete user_gram;
 
     /* post process to sort the candidates */
 
     _compute_phrase_length(context, candidates);
 
-    _compute_frequency_of_items(context, prev_token, &merged_gram, candidates);
+    _compute_frequency_of_items(context, prev_token, merged_gram, candidates);
 
     /* sort the candidates by length and frequency. */
     g_array_sort(candidates, compare_item_with_length_and_frequency);
@@ -1819,6 +2612,9 @@ bool pinyin_guess_predicted_candidates(pinyin_instance_t * instance,
     FacadePhraseIndex * phrase_index = context->m_phrase_index;
     CandidateVector candidates = instance->m_candidates;
 
+    ContextReaderLock lock(context);
+    _sync_instance(instance);
+
     _free_candidates(candidates);
 
     _compute_prefixes(instance, prefix);
@@ -1827,17 +2623,16 @@ bool pinyin_guess_predicted_candidates(pinyin_instance_t * instance,
     if (null_token == prev_token)
         return false;
 
-    /* merge single gram. */
-    SingleGram merged_gram;
-    SingleGram * system_gram = NULL, * user_gram = NULL;
-    context->m_system_bigram->load(prev_token, system_gram);
-    context->m_user_bigram->load(prev_token, user_gram);
-    merge_single_gram(&merged_gram, system_gram, user_gram);
+    /* the merged single gram is owned by the cache. */
+    SingleGram empty_gram;
+    const SingleGram * merged_gram = &empty_gram;
+    if (!instance->m_single_gram_cache->load(prev_token, merged_gram))
+        merged_gram = &empty_gram;
 
     /* retrieve all items. */
     BigramPhraseWithCountArray tokens = g_array_new
         (FALSE, FALSE, sizeof(BigramPhraseItemWithCount));
-    merged_gram.retrieve_all(tokens);
+    merged_gram->retrieve_all(tokens);
 
     /* sort the longer word first. */
     PhraseItem cached_item;
@@ -1866,16 +2661,11 @@ bool pinyin_guess_predicted_candidates(pinyin_instance_t * instance,
 
     }
 
-    if (system_gram)
-        delete system_gram;
-    if (user_gram)
-        delete user_gram;
-
     /* post process to sort the candidates */
 
     _compute_phrase_length(context, candidates);
 
-    _compute_frequency_of_items(context, prev_token, &merged_gram, candidates);
+    _compute_frequency_of_items(context, prev_token, merged_gram, candidates);
 
     /* sort the candidates by length and frequency. */
     g_array_sort(candidates, compare_item_with_length_and_frequency);
@@ -1900,6 +2690,9 @@ int pinyin_choose_candidate(pinyin_instance_t * instance,
     if (BEST_MATCH_CANDIDATE == candidate->m_candidate_type)
         return matrix.size() - 1;
 
+    ContextWriterLock lock(context);
+    _sync_instance(instance);
+
     if (ADDON_CANDIDATE == candidate->m_candidate_type) {
         PhraseItem item;
         context->m_addon_phrase_index->get_phrase_item
@@ -1925,6 +2718,8 @@ int pinyin_choose_candidate(pinyin_instance_t * instance,
         item.get_phrase_string(phrase);
         context->m_phrase_table->add_index(len, phrase, token);
         context->m_phrase_index->add_phrase_item(token, &item);
+        _context_changed(context);
+        _sync_instance(instance);
 
         /* update the candidate. */
         candidate->m_candidate_type = NORMAL_CANDIDATE;
@@ -1932,16 +2727,16 @@ int pinyin_choose_candidate(pinyin_instance_t * instance,
     }
 
     /* sync m_constraints to the length of m_pinyin_keys. */
-    bool retval = context->m_pinyin_lookup->validate_constraint
+    bool retval = instance->m_pinyin_lookup->validate_constraint
         (&matrix, instance->m_constraints);
 
     phrase_token_t token = candidate->m_token;
-    guint8 len = context->m_pinyin_lookup->add_constraint
+    guint8 len = instance->m_pinyin_lookup->add_constraint
         (instance->m_constraints,
          candidate->m_begin, candidate->m_end, token);
 
     /* safe guard: validate the m_constraints again. */
-    retval = context->m_pinyin_lookup->validate_constraint
+    retval = instance->m_pinyin_lookup->validate_constraint
         (&matrix, instance->m_constraints) && len;
 
     return offset + len;
@@ -1957,6 +2752,9 @@ bool pinyin_choose_predicted_candidate(pinyin_instance_t * instance,
     pinyin_context_t * & context = instance->m_context;
     FacadePhraseIndex * & phrase_index = context->m_phrase_index;
 
+    ContextWriterLock lock(context);
+    _sync_instance(instance);
+
     /* train uni-gram */
     phrase_token_t token = candidate->m_token;
     int error = phrase_index->add_unigram_frequency
@@ -1964,6 +2762,9 @@ bool pinyin_choose_predicted_candidate(pinyin_instance_t * instance,
     if (ERROR_INTEGER_OVERFLOW == error)
         return false;
 
+    instance->m_pinyin_lookup->invalidate_steps();
+    _instance_changed(instance);
+
     phrase_token_t prev_token = _get_previous_token(instance, 0);
     if (null_token == prev_token)
         return false;
@@ -1985,15 +2786,15 @@ bool pinyin_choose_predicted_candidate(pinyin_instance_t * instance,
     }
     assert(user_gram->set_total_freq(total_freq + initial_seed));
     context->m_user_bigram->store(prev_token, user_gram);
+    instance->m_single_gram_cache->invalidate(prev_token);
+    _instance_changed(instance);
     delete user_gram;
     return true;
 }
 
 bool pinyin_clear_constraint(pinyin_instance_t * instance,
                              size_t offset){
-    pinyin_context_t * & context = instance->m_context;
-
-    bool retval = context->m_pinyin_lookup->clear_constraint
+    bool retval = instance->m_pinyin_lookup->clear_constraint
         (instance->m_constraints, offset);
 
     return retval;
@@ -2004,6 +2805,8 @@ bool pinyin_lookup_tokens(pinyin_instance_t * instance,
     pinyin_context_t * & context = instance->m_context;
     FacadePhraseIndex * & phrase_index = context->m_phrase_index;
 
+    ContextReaderLock lock(context);
+
     glong ucs4_len = 0;
     ucs4_t * ucs4_phrase = g_utf8_to_ucs4(phrase, -1, NULL, &ucs4_len, NULL);
 
@@ -2024,11 +2827,16 @@ bool pinyin_train(pinyin_instance_t * instance){
     pinyin_context_t * context = instance->m_context;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
+    ContextWriterLock lock(context);
+    _sync_instance(instance);
+
     context->m_modified = true;
 
-    bool retval = context->m_pinyin_lookup->train_result2
+    /* invalidate the trained single grams of the instance. */
+    bool retval = instance->m_pinyin_lookup->train_result2
         (&matrix, instance->m_constraints,
          instance->m_match_results);
+    _instance_changed(instance);
 
     return retval;
 }
@@ -2041,6 +2849,8 @@ bool pinyin_reset(pinyin_instance_t * instance){
     g_array_set_size(instance->m_constraints, 0);
     g_array_set_size(instance->m_match_results, 0);
     _free_candidates(instance->m_candidates);
+    _free_sentences(instance->m_sentences);
+    instance->m_search_cache.reset();
 
     return true;
 }
@@ -2120,6 +2930,8 @@ bool pinyin_token_get_phrase(pinyin_instance_t * instance,
                              gchar ** utf8_str) {
     pinyin_context_t * & context = instance->m_context;
 
+    ContextReaderLock lock(context);
+
     return _token_get_phrase(context->m_phrase_index,
                              token, len, utf8_str);
 }
@@ -2129,13 +2941,16 @@ bool pinyin_token_get_n_pronunciation(pinyin_instance_t * instance,
                                       guint * num){
     *num = 0;
     pinyin_context_t * & context = instance->m_context;
-    PhraseItem item;
+    phrase_hot_item_t item;
 
-    int retval = context->m_phrase_index->get_phrase_item(token, item);
+    ContextReaderLock lock(context);
+
+    /* only the header fields are read. */
+    int retval = context->m_phrase_index->get_hot_item(token, item);
     if (ERROR_OK != retval)
         return false;
 
-    *num = item.get_n_pronunciation();
+    *num = item.m_n_pronunciation;
     return true;
 }
 
@@ -2149,6 +2964,8 @@ bool pinyin_token_get_nth_pronunciation(pinyin_instance_t * instance,
     ChewingKey buffer[MAX_PHRASE_LENGTH];
     guint32 freq = 0;
 
+    ContextReaderLock lock(context);
+
     int retval = context->m_phrase_index->get_phrase_item(token, item);
     if (ERROR_OK != retval)
         return false;
@@ -2164,13 +2981,16 @@ bool pinyin_token_get_unigram_frequency(pinyin_instance_t * instance,
                                         guint * freq) {
     *freq = 0;
     pinyin_context_t * & context = instance->m_context;
-    PhraseItem item;
+    phrase_hot_item_t item;
 
-    int retval = context->m_phrase_index->get_phrase_item(token, item);
+    ContextReaderLock lock(context);
+
+    /* only the header fields are read. */
+    int retval = context->m_phrase_index->get_hot_item(token, item);
     if (ERROR_OK != retval)
         return false;
 
-    *freq = item.get_unigram_frequency();
+    *freq = item.m_unigram_frequency;
     return true;
 }
 
@@ -2178,8 +2998,11 @@ bool pinyin_token_add_unigram_frequency(pinyin_instance_t * instance,
                                         phrase_token_t token,
                                         guint delta){
     pinyin_context_t * & context = instance->m_context;
+
+    ContextWriterLock lock(context);
     int retval = context->m_phrase_index->add_unigram_frequency
         (token, delta);
+    _context_changed(context);
     return ERROR_OK == retval;
 }
 
@@ -2548,6 +3371,8 @@ bool pinyin_get_character_offset(pinyin_instance_t * instance,
     size_t length = 0;
     const size_t start = 0;
 
+    ContextReaderLock lock(context);
+
     /* pre-compute the tokens vector from phrase. */
     TokenVector cached_tokens = g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
 
@@ -3008,6 +3833,8 @@ bool pinyin_remember_user_input(pinyin_instance_t * instance,
 
     const size_t start = 0;
 
+    ContextWriterLock lock(context);
+
     /* pre-compute the tokens vector from phrase. */
     TokenVector cached_tokens = g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
 
@@ -3027,6 +3854,7 @@ bool pinyin_remember_user_input(pinyin_instance_t * instance,
     bool result = _remember_phrase_recur
         (instance, cached_keys, cached_tokens,
          start, ucs4_phrase, count);
+    _context_changed(context);
 
     g_array_free(cached_tokens, TRUE);
     g_array_free(cached_keys, TRUE);
@@ -3061,6 +3889,8 @@ bool pinyin_remove_user_candidate(pinyin_instance_t * instance,
     guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
     assert(USER_DICTIONARY == index);
 
+    ContextWriterLock lock(context);
+
     /* remove from phrase index */
     PhraseItem * item = NULL;
     int retval = phrase_index->remove_phrase_item(token, item);
@@ -3088,6 +3918,8 @@ bool pinyin_remove_user_candidate(pinyin_instance_t * instance,
     /* remove from user bigram */
     phrase_token_t mask = PHRASE_INDEX_LIBRARY_MASK | PHRASE_MASK;
     user_bigram->mask_out(mask, token);
+    _clear_merged_bigram(context);
+    _context_changed(context);
 
     return true;
 }
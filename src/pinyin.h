@@ -59,6 +59,23 @@ typedef enum _lookup_candidate_type_t{
  */
 pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir);
 
+/**
+ * pinyin_get_init_timing:
+ * @context: the pinyin context.
+ * @index: the index of the component.
+ * @component: the name of the loaded component.
+ * @usec: the load time of the component in microseconds.
+ * @returns: whether the component exists.
+ *
+ * Get the load time of the components in pinyin_init, the components
+ * are loaded concurrently, and the last component is the "total".
+ *
+ */
+bool pinyin_get_init_timing(pinyin_context_t * context,
+                            guint index,
+                            const char ** component,
+                            gint64 * usec);
+
 /**
  * pinyin_load_phrase_library:
  * @context: the pinyin context.
@@ -201,6 +218,36 @@ void pinyin_end_get_phrases(export_iterator_t * iter);
  */
 bool pinyin_save(pinyin_context_t * context);
 
+/**
+ * pinyin_get_phrase_library_usage:
+ * @context: the pinyin context.
+ * @index: the phrase library index.
+ * @live_bytes: the bytes of the reachable phrase items.
+ * @total_bytes: the bytes of the writable phrase content.
+ * @returns: whether the phrase library is loaded.
+ *
+ * Get the fragmentation of the phrase library, the unreachable bytes
+ * are left behind by the changed phrase items.
+ *
+ */
+bool pinyin_get_phrase_library_usage(pinyin_context_t * context,
+                                     guint8 index,
+                                     gsize * live_bytes,
+                                     gsize * total_bytes);
+
+/**
+ * pinyin_compact_step:
+ * @context: the pinyin context.
+ * @returns: whether more phrase libraries need the compaction.
+ *
+ * Compact one fragmented phrase library, suitable for the idle callback.
+ *
+ * Note: this step is skipped without blocking when the lookups are
+ *   running, and the caller should try again later.
+ *
+ */
+bool pinyin_compact_step(pinyin_context_t * context);
+
 /**
  * pinyin_set_full_pinyin_scheme:
  * @context: the pinyin context.
@@ -274,6 +321,26 @@ bool pinyin_mask_out(pinyin_context_t * context,
 bool pinyin_set_options(pinyin_context_t * context,
                         pinyin_option_t options);
 
+/**
+ * pinyin_set_beam_options:
+ * @context: the pinyin context.
+ * @beam_width: the maximum number of the expanded hypotheses in each step,
+ *              0 for the default.
+ * @beam_margin: the log possibility margin below the best hypothesis
+ *               in each step, 0 to disable.
+ * @long_input_length: the length of the pinyin input, after which
+ *                     the beam width shrinks in proportion, 0 to disable.
+ * @returns: whether the set beam options succeeded.
+ *
+ * Set the beam pruning of the sentence guess, which trades
+ * a little accuracy for the bounded latency on the slow devices.
+ *
+ */
+bool pinyin_set_beam_options(pinyin_context_t * context,
+                             guint beam_width,
+                             gfloat beam_margin,
+                             guint long_input_length);
+
 /**
  * pinyin_alloc_instance:
  * @context: the pinyin context.
@@ -281,6 +348,10 @@ bool pinyin_set_options(pinyin_context_t * context,
  *
  * Allocate a new pinyin instance from the context.
  *
+ * Note: the instances of one context can be used from different
+ *   threads, while each instance is used by one thread at a time.
+ *   The context data is shared, and each instance owns its lookups.
+ *
  */
 pinyin_instance_t * pinyin_alloc_instance(pinyin_context_t * context);
 
@@ -325,6 +396,20 @@ bool pinyin_guess_sentence(pinyin_instance_t * instance);
 bool pinyin_guess_sentence_with_prefix(pinyin_instance_t * instance,
                                        const char * prefix);
 
+/**
+ * pinyin_guess_n_sentences:
+ * @instance: the pinyin instance.
+ * @nbest: the maximum number of the sentences.
+ * @returns: whether the sentences are guessed successfully.
+ *
+ * Guess the n-best sentences from the saved pinyin keys in the instance.
+ *
+ * Note: the best sentence is also saved for pinyin_get_sentence.
+ *
+ */
+bool pinyin_guess_n_sentences(pinyin_instance_t * instance,
+                              guint nbest);
+
 /**
  * pinyin_guess_predicted_candidates:
  * @instance: the pinyin instance.
@@ -363,6 +448,72 @@ bool pinyin_phrase_segment(pinyin_instance_t * instance,
 bool pinyin_get_sentence(pinyin_instance_t * instance,
                          char ** sentence);
 
+/**
+ * pinyin_get_n_sentence:
+ * @instance: the pinyin instance.
+ * @num: the number of the guessed n-best sentences.
+ * @returns: whether the get operation is successful.
+ *
+ * Get the number of the n-best sentences from the instance.
+ *
+ */
+bool pinyin_get_n_sentence(pinyin_instance_t * instance,
+                           guint * num);
+
+/**
+ * pinyin_get_nth_sentence:
+ * @instance: the pinyin instance.
+ * @index: the index of the n-best sentences.
+ * @sentence: the n-th sentence in the instance.
+ * @returns: whether the get operation is successful.
+ *
+ * Get the n-th sentence of the n-best sentences, sorted from the best.
+ *
+ * Note: the returned sentence should be freed by g_free().
+ *
+ */
+bool pinyin_get_nth_sentence(pinyin_instance_t * instance,
+                             guint index,
+                             char ** sentence);
+
+/**
+ * pinyin_get_beam_statistics:
+ * @instance: the pinyin instance.
+ * @expanded: the number of the expanded hypotheses.
+ * @width_pruned: the number of the hypotheses skipped by the beam width.
+ * @margin_pruned: the number of the hypotheses skipped by the beam margin.
+ * @returns: whether the get operation is successful.
+ *
+ * Get the counters of the beam pruning, accumulated since
+ * the instance is allocated.
+ *
+ */
+bool pinyin_get_beam_statistics(pinyin_instance_t * instance,
+                                guint64 * expanded,
+                                guint64 * width_pruned,
+                                guint64 * margin_pruned);
+
+/**
+ * pinyin_convert_batch:
+ * @context: the pinyin context.
+ * @pinyins: the full pinyin strings to be converted.
+ * @num: the number of the full pinyin strings.
+ * @sentences: the converted sentences, NULL if failed.
+ * @num_of_threads: the number of the worker threads, 0 or 1 for none.
+ * @returns: the number of the converted sentences.
+ *
+ * Convert the full pinyin strings to the best sentences in batch,
+ * the parser buffers and the lookups are re-used across the items.
+ *
+ * Note: the returned sentences should be freed by g_free().
+ *
+ */
+size_t pinyin_convert_batch(pinyin_context_t * context,
+                            const char * const pinyins[],
+                            size_t num,
+                            char * sentences[],
+                            guint num_of_threads);
+
 /**
  * pinyin_parse_full_pinyin:
  * @instance: the pinyin instance.
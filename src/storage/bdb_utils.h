@@ -23,7 +23,10 @@
 #define BDB_UTILS_H
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <db.h>
+#include "memory_chunk.h"
 
 namespace pinyin{
 
@@ -40,6 +43,85 @@ inline u_int32_t attach_options(guint32 flags) {
     return db_flags;
 }
 
+/* Note:
+ *   the database handles shared by the threads are opened with
+ *   DB_THREAD, then the returned keys and data must be in the memory
+ *   owned by the caller, see DB_DBT_USERMEM and DB_DBT_REALLOC.
+ */
+
+/* read the value into the chunk, which is owned by the caller. */
+inline int get_bdb_chunk(DB * db, DBT * db_key, MemoryChunk & chunk) {
+    /* drop the borrowed memory, the chunk always owns its memory. */
+    chunk.set_size(0);
+    chunk.set_size(1);
+
+    DBT db_data;
+    memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_USERMEM;
+    db_data.data = chunk.begin();
+    db_data.ulen = chunk.capacity();
+
+    int ret = db->get(db, NULL, db_key, &db_data, 0);
+    if (DB_BUFFER_SMALL == ret) {
+        chunk.set_size(db_data.size);
+        db_data.data = chunk.begin();
+        db_data.ulen = chunk.capacity();
+        ret = db->get(db, NULL, db_key, &db_data, 0);
+    }
+
+    chunk.set_size(0 == ret ? db_data.size : 0);
+    return ret;
+}
+
+/* read the record at the cursor into the chunk,
+   the key is read into the memory of db_key, see DB_DBT_USERMEM. */
+inline int get_bdb_cursor_chunk(DBC * cursorp, DBT * db_key,
+                                MemoryChunk & chunk, u_int32_t flags) {
+    chunk.set_size(0);
+    chunk.set_size(1);
+
+    DBT db_data;
+    memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_USERMEM;
+    db_data.data = chunk.begin();
+    db_data.ulen = chunk.capacity();
+
+    int ret = cursorp->c_get(cursorp, db_key, &db_data, flags);
+    /* the cursor is unchanged on failure. */
+    if (DB_BUFFER_SMALL == ret) {
+        chunk.set_size(db_data.size);
+        db_data.data = chunk.begin();
+        db_data.ulen = chunk.capacity();
+        ret = cursorp->c_get(cursorp, db_key, &db_data, flags);
+    }
+
+    chunk.set_size(0 == ret ? db_data.size : 0);
+    return ret;
+}
+
+/* check the key without reading the value. */
+inline bool exists_bdb_key(DB * db, DBT * db_key) {
+    DBT db_data;
+    memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+    db_data.dlen = 0;
+    db_data.doff = 0;
+
+    return 0 == db->get(db, NULL, db_key, &db_data, 0);
+}
+
+/* the cursor reads into the memory re-allocated by itself,
+   free it after the iteration. */
+inline void init_cursor_dbt(DBT * dbt) {
+    memset(dbt, 0, sizeof(DBT));
+    dbt->flags = DB_DBT_REALLOC;
+}
+
+inline void fini_cursor_dbt(DBT * dbt) {
+    free(dbt->data);
+    memset(dbt, 0, sizeof(DBT));
+}
+
 
 inline bool copy_bdb(DB * srcdb, DB * destdb) {
     int ret = 0;
@@ -53,16 +135,27 @@ inline bool copy_bdb(DB * srcdb, DB * destdb) {
         return false;
 
     /* Initialize our DBTs. */
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
+    init_cursor_dbt(&key);
+    init_cursor_dbt(&data);
 
     /* Iterate over the database, retrieving each record in turn. */
     while ((ret = cursorp->c_get(cursorp, &key, &data, DB_NEXT)) == 0) {
-        ret = destdb->put(destdb, NULL, &key, &data, 0);
+        DBT put_key, put_data;
+        memset(&put_key, 0, sizeof(DBT));
+        put_key.data = key.data;
+        put_key.size = key.size;
+        memset(&put_data, 0, sizeof(DBT));
+        put_data.data = data.data;
+        put_data.size = data.size;
+
+        ret = destdb->put(destdb, NULL, &put_key, &put_data, 0);
         assert(0 == ret);
     }
     assert(DB_NOTFOUND == ret);
 
+    fini_cursor_dbt(&key);
+    fini_cursor_dbt(&data);
+
     /* Cursors must be closed */
     if ( cursorp != NULL )
         cursorp->c_close(cursorp);
@@ -157,27 +157,179 @@ int ChewingLargeTable2::search(int phrase_length,
                                /* in */ const ChewingKey keys[],
                                /* out */ PhraseIndexRanges ranges) const {
     ChewingKey index[MAX_PHRASE_LENGTH];
-    assert(NULL != m_db);
+    assert(NULL != m_db || NULL != m_packed_table);
 
     if (contains_incomplete_pinyin(keys, phrase_length)) {
         compute_incomplete_chewing_index(keys, index, phrase_length);
-        return search_internal(phrase_length, index, keys, ranges);
+        return search_internal(phrase_length, index, keys, 1, ranges);
     } else {
         compute_chewing_index(keys, index, phrase_length);
-        return search_internal(phrase_length, index, keys, ranges);
+        return search_internal(phrase_length, index, keys, 1, ranges);
     }
 
     return SEARCH_NONE;
 }
 
+/* the chewing index of one key sequence in the batch. */
+struct chewing_batch_item_t{
+    ChewingKey m_index[MAX_PHRASE_LENGTH];
+    const ChewingKey * m_keys;
+};
+
+static gint compare_batch_item(gconstpointer lhs, gconstpointer rhs,
+                               gpointer user_data) {
+    const chewing_batch_item_t * lhs_item =
+        (const chewing_batch_item_t *) lhs;
+    const chewing_batch_item_t * rhs_item =
+        (const chewing_batch_item_t *) rhs;
+    const int phrase_length = GPOINTER_TO_INT(user_data);
+
+    return memcmp(lhs_item->m_index, rhs_item->m_index,
+                  phrase_length * sizeof(ChewingKey));
+}
+
+int ChewingLargeTable2::search_batch(int phrase_length,
+                                     /* in */ const ChewingKey keys[],
+                                     /* in */ size_t num,
+                                     /* out */ PhraseIndexRanges ranges) const {
+    assert(NULL != m_db || NULL != m_packed_table);
+
+    if (0 == num)
+        return SEARCH_NONE;
+
+    if (1 == num)
+        return search(phrase_length, keys, ranges);
+
+    GArray * items = g_array_sized_new
+        (FALSE, TRUE, sizeof(chewing_batch_item_t), num);
+    g_array_set_size(items, num);
+
+    for (size_t i = 0; i < num; ++i) {
+        chewing_batch_item_t * item =
+            &g_array_index(items, chewing_batch_item_t, i);
+        item->m_keys = keys + i * phrase_length;
+
+        if (contains_incomplete_pinyin(item->m_keys, phrase_length))
+            compute_incomplete_chewing_index
+                (item->m_keys, item->m_index, phrase_length);
+        else
+            compute_chewing_index
+                (item->m_keys, item->m_index, phrase_length);
+    }
+
+    /* sort by the chewing index, to load each index only once,
+       in the same order as the keys of the database. */
+    g_array_sort_with_data(items, compare_batch_item,
+                           GINT_TO_POINTER(phrase_length));
+
+    /* collect the distinct chewing indexes in the order,
+       and the number of the key sequences sharing each index. */
+    GArray * indexes = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+    GArray * group = g_array_sized_new
+        (FALSE, FALSE, sizeof(ChewingKey), num * phrase_length);
+    GArray * counts = g_array_new(FALSE, FALSE, sizeof(guint));
+
+    for (size_t i = 0; i < items->len; ++i) {
+        const chewing_batch_item_t * item =
+            &g_array_index(items, chewing_batch_item_t, i);
+
+        const ChewingKey * last = indexes->len ? (ChewingKey *)
+            indexes->data + indexes->len - phrase_length : NULL;
+        if (NULL == last || 0 != memcmp(last, item->m_index,
+                                        phrase_length * sizeof(ChewingKey))) {
+            g_array_append_vals(indexes, item->m_index, phrase_length);
+            guint count = 0;
+            g_array_append_val(counts, count);
+        }
+
+        g_array_append_vals(group, item->m_keys, phrase_length);
+        ++g_array_index(counts, guint, counts->len - 1);
+    }
+
+    int result = SEARCH_NONE;
+    if (m_packed_table) {
+        /* the packed chewing table is searched by index. */
+        const ChewingKey * keys_begin = (ChewingKey *) group->data;
+        for (size_t i = 0; i < counts->len; ++i) {
+            const guint count = g_array_index(counts, guint, i);
+            result |= search_internal
+                (phrase_length,
+                 (ChewingKey *) indexes->data + i * phrase_length,
+                 keys_begin, count, ranges);
+            keys_begin += count * phrase_length;
+        }
+    } else {
+        result = search_sorted_internal
+            (phrase_length, (ChewingKey *) indexes->data, counts->len,
+             (ChewingKey *) group->data, (guint *) counts->data, ranges);
+    }
+
+    g_array_free(counts, TRUE);
+    g_array_free(group, TRUE);
+    g_array_free(indexes, TRUE);
+    g_array_free(items, TRUE);
+    return result;
+}
+
+int ChewingLargeTable2::search_entry_internal(int phrase_length,
+                                              /* in */ const void * buffer,
+                                              /* in */ size_t length,
+                                              /* in */ const ChewingKey keys[],
+                                              /* in */ size_t num,
+                                              /* out */ PhraseIndexRanges ranges) const {
+    int result = SEARCH_NONE;
+
+#define CASE(len) case len:                                             \
+    {                                                                   \
+        /* the local entry borrows the buffer. */                       \
+        ChewingTableEntry<len> entry;                                   \
+        entry.m_chunk.set_chunk((void *) buffer, length, NULL);         \
+                                                                        \
+        for (size_t i = 0; i < num; ++i)                                \
+            result = entry.search(keys + i * len, ranges) | result;     \
+                                                                        \
+        return result;                                                  \
+    }
+
+    switch(phrase_length) {
+        CASE(1);
+        CASE(2);
+        CASE(3);
+        CASE(4);
+        CASE(5);
+        CASE(6);
+        CASE(7);
+        CASE(8);
+        CASE(9);
+        CASE(10);
+        CASE(11);
+        CASE(12);
+        CASE(13);
+        CASE(14);
+        CASE(15);
+        CASE(16);
+    default:
+        assert(false);
+    }
+
+#undef CASE
+
+    return result;
+}
+
 /* add/remove index method */
 int ChewingLargeTable2::add_index(int phrase_length,
                                   /* in */ const ChewingKey keys[],
                                   /* in */ phrase_token_t token) {
     ChewingKey index[MAX_PHRASE_LENGTH];
-    assert(NULL != m_db);
     int result = ERROR_OK;
 
+    /* the packed chewing table is read-only. */
+    if (NULL != m_packed_table)
+        return ERROR_FILE_CORRUPTION;
+
+    assert(NULL != m_db);
+
     /* for in-complete chewing index */
     compute_incomplete_chewing_index(keys, index, phrase_length);
     result = add_index_internal(phrase_length, index, keys, token);
@@ -196,9 +348,14 @@ int ChewingLargeTable2::remove_index(int phrase_length,
                                      /* in */ const ChewingKey keys[],
                                      /* in */ phrase_token_t token) {
     ChewingKey index[MAX_PHRASE_LENGTH];
-    assert(NULL != m_db);
     int result = ERROR_OK;
 
+    /* the packed chewing table is read-only. */
+    if (NULL != m_packed_table)
+        return ERROR_FILE_CORRUPTION;
+
+    assert(NULL != m_db);
+
     /* for in-complete chewing index */
     compute_incomplete_chewing_index(keys, index, phrase_length);
     result = remove_index_internal(phrase_length, index, keys, token);
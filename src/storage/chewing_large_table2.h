@@ -67,9 +67,14 @@ public:
         int result = SEARCH_NONE;
         /* TODO: check the below code */
         cursor.m_range_begin = null_token; cursor.m_range_end = null_token;
-        for (iter = begin; iter != end; ++iter) {
-            if (0 != pinyin_compare_with_tones
-                (keys, iter->m_keys, phrase_length))
+        const PinyinIndexItemMatcher<phrase_length> matcher(keys);
+        guint32 matched = 0; size_t num = 0;
+        for (iter = begin; iter != end; ++iter, matched >>= 1, --num) {
+            /* match the next index items at once. */
+            if (0 == num)
+                matched = matcher.match(iter, end, num);
+
+            if (0 == (matched & 1))
                 continue;
 
             phrase_token_t token = iter->m_token;
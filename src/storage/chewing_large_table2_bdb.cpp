@@ -22,6 +22,8 @@
 #include "chewing_large_table2.h"
 #include <errno.h>
 #include "bdb_utils.h"
+#include "thread_chunk.h"
+#include "chewing_large_table2_packed.h"
 
 namespace pinyin{
 
@@ -31,10 +33,13 @@ ChewingLargeTable2::ChewingLargeTable2() {
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE|DB_THREAD, 0600);
     assert(0 == ret);
 
+    m_packed_table = NULL;
+
     m_entries = NULL;
     init_entries();
 }
@@ -46,6 +51,11 @@ void ChewingLargeTable2::reset() {
         m_db = NULL;
     }
 
+    if (m_packed_table) {
+        delete m_packed_table;
+        m_packed_table = NULL;
+    }
+
     fini_entries();
 }
 
@@ -63,14 +73,33 @@ bool ChewingLargeTable2::attach(const char * dbfile, guint32 flags) {
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, dbfile, NULL,
-                     DB_BTREE, db_flags, 0644);
+                     DB_BTREE, db_flags|DB_THREAD, 0644);
     if (ret != 0)
         return false;
 
     return true;
 }
 
+bool ChewingLargeTable2::attach_packed(const char * filename) {
+    reset();
+
+    init_entries();
+
+    if (!filename)
+        return false;
+
+    m_packed_table = new PackedChewingTable;
+    if (!m_packed_table->attach(filename)) {
+        delete m_packed_table;
+        m_packed_table = NULL;
+        return false;
+    }
+
+    return true;
+}
+
 /* load/store method */
 bool ChewingLargeTable2::load_db(const char * filename) {
     reset();
@@ -81,8 +110,9 @@ bool ChewingLargeTable2::load_db(const char * filename) {
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE|DB_THREAD, 0600);
     if (ret != 0)
         return false;
 
@@ -137,34 +167,90 @@ bool ChewingLargeTable2::store_db(const char * new_filename) {
     return true;
 }
 
+bool ChewingLargeTable2::store_packed(const char * new_filename) {
+    if (NULL == m_db)
+        return false;
+
+    DBC * cursorp = NULL;
+    DBT db_key, db_data;
+
+    /* Get a cursor */
+    m_db->cursor(m_db, NULL, &cursorp, 0);
+
+    if (NULL == cursorp)
+        return false;
+
+    /* Initialize our DBTs. */
+    init_cursor_dbt(&db_key);
+    init_cursor_dbt(&db_data);
+
+    PackedChewingTableWriter writer;
+
+    /* Iterate over the database, retrieving each record in turn. */
+    int ret = 0;
+    while((ret = cursorp->c_get(cursorp, &db_key, &db_data, DB_NEXT)) == 0) {
+        int phrase_length = db_key.size / sizeof(ChewingKey);
+
+        writer.add_entry(phrase_length, (ChewingKey *) db_key.data,
+                         db_data.data, db_data.size);
+    }
+    assert(ret == DB_NOTFOUND);
+
+    fini_cursor_dbt(&db_key);
+    fini_cursor_dbt(&db_data);
+
+    /* Cursors must be closed */
+    if (cursorp != NULL)
+        cursorp->c_close(cursorp);
+
+    return writer.save(new_filename);
+}
+
 template<int phrase_length>
 int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
                                         /* in */ const ChewingKey keys[],
+                                        /* in */ size_t num,
                                         /* out */ PhraseIndexRanges ranges) const {
     int result = SEARCH_NONE;
 
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
+    /* the local entry keeps the search re-entrant. */
+    ChewingTableEntry<phrase_length> entry;
+
+    if (m_packed_table) {
+        void * buffer = NULL; size_t length = 0;
+        if (!m_packed_table->load(phrase_length, index, buffer, length))
+            return result;
+
+        /* continue searching. */
+        result |= SEARCH_CONTINUED;
+
+        entry.m_chunk.set_chunk(buffer, length, NULL);
+
+        for (size_t i = 0; i < num; ++i)
+            result = entry.search
+                (keys + i * phrase_length, ranges) | result;
+
+        return result;
+    }
 
     DBT db_key;
     memset(&db_key, 0, sizeof(DBT));
     db_key.data = (void *) index;
     db_key.size = phrase_length * sizeof(ChewingKey);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    /* read into the per-thread buffer, as the handle is shared. */
+    MemoryChunk * chunk = get_thread_chunk();
+    int ret = get_bdb_chunk(m_db, &db_key, *chunk);
     if (ret != 0)
         return result;
 
     /* continue searching. */
     result |= SEARCH_CONTINUED;
 
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    entry.m_chunk.set_chunk(chunk->begin(), chunk->size(), NULL);
 
-    result = entry->search(keys, ranges) | result;
+    for (size_t i = 0; i < num; ++i)
+        result = entry.search(keys + i * phrase_length, ranges) | result;
 
     return result;
 }
@@ -172,10 +258,11 @@ int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
 int ChewingLargeTable2::search_internal(int phrase_length,
                                         /* in */ const ChewingKey index[],
                                         /* in */ const ChewingKey keys[],
+                                        /* in */ size_t num,
                                         /* out */ PhraseIndexRanges ranges) const {
 #define CASE(len) case len:                                     \
     {                                                           \
-        return search_internal<len>(index, keys, ranges);       \
+        return search_internal<len>(index, keys, num, ranges);  \
     }
 
     switch(phrase_length) {
@@ -204,6 +291,89 @@ int ChewingLargeTable2::search_internal(int phrase_length,
     return SEARCH_NONE;
 }
 
+/* compare the keys in the order of the B-tree, see bt_compare_fcn. */
+static int compare_chewing_index(const void * lhs, size_t lhs_size,
+                                 const void * rhs, size_t rhs_size) {
+    int result = memcmp(lhs, rhs, std_lite::min(lhs_size, rhs_size));
+    if (0 != result)
+        return result;
+
+    if (lhs_size == rhs_size)
+        return 0;
+    return lhs_size < rhs_size ? -1 : 1;
+}
+
+int ChewingLargeTable2::search_sorted_internal(int phrase_length,
+                                               /* in */ const ChewingKey indexes[],
+                                               /* in */ size_t num_indexes,
+                                               /* in */ const ChewingKey keys[],
+                                               /* in */ const guint counts[],
+                                               /* out */ PhraseIndexRanges ranges) const {
+    int result = SEARCH_NONE;
+
+    DBC * cursorp = NULL;
+    m_db->cursor(m_db, NULL, &cursorp, 0);
+
+    if (NULL == cursorp)
+        return result;
+
+    const size_t index_size = phrase_length * sizeof(ChewingKey);
+
+    /* the key at the cursor, read into the caller-owned memory. */
+    ChewingKey found[MAX_PHRASE_LENGTH];
+    DBT db_key;
+    memset(&db_key, 0, sizeof(DBT));
+    db_key.flags = DB_DBT_USERMEM;
+    db_key.ulen = sizeof(found);
+
+    MemoryChunk * chunk = get_thread_chunk();
+    size_t found_size = 0;
+
+    for (size_t i = 0; i < num_indexes; ++i) {
+        const ChewingKey * index = indexes + i * phrase_length;
+        const ChewingKey * group = keys;
+        const guint num = counts[i];
+        keys += num * phrase_length;
+
+        /* the cursor is at the first key not less than the previous
+           index, so the indexes before the key are missing. */
+        int cmp = 1;
+        if (found_size)
+            cmp = compare_chewing_index(index, index_size,
+                                        found, found_size);
+
+        if (cmp > 0) {
+            memcpy(found, index, index_size);
+            db_key.data = found;
+            db_key.size = index_size;
+
+            int ret = get_bdb_cursor_chunk(cursorp, &db_key,
+                                           *chunk, DB_SET_RANGE);
+            /* no more keys after the index. */
+            if (ret != 0)
+                break;
+
+            found_size = db_key.size;
+            cmp = compare_chewing_index(index, index_size,
+                                        found, found_size);
+        }
+
+        if (cmp < 0)
+            continue;
+
+        /* continue searching. */
+        result |= SEARCH_CONTINUED;
+
+        result |= search_entry_internal(phrase_length, chunk->begin(),
+                                        chunk->size(), group, num, ranges);
+    }
+
+    /* Cursors must be closed */
+    cursorp->c_close(cursorp);
+
+    return result;
+}
+
 
 template<int phrase_length>
 int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
@@ -220,10 +390,9 @@ int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
     db_key.data = (void *) index;
     db_key.size = phrase_length * sizeof(ChewingKey);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    int ret = get_bdb_chunk(m_db, &db_key, entry->m_chunk);
 
+    DBT db_data;
     if (ret != 0) {
         /* new entry. */
         ChewingTableEntry<phrase_length> new_entry;
@@ -242,11 +411,8 @@ int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
             db_key.data = (void *) index;
             db_key.size = len * sizeof(ChewingKey);
 
-            memset(&db_data, 0, sizeof(DBT));
-
-            ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
             /* found entry. */
-            if (0 == ret)
+            if (exists_bdb_key(m_db, &db_key))
                 return ERROR_OK;
 
             /* new entry with empty content. */
@@ -261,7 +427,6 @@ int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
     }
 
     /* already have keys. */
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
     int result = entry->add_index(keys, token);
 
     /* store the entry. */
@@ -326,19 +491,16 @@ int ChewingLargeTable2::remove_index_internal(/* in */ const ChewingKey index[],
     db_key.data = (void *) index;
     db_key.size = phrase_length * sizeof(ChewingKey);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    int ret = get_bdb_chunk(m_db, &db_key, entry->m_chunk);
     if (ret != 0)
         return ERROR_REMOVE_ITEM_DONOT_EXISTS;
 
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
-
     int result = entry->remove_index(keys, token);
     if (ERROR_OK != result)
         return result;
 
     /* removed the token. */
+    DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
     db_data.data = entry->m_chunk.begin();
     db_data.size = entry->m_chunk.size();
@@ -388,8 +550,12 @@ int ChewingLargeTable2::remove_index_internal(int phrase_length,
 /* mask out method */
 bool ChewingLargeTable2::mask_out(phrase_token_t mask,
                                   phrase_token_t value) {
+    /* the packed chewing table is read-only. */
+    if (m_packed_table)
+        return false;
+
     DBC * cursorp = NULL;
-    DBT db_key, db_data;
+    DBT db_key, db_data, new_data;
 
     /* Get a cursor */
     m_db->cursor(m_db, NULL, &cursorp, 0);
@@ -398,8 +564,8 @@ bool ChewingLargeTable2::mask_out(phrase_token_t mask,
         return false;
 
     /* Initialize our DBTs. */
-    memset(&db_key, 0, sizeof(DBT));
-    memset(&db_data, 0, sizeof(DBT));
+    init_cursor_dbt(&db_key);
+    init_cursor_dbt(&db_data);
 
     /* Iterate over the database, retrieving each record in turn. */
     int ret = 0;
@@ -417,11 +583,11 @@ bool ChewingLargeTable2::mask_out(phrase_token_t mask,
                                                                         \
             entry->mask_out(mask, value);                               \
                                                                         \
-            memset(&db_data, 0, sizeof(DBT));                           \
-            db_data.data = entry->m_chunk.begin();                      \
-            db_data.size = entry->m_chunk.size();                       \
+            memset(&new_data, 0, sizeof(DBT));                          \
+            new_data.data = entry->m_chunk.begin();                     \
+            new_data.size = entry->m_chunk.size();                      \
             int ret = cursorp->put                                      \
-                (cursorp, &db_key, &db_data,  DB_CURRENT);              \
+                (cursorp, &db_key, &new_data,  DB_CURRENT);             \
             assert(ret == 0);                                           \
             break;                                                      \
         }
@@ -452,6 +618,9 @@ bool ChewingLargeTable2::mask_out(phrase_token_t mask,
     }
     assert(ret == DB_NOTFOUND);
 
+    fini_cursor_dbt(&db_key);
+    fini_cursor_dbt(&db_data);
+
     /* Cursors must be closed */
     if (cursorp != NULL)
         cursorp->c_close(cursorp);
@@ -23,6 +23,7 @@
 #include <kchashdb.h>
 #include <kcprotodb.h>
 #include "kyotodb_utils.h"
+#include "chewing_large_table2_packed.h"
 
 using namespace kyotocabinet;
 
@@ -33,6 +34,8 @@ ChewingLargeTable2::ChewingLargeTable2() {
     m_db = new ProtoTreeDB;
     assert(m_db->open("-", BasicDB::OREADER|BasicDB::OWRITER|BasicDB::OCREATE));
 
+    m_packed_table = NULL;
+
     m_entries = NULL;
     init_entries();
 }
@@ -45,6 +48,11 @@ void ChewingLargeTable2::reset() {
         m_db = NULL;
     }
 
+    if (m_packed_table) {
+        delete m_packed_table;
+        m_packed_table = NULL;
+    }
+
     fini_entries();
 }
 
@@ -64,6 +72,24 @@ bool ChewingLargeTable2::attach(const char * dbfile, guint32 flags) {
     return m_db->open(dbfile, mode);
 }
 
+bool ChewingLargeTable2::attach_packed(const char * filename) {
+    reset();
+
+    init_entries();
+
+    if (!filename)
+        return false;
+
+    m_packed_table = new PackedChewingTable;
+    if (!m_packed_table->attach(filename)) {
+        delete m_packed_table;
+        m_packed_table = NULL;
+        return false;
+    }
+
+    return true;
+}
+
 /* load/store method */
 /* use in-memory DBM here, for better performance. */
 bool ChewingLargeTable2::load_db(const char * filename) {
@@ -110,16 +136,64 @@ bool ChewingLargeTable2::store_db(const char * new_filename) {
     return true;
 }
 
+/* collect the chewing indexes for the packed chewing table. */
+class PackedVisitor2 : public DB::Visitor {
+    PackedChewingTableWriter * m_writer;
+public:
+    PackedVisitor2(PackedChewingTableWriter * writer) {
+        m_writer = writer;
+    }
+
+    virtual const char* visit_full(const char* kbuf, size_t ksiz,
+                                   const char* vbuf, size_t vsiz, size_t* sp) {
+        int phrase_length = ksiz / sizeof(ChewingKey);
+        m_writer->add_entry(phrase_length, (ChewingKey *) kbuf, vbuf, vsiz);
+        return NOP;
+    }
+
+    virtual const char* visit_empty(const char* kbuf, size_t ksiz, size_t* sp) {
+        return NOP;
+    }
+};
+
+bool ChewingLargeTable2::store_packed(const char * new_filename) {
+    if (NULL == m_db)
+        return false;
+
+    PackedChewingTableWriter writer;
+    PackedVisitor2 visitor(&writer);
+    m_db->iterate(&visitor, false);
+
+    return writer.save(new_filename);
+}
+
 template<int phrase_length>
 int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
                                         /* in */ const ChewingKey keys[],
+                                        /* in */ size_t num,
                                         /* out */ PhraseIndexRanges ranges) const {
     int result = SEARCH_NONE;
 
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
+    /* the local entry keeps the search re-entrant,
+       and borrows the per-thread buffer. */
+    ChewingTableEntry<phrase_length> entry;
+
+    if (m_packed_table) {
+        void * buffer = NULL; size_t length = 0;
+        if (!m_packed_table->load(phrase_length, index, buffer, length))
+            return result;
+
+        /* continue searching. */
+        result |= SEARCH_CONTINUED;
+
+        entry.m_chunk.set_chunk(buffer, length, NULL);
+
+        for (size_t i = 0; i < num; ++i)
+            result = entry.search
+                (keys + i * phrase_length, ranges) | result;
+
+        return result;
+    }
 
     const char * kbuf = (char *) index;
     const int32_t vsiz = m_db->check(kbuf, phrase_length * sizeof(ChewingKey));
@@ -132,13 +206,16 @@ int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
     if (0 == vsiz)
         return result;
 
-    entry->m_chunk.set_size(vsiz);
-    /* m_chunk may re-allocate here. */
-    char * vbuf = (char *) entry->m_chunk.begin();
+    MemoryChunk * chunk = get_thread_chunk();
+    chunk->set_size(vsiz);
+    /* chunk may re-allocate here. */
+    char * vbuf = (char *) chunk->begin();
     assert(vsiz == m_db->get(kbuf, phrase_length * sizeof(ChewingKey),
                              vbuf, vsiz));
+    entry.m_chunk.set_chunk(vbuf, vsiz, NULL);
 
-    result = entry->search(keys, ranges) | result;
+    for (size_t i = 0; i < num; ++i)
+        result = entry.search(keys + i * phrase_length, ranges) | result;
 
     return result;
 }
@@ -146,10 +223,11 @@ int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
 int ChewingLargeTable2::search_internal(int phrase_length,
                                         /* in */ const ChewingKey index[],
                                         /* in */ const ChewingKey keys[],
+                                        /* in */ size_t num,
                                         /* out */ PhraseIndexRanges ranges) const {
-#define CASE(len) case len:                                 \
-    {                                                       \
-        return search_internal<len>(index, keys, ranges);   \
+#define CASE(len) case len:                                     \
+    {                                                           \
+        return search_internal<len>(index, keys, num, ranges);  \
     }
 
     switch(phrase_length) {
@@ -178,6 +256,106 @@ int ChewingLargeTable2::search_internal(int phrase_length,
     return SEARCH_NONE;
 }
 
+/* compare the keys in the lexical order of the tree database. */
+static int compare_chewing_index(const void * lhs, size_t lhs_size,
+                                 const void * rhs, size_t rhs_size) {
+    int result = memcmp(lhs, rhs, std_lite::min(lhs_size, rhs_size));
+    if (0 != result)
+        return result;
+
+    if (lhs_size == rhs_size)
+        return 0;
+    return lhs_size < rhs_size ? -1 : 1;
+}
+
+/* read the record at the cursor into the caller-owned memory. */
+class CursorVisitor2 : public DB::Visitor {
+    ChewingKey * m_key;
+    size_t m_key_size;
+    MemoryChunk * m_chunk;
+public:
+    CursorVisitor2(ChewingKey * key, MemoryChunk * chunk) {
+        m_key = key;
+        m_key_size = 0;
+        m_chunk = chunk;
+    }
+
+    size_t get_key_size() const {
+        return m_key_size;
+    }
+
+    virtual const char* visit_full(const char* kbuf, size_t ksiz,
+                                   const char* vbuf, size_t vsiz, size_t* sp) {
+        assert(ksiz <= MAX_PHRASE_LENGTH * sizeof(ChewingKey));
+        memcpy(m_key, kbuf, ksiz);
+        m_key_size = ksiz;
+
+        m_chunk->set_size(0);
+        /* the empty value uses the dummy pointer. */
+        if (vsiz)
+            m_chunk->set_content(0, vbuf, vsiz);
+        return NOP;
+    }
+
+    virtual const char* visit_empty(const char* kbuf, size_t ksiz, size_t* sp) {
+        return NOP;
+    }
+};
+
+int ChewingLargeTable2::search_sorted_internal(int phrase_length,
+                                               /* in */ const ChewingKey indexes[],
+                                               /* in */ size_t num_indexes,
+                                               /* in */ const ChewingKey keys[],
+                                               /* in */ const guint counts[],
+                                               /* out */ PhraseIndexRanges ranges) const {
+    int result = SEARCH_NONE;
+
+    BasicDB::Cursor * cursor = m_db->cursor();
+    const size_t index_size = phrase_length * sizeof(ChewingKey);
+
+    ChewingKey found[MAX_PHRASE_LENGTH];
+    MemoryChunk * chunk = get_thread_chunk();
+    CursorVisitor2 visitor(found, chunk);
+
+    for (size_t i = 0; i < num_indexes; ++i) {
+        const ChewingKey * index = indexes + i * phrase_length;
+        const ChewingKey * group = keys;
+        const guint num = counts[i];
+        keys += num * phrase_length;
+
+        /* the cursor is at the first key not less than the previous
+           index, so the indexes before the key are missing. */
+        int cmp = 1;
+        if (visitor.get_key_size())
+            cmp = compare_chewing_index(index, index_size,
+                                        found, visitor.get_key_size());
+
+        if (cmp > 0) {
+            /* no more keys after the index. */
+            if (!cursor->jump((const char *) index, index_size))
+                break;
+
+            if (!cursor->accept(&visitor, false, false))
+                break;
+
+            cmp = compare_chewing_index(index, index_size,
+                                        found, visitor.get_key_size());
+        }
+
+        if (cmp < 0)
+            continue;
+
+        /* continue searching. */
+        result |= SEARCH_CONTINUED;
+
+        result |= search_entry_internal(phrase_length, chunk->begin(),
+                                        chunk->size(), group, num, ranges);
+    }
+
+    delete cursor;
+    return result;
+}
+
 template<int phrase_length>
 int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
                                            /* in */ const ChewingKey keys[],
@@ -417,6 +595,10 @@ public:
 /* mask out method */
 bool ChewingLargeTable2::mask_out(phrase_token_t mask,
                                   phrase_token_t value) {
+    /* the packed chewing table is read-only. */
+    if (m_packed_table)
+        return false;
+
     MaskOutVisitor2 visitor(m_entries, mask, value);
     m_db->iterate(&visitor, true);
 
@@ -32,11 +32,16 @@ namespace pinyin{
 template<int phrase_length>
 class ChewingTableEntry;
 
+class PackedChewingTable;
+
 class ChewingLargeTable2{
 private:
     /* member variables. */
     kyotocabinet::BasicDB * m_db;
 
+    /* the read-only packed chewing table, instead of the database. */
+    PackedChewingTable * m_packed_table;
+
 protected:
     /* Array of ChewingTableEntry. */
     GPtrArray * m_entries;
@@ -48,16 +53,36 @@ protected:
     void reset();
 
 protected:
+    /* search the num key sequences, which share the same index. */
     template<int phrase_length>
     int search_internal(/* in */ const ChewingKey index[],
                         /* in */ const ChewingKey keys[],
+                        /* in */ size_t num,
                         /* out */ PhraseIndexRanges ranges) const;
 
     int search_internal(int phrase_length,
                         /* in */ const ChewingKey index[],
                         /* in */ const ChewingKey keys[],
+                        /* in */ size_t num,
                         /* out */ PhraseIndexRanges ranges) const;
 
+    /* search the loaded entry content with the num key sequences. */
+    int search_entry_internal(int phrase_length,
+                              /* in */ const void * buffer,
+                              /* in */ size_t length,
+                              /* in */ const ChewingKey keys[],
+                              /* in */ size_t num,
+                              /* out */ PhraseIndexRanges ranges) const;
+
+    /* search the sorted distinct indexes with one cursor,
+       the counts[i] key sequences share the i-th index. */
+    int search_sorted_internal(int phrase_length,
+                               /* in */ const ChewingKey indexes[],
+                               /* in */ size_t num_indexes,
+                               /* in */ const ChewingKey keys[],
+                               /* in */ const guint counts[],
+                               /* out */ PhraseIndexRanges ranges) const;
+
     template<int phrase_length>
     int add_index_internal(/* in */ const ChewingKey index[],
                            /* in */ const ChewingKey keys[],
@@ -88,18 +113,28 @@ public:
     /* attach method */
     bool attach(const char * dbfile, guint32 flags);
 
+    /* attach the read-only packed chewing table, see PackedChewingTable. */
+    bool attach_packed(const char * filename);
+
     /* load/store method */
     /* use in-memory DBM here, for better performance. */
     bool load_db(const char * filename);
 
     bool store_db(const char * new_filename);
 
+    bool store_packed(const char * new_filename);
+
     bool load_text(FILE * infile);
 
     /* search method */
     int search(int phrase_length, /* in */ const ChewingKey keys[],
                /* out */ PhraseIndexRanges ranges) const;
 
+    /* search the num key sequences of the same length in one sweep. */
+    int search_batch(int phrase_length, /* in */ const ChewingKey keys[],
+                     /* in */ size_t num,
+                     /* out */ PhraseIndexRanges ranges) const;
+
     /* add/remove index method */
     int add_index(int phrase_length, /* in */ const ChewingKey keys[],
                   /* in */ phrase_token_t token);
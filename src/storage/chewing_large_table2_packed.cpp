@@ -0,0 +1,254 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "chewing_large_table2_packed.h"
+#include <assert.h>
+#include <string.h>
+
+using namespace pinyin;
+
+/* the header of the chewing index begins and the index numbers. */
+static const size_t packed_chewing_table_header =
+    sizeof(guint32) * (MAX_PHRASE_LENGTH + 1) * 2;
+
+/* the size of the sorted chewing indexes, padded to guint32. */
+static size_t compute_index_size(int phrase_length, size_t num){
+    size_t size = phrase_length * sizeof(ChewingKey) * num;
+    return (size + sizeof(guint32) - 1) / sizeof(guint32) * sizeof(guint32);
+}
+
+PackedChewingTable::PackedChewingTable(){
+    m_chunk = NULL;
+    reset();
+}
+
+PackedChewingTable::~PackedChewingTable(){
+    reset();
+}
+
+void PackedChewingTable::reset(){
+    if (m_chunk) {
+        delete m_chunk;
+        m_chunk = NULL;
+    }
+
+    m_table_begins = NULL;
+    m_table_lengths = NULL;
+    memset(m_offsets, 0, sizeof(m_offsets));
+}
+
+bool PackedChewingTable::attach(const char * filename){
+    reset();
+
+    MemoryChunk * chunk = new MemoryChunk;
+#ifdef LIBPINYIN_USE_MMAP
+    if (!chunk->mmap(filename)) {
+#else
+    if (!chunk->load(filename)) {
+#endif
+        delete chunk;
+        return false;
+    }
+
+    if (chunk->size() < packed_chewing_table_header) {
+        delete chunk;
+        return false;
+    }
+
+    const guint32 * begins = (const guint32 *) chunk->begin();
+    const guint32 * lengths = begins + MAX_PHRASE_LENGTH + 1;
+
+    /* validate the sorted indexes and the offset tables. */
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        const size_t num = lengths[len];
+        const size_t offsets_begin =
+            begins[len] + compute_index_size(len, num);
+        const size_t table_end =
+            offsets_begin + (num + 1) * sizeof(guint32);
+
+        if (chunk->size() < table_end) {
+            delete chunk;
+            return false;
+        }
+
+        const guint32 * offsets = (const guint32 *)
+            ((const char *) chunk->begin() + offsets_begin);
+        if (chunk->size() < offsets[num]) {
+            delete chunk;
+            return false;
+        }
+
+        m_offsets[len] = offsets;
+    }
+
+    m_chunk = chunk;
+    m_table_begins = begins;
+    m_table_lengths = lengths;
+    return true;
+}
+
+bool PackedChewingTable::load(int phrase_length,
+                              /* in */ const ChewingKey index[],
+                              /* out */ void * & buffer,
+                              /* out */ size_t & length) const{
+    assert(0 < phrase_length && phrase_length <= MAX_PHRASE_LENGTH);
+
+    if (NULL == m_chunk)
+        return false;
+
+    const size_t key_size = phrase_length * sizeof(ChewingKey);
+    const char * indexes = (const char *) m_chunk->begin() +
+        m_table_begins[phrase_length];
+
+    size_t lower = 0, upper = m_table_lengths[phrase_length];
+    while (lower < upper) {
+        const size_t middle = lower + (upper - lower) / 2;
+        const int result = memcmp(indexes + middle * key_size,
+                                  index, key_size);
+
+        if (result < 0) {
+            lower = middle + 1;
+        } else if (result > 0) {
+            upper = middle;
+        } else {
+            const guint32 * offset = m_offsets[phrase_length] + middle;
+            buffer = (char *) m_chunk->begin() + offset[0];
+            length = offset[1] - offset[0];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+struct packed_chewing_record_t{
+    ChewingKey m_index[MAX_PHRASE_LENGTH];
+    /* the content in PackedChewingTableWriter::m_contents. */
+    guint32 m_begin;
+    guint32 m_length;
+};
+
+static gint compare_record(gconstpointer lhs, gconstpointer rhs,
+                           gpointer user_data){
+    const packed_chewing_record_t * lhs_record =
+        (const packed_chewing_record_t *) lhs;
+    const packed_chewing_record_t * rhs_record =
+        (const packed_chewing_record_t *) rhs;
+    const int phrase_length = GPOINTER_TO_INT(user_data);
+
+    return memcmp(lhs_record->m_index, rhs_record->m_index,
+                  phrase_length * sizeof(ChewingKey));
+}
+
+PackedChewingTableWriter::PackedChewingTableWriter(){
+    m_records[0] = NULL;
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+        m_records[len] = g_array_new
+            (FALSE, TRUE, sizeof(packed_chewing_record_t));
+}
+
+PackedChewingTableWriter::~PackedChewingTableWriter(){
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        g_array_free(m_records[len], TRUE);
+        m_records[len] = NULL;
+    }
+}
+
+bool PackedChewingTableWriter::add_entry(int phrase_length,
+                                         /* in */ const ChewingKey index[],
+                                         /* in */ const void * buffer,
+                                         /* in */ size_t length){
+    if (phrase_length <= 0 || phrase_length > MAX_PHRASE_LENGTH)
+        return false;
+
+    packed_chewing_record_t record;
+    memset(&record, 0, sizeof(record));
+    memcpy(record.m_index, index, phrase_length * sizeof(ChewingKey));
+    record.m_begin = m_contents.size();
+    record.m_length = length;
+
+    m_contents.append_content(buffer, length);
+    g_array_append_val(m_records[phrase_length], record);
+    return true;
+}
+
+bool PackedChewingTableWriter::save(const char * filename){
+    guint32 begins[MAX_PHRASE_LENGTH + 1];
+    guint32 lengths[MAX_PHRASE_LENGTH + 1];
+    begins[0] = 0; lengths[0] = 0;
+
+    /* compute the begin of the chewing indexes of each phrase length. */
+    size_t table_end = packed_chewing_table_header;
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        GArray * records = m_records[len];
+        g_array_sort_with_data(records, compare_record, GINT_TO_POINTER(len));
+
+        begins[len] = table_end;
+        lengths[len] = records->len;
+        table_end += compute_index_size(len, records->len) +
+            (records->len + 1) * sizeof(guint32);
+    }
+
+    MemoryChunk chunk;
+    chunk.append_content(begins, sizeof(begins));
+    chunk.append_content(lengths, sizeof(lengths));
+
+    /* the contents follow the tables in the sorted order. */
+    guint32 data_end = table_end;
+    const guint32 zero = 0;
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        GArray * records = m_records[len];
+
+        for (size_t i = 0; i < records->len; ++i) {
+            packed_chewing_record_t * record =
+                &g_array_index(records, packed_chewing_record_t, i);
+            chunk.append_content(record->m_index, len * sizeof(ChewingKey));
+        }
+
+        const size_t index_size = len * sizeof(ChewingKey) * records->len;
+        chunk.append_content
+            (&zero, compute_index_size(len, records->len) - index_size);
+
+        for (size_t i = 0; i < records->len; ++i) {
+            packed_chewing_record_t * record =
+                &g_array_index(records, packed_chewing_record_t, i);
+            chunk.append_content(&data_end, sizeof(guint32));
+            data_end += record->m_length;
+        }
+        chunk.append_content(&data_end, sizeof(guint32));
+    }
+
+    assert(chunk.size() == table_end);
+
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        GArray * records = m_records[len];
+
+        for (size_t i = 0; i < records->len; ++i) {
+            packed_chewing_record_t * record =
+                &g_array_index(records, packed_chewing_record_t, i);
+            chunk.append_content((char *) m_contents.begin() +
+                                 record->m_begin, record->m_length);
+        }
+    }
+
+    assert(chunk.size() == data_end);
+    return chunk.save(filename);
+}
@@ -0,0 +1,177 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef CHEWING_LARGE_TABLE2_PACKED_H
+#define CHEWING_LARGE_TABLE2_PACKED_H
+
+#include <glib.h>
+#include "novel_types.h"
+#include "memory_chunk.h"
+#include "chewing_key.h"
+
+namespace pinyin{
+
+/**
+ * PackedChewingTable:
+ *
+ * The read-only packed chewing table, which is memory-mapped from the file.
+ *
+ * The file layout:
+ *   guint32 the begin of the chewing indexes of each phrase length,
+ *     MAX_PHRASE_LENGTH + 1 entries, the first entry is unused;
+ *   guint32 the number of the chewing indexes of each phrase length,
+ *     MAX_PHRASE_LENGTH + 1 entries;
+ *   for each phrase length, the sorted chewing indexes, padded to guint32,
+ *     then the offset table, n + 1 entries for the n chewing indexes,
+ *     the content of the index is between the two consecutive offsets;
+ *   the content of the chewing indexes, the same as ChewingTableEntry.
+ *
+ * The chewing indexes are compared as the raw memory like the database,
+ * the empty content keeps the continued information.
+ *
+ */
+class PackedChewingTable{
+private:
+    /* Disallow used outside. */
+    PackedChewingTable(const PackedChewingTable & table);
+    PackedChewingTable & operator = (const PackedChewingTable & table);
+
+protected:
+    MemoryChunk * m_chunk;
+
+    const guint32 * m_table_begins;
+    const guint32 * m_table_lengths;
+
+    /* the offset table of each phrase length. */
+    const guint32 * m_offsets[MAX_PHRASE_LENGTH + 1];
+
+    void reset();
+
+public:
+    /**
+     * PackedChewingTable::PackedChewingTable:
+     *
+     * The constructor of the PackedChewingTable.
+     *
+     */
+    PackedChewingTable();
+
+    /**
+     * PackedChewingTable::~PackedChewingTable:
+     *
+     * The destructor of the PackedChewingTable.
+     *
+     */
+    ~PackedChewingTable();
+
+    /**
+     * PackedChewingTable::attach:
+     * @filename: the packed chewing table file name.
+     * @returns: whether the attach operation is successful.
+     *
+     * Attach this PackedChewingTable with the packed chewing table file.
+     *
+     */
+    bool attach(const char * filename);
+
+    /**
+     * PackedChewingTable::load:
+     * @phrase_length: the length of the chewing index.
+     * @index: the chewing index.
+     * @buffer: the content of the chewing index.
+     * @length: the length of the content.
+     * @returns: whether the chewing index exists.
+     *
+     * Binary search the chewing index, and load its content.
+     *
+     */
+    bool load(int phrase_length,
+              /* in */ const ChewingKey index[],
+              /* out */ void * & buffer,
+              /* out */ size_t & length) const;
+};
+
+/**
+ * PackedChewingTableWriter:
+ *
+ * Collect the chewing indexes, and save them as the packed chewing table.
+ *
+ */
+class PackedChewingTableWriter{
+private:
+    /* Disallow used outside. */
+    PackedChewingTableWriter(const PackedChewingTableWriter & writer);
+    PackedChewingTableWriter & operator = (const PackedChewingTableWriter & writer);
+
+protected:
+    /* Array of packed_chewing_record_t for each phrase length. */
+    GArray * m_records[MAX_PHRASE_LENGTH + 1];
+
+    /* the content of all chewing indexes. */
+    MemoryChunk m_contents;
+
+public:
+    /**
+     * PackedChewingTableWriter::PackedChewingTableWriter:
+     *
+     * The constructor of the PackedChewingTableWriter.
+     *
+     */
+    PackedChewingTableWriter();
+
+    /**
+     * PackedChewingTableWriter::~PackedChewingTableWriter:
+     *
+     * The destructor of the PackedChewingTableWriter.
+     *
+     */
+    ~PackedChewingTableWriter();
+
+    /**
+     * PackedChewingTableWriter::add_entry:
+     * @phrase_length: the length of the chewing index.
+     * @index: the chewing index.
+     * @buffer: the content of the chewing index.
+     * @length: the length of the content.
+     * @returns: whether the add operation is successful.
+     *
+     * Add one chewing index in any order.
+     *
+     */
+    bool add_entry(int phrase_length,
+                   /* in */ const ChewingKey index[],
+                   /* in */ const void * buffer,
+                   /* in */ size_t length);
+
+    /**
+     * PackedChewingTableWriter::save:
+     * @filename: the packed chewing table file name.
+     * @returns: whether the save operation is successful.
+     *
+     * Save the collected chewing indexes in the packed format.
+     *
+     */
+    bool save(const char * filename);
+};
+
+};
+
+#endif
@@ -39,6 +39,9 @@ private:
     ChewingLargeTable2 * m_system_chewing_table;
     ChewingLargeTable2 * m_user_chewing_table;
 
+    /* increased when the chewing tables are changed. */
+    guint32 m_generation;
+
     void reset() {
         if (m_system_chewing_table) {
             delete m_system_chewing_table;
@@ -61,6 +64,7 @@ public:
     FacadeChewingTable2() {
         m_system_chewing_table = NULL;
         m_user_chewing_table = NULL;
+        m_generation = 0;
     }
 
     /**
@@ -76,6 +80,7 @@ public:
     bool load(const char * system_filename,
               const char * user_filename) {
         reset();
+        ++m_generation;
 
         bool result = false;
         if (system_filename) {
@@ -91,6 +96,41 @@ public:
         return result;
     }
 
+    /**
+     * FacadeChewingTable2::load_packed:
+     * @packed_filename: the packed system chewing table file name.
+     * @system_filename: the system chewing table file name.
+     * @user_filename: the user chewing table file name.
+     * @returns: whether the load operation is successful.
+     *
+     * Load the system chewing table from the packed file, or fall back to
+     * the database when the packed file can not be attached.
+     *
+     */
+    bool load_packed(const char * packed_filename,
+                     const char * system_filename,
+                     const char * user_filename) {
+        reset();
+        ++m_generation;
+
+        bool result = false;
+        if (packed_filename || system_filename) {
+            m_system_chewing_table = new ChewingLargeTable2;
+            bool attached = m_system_chewing_table->attach_packed
+                (packed_filename);
+            if (!attached && system_filename)
+                attached = m_system_chewing_table->attach
+                    (system_filename, ATTACH_READONLY);
+            result = attached || result;
+        }
+        if (user_filename) {
+            m_user_chewing_table = new ChewingLargeTable2;
+            result = m_user_chewing_table->load_db
+                (user_filename) || result;
+        }
+        return result;
+    }
+
     bool store(const char * new_user_filename) {
         if (NULL == m_user_chewing_table)
             return false;
@@ -129,6 +169,34 @@ public:
         return result;
     }
 
+    /**
+     * FacadeChewingTable2::search_batch:
+     * @phrase_length: the length of the phrases to be searched.
+     * @keys: the num pinyin key sequences, stored one after another.
+     * @num: the number of the pinyin key sequences.
+     * @ranges: the array of GArrays to store the matched phrase token.
+     * @returns: the combined search result of enum SearchResult.
+     *
+     * Search the phrase tokens of many pinyin key sequences at once,
+     * the sequences sharing the same chewing index are resolved together.
+     *
+     */
+    int search_batch(int phrase_length, /* in */ const ChewingKey keys[],
+                     /* in */ size_t num,
+                     /* out */ PhraseIndexRanges ranges) const {
+        int result = SEARCH_NONE;
+
+        if (NULL != m_system_chewing_table)
+            result |= m_system_chewing_table->search_batch
+                (phrase_length, keys, num, ranges);
+
+        if (NULL != m_user_chewing_table)
+            result |= m_user_chewing_table->search_batch
+                (phrase_length, keys, num, ranges);
+
+        return result;
+    }
+
     /**
      * FacadeChewingTable2::add_index:
      * @phrase_length: the length of the phrase to be added.
@@ -143,6 +211,7 @@ public:
                   /* in */ phrase_token_t token) {
         if (NULL == m_user_chewing_table)
             return ERROR_NO_USER_TABLE;
+        ++m_generation;
         return m_user_chewing_table->add_index(phrase_length, keys, token);
     }
 
@@ -160,6 +229,7 @@ public:
                      /* in */ phrase_token_t token) {
         if (NULL == m_user_chewing_table)
             return ERROR_NO_USER_TABLE;
+        ++m_generation;
         return m_user_chewing_table->remove_index(phrase_length, keys, token);
     }
 
@@ -175,9 +245,21 @@ public:
     bool mask_out(phrase_token_t mask, phrase_token_t value) {
         if (NULL == m_user_chewing_table)
             return false;
+        ++m_generation;
         return m_user_chewing_table->mask_out(mask, value);
     }
 
+    /**
+     * FacadeChewingTable2::get_generation:
+     * @returns: the generation of the chewing tables.
+     *
+     * Get the generation, which is changed when the tables are changed.
+     *
+     */
+    guint32 get_generation() const {
+        return m_generation;
+    }
+
 };
 
 };
@@ -89,7 +89,9 @@ public:
      * @flags: the attach flags for the Berkeley DB.
      * @returns: whether the attach operation is successful.
      *
-     * Attach Berkeley DB on filesystem for training purpose.
+     * Attach Berkeley DB on filesystem for training purpose,
+     * or create the in-memory Berkeley DB when @dbfile is NULL
+     * with ATTACH_CREATE.
      *
      */
     bool attach(const char * dbfile, guint32 flags){
@@ -101,14 +103,18 @@ public:
         if ( flags & ATTACH_READWRITE )
             assert( !(flags & ATTACH_READONLY ) );
 
-        if ( !dbfile )
+        if ( !dbfile && !(flags & ATTACH_CREATE) )
             return false;
 
         int ret = db_create(&m_db, NULL, 0);
         if ( ret != 0 )
             assert(false);
 
-        ret = m_db->open(m_db, NULL, dbfile, NULL, DB_HASH, db_flags, 0644);
+        /* the in-memory db is always created. */
+        ret = -1;
+        if ( dbfile )
+            ret = m_db->open(m_db, NULL, dbfile, NULL,
+                             DB_HASH, db_flags, 0644);
         if ( ret != 0 && (flags & ATTACH_CREATE) ) {
             db_flags |= DB_CREATE;
             /* Create database file here, and write the signature. */
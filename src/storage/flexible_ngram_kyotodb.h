@@ -26,6 +26,7 @@
 #ifdef HAVE_KYOTO_CABINET
 #include <kcdb.h>
 #include <kchashdb.h>
+#include <kcprotodb.h>
 #endif
 
 #include "memory_chunk.h"
@@ -35,6 +36,7 @@ namespace pinyin{
 using kyotocabinet::DB;
 using kyotocabinet::BasicDB;
 using kyotocabinet::HashDB;
+using kyotocabinet::ProtoHashDB;
 
 class FlexibleKeyCollectVisitor : public DB::Visitor {
 private:
@@ -124,7 +126,8 @@ public:
      * @flags: the attach flags for the Berkeley DB.
      * @returns: whether the attach operation is successful.
      *
-     * Attach Berkeley DB on filesystem for training purpose.
+     * Attach Berkeley DB on filesystem for training purpose,
+     * or create the in-memory DB when @dbfile is NULL with ATTACH_CREATE.
      *
      */
     bool attach(const char * dbfile, guint32 flags){
@@ -138,8 +141,22 @@ public:
             mode |= BasicDB::OREADER | BasicDB::OWRITER;
         }
 
-        if (!dbfile)
-            return false;
+        if (!dbfile) {
+            if (!(flags & ATTACH_CREATE))
+                return false;
+
+            /* create the in-memory db, and write the signature. */
+            m_db = new ProtoHashDB;
+            if (!m_db->open("-", mode | BasicDB::OCREATE))
+                return false;
+
+            const char * kbuf = (char *) m_magic_header_index;
+            const size_t ksiz = sizeof(m_magic_header_index);
+            const char * vbuf = (char *) m_magic_number;
+            const size_t vsiz = sizeof(m_magic_number);
+            m_db->set(kbuf, ksiz, vbuf, vsiz);
+            return true;
+        }
 
         m_db = new HashDB;
 
@@ -25,6 +25,7 @@
 #include <assert.h>
 #include <kchashdb.h>
 #include <kcprotodb.h>
+#include "thread_chunk.h"
 
 using namespace kyotocabinet;
 
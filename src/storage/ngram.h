@@ -54,6 +54,7 @@ class Bigram;
  */
 class SingleGram{
     friend class Bigram;
+    friend class PackedBigram;
     friend bool merge_single_gram(SingleGram * merged,
                                   const SingleGram * system,
                                   const SingleGram * user);
@@ -24,13 +24,16 @@
 #include "memory_chunk.h"
 #include "novel_types.h"
 #include "ngram.h"
+#include "ngram_packed.h"
 #include "bdb_utils.h"
+#include "thread_chunk.h"
 
 using namespace pinyin;
 
 
 Bigram::Bigram(){
 	m_db = NULL;
+	m_packed_bigram = NULL;
 }
 
 Bigram::~Bigram(){
@@ -43,6 +46,11 @@ void Bigram::reset(){
         m_db->close(m_db, 0);
         m_db = NULL;
     }
+
+    if ( m_packed_bigram ){
+        delete m_packed_bigram;
+        m_packed_bigram = NULL;
+    }
 }
 
 bool Bigram::load_db(const char * dbfile){
@@ -52,8 +60,9 @@ bool Bigram::load_db(const char * dbfile){
     int ret = db_create(&m_db, NULL, 0);
     assert(ret == 0);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_HASH, DB_CREATE, 0600);
+                     DB_HASH, DB_CREATE|DB_THREAD, 0600);
     if ( ret != 0 )
         return false;
 
@@ -112,22 +121,50 @@ bool Bigram::attach(const char * dbfile, guint32 flags){
     reset();
     u_int32_t db_flags = attach_options(flags);
 
-    if ( !dbfile )
+    /* create the in-memory db. */
+    if ( !dbfile && !(flags & ATTACH_CREATE) )
         return false;
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 	
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, dbfile, NULL,
-                     DB_HASH, db_flags, 0644);
+                     DB_HASH, db_flags|DB_THREAD, 0644);
     if ( ret != 0)
         return false;
 
     return true;
 }
 
+bool Bigram::attach_packed(const char * filename){
+    reset();
+
+    if ( !filename )
+        return false;
+
+    m_packed_bigram = new PackedBigram;
+    if ( !m_packed_bigram->attach(filename) ){
+        delete m_packed_bigram;
+        m_packed_bigram = NULL;
+        return false;
+    }
+
+    return true;
+}
+
 bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
                   bool copy){
     single_gram = NULL;
+
+    if ( m_packed_bigram ){
+        void * buffer = NULL; size_t length = 0;
+        if ( !m_packed_bigram->load(index, buffer, length) )
+            return false;
+
+        single_gram = new SingleGram(buffer, length, copy);
+        return true;
+    }
+
     if ( !m_db )
         return false;
 
@@ -136,13 +173,39 @@ bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
     db_key.data = &index;
     db_key.size = sizeof(phrase_token_t);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    /* the per-thread buffer is re-used, so always copy it. */
+    MemoryChunk * chunk = get_thread_chunk();
+    int ret = get_bdb_chunk(m_db, &db_key, *chunk);
+    if ( ret != 0 )
+        return false;
+
+    single_gram = new SingleGram(chunk->begin(), chunk->size(), true);
+    return true;
+}
+
+bool Bigram::load_view(phrase_token_t index, SingleGram & single_gram){
+    if ( m_packed_bigram ){
+        void * buffer = NULL; size_t length = 0;
+        if ( !m_packed_bigram->load(index, buffer, length) )
+            return false;
+
+        single_gram.m_chunk.set_chunk(buffer, length, NULL);
+        return true;
+    }
+
+    if ( !m_db )
+        return false;
+
+    DBT db_key;
+    memset(&db_key, 0, sizeof(DBT));
+    db_key.data = &index;
+    db_key.size = sizeof(phrase_token_t);
+
+    /* read into the buffer of the view, as the handle is shared. */
+    int ret = get_bdb_chunk(m_db, &db_key, single_gram.m_chunk);
     if ( ret != 0 )
         return false;
 
-    single_gram = new SingleGram(db_data.data, db_data.size, copy);
     return true;
 }
 
@@ -179,6 +242,9 @@ bool Bigram::remove(/* in */ phrase_token_t index){
 bool Bigram::get_all_items(GArray * items){
     g_array_set_size(items, 0);
 
+    if ( m_packed_bigram )
+        return m_packed_bigram->get_all_items(items);
+
     if ( !m_db )
         return false;
 
@@ -192,8 +258,8 @@ bool Bigram::get_all_items(GArray * items){
         return false;
 
     /* Initialize our DBTs. */
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
+    init_cursor_dbt(&key);
+    init_cursor_dbt(&data);
 	
     /* Iterate over the database, retrieving each record in turn. */
     while ((ret = cursorp->c_get(cursorp, &key, &data, DB_NEXT)) == 0) {
@@ -204,6 +270,9 @@ bool Bigram::get_all_items(GArray * items){
 
     assert (ret == DB_NOTFOUND);
 
+    fini_cursor_dbt(&key);
+    fini_cursor_dbt(&data);
+
     /* Cursors must be closed */
     if (cursorp != NULL) 
         cursorp->c_close(cursorp); 
@@ -213,6 +282,10 @@ bool Bigram::get_all_items(GArray * items){
 
 /* Note: sync mask_out code with ngram_kyotodb.cpp. */
 bool Bigram::mask_out(phrase_token_t mask, phrase_token_t value){
+    /* the packed bi-gram is read-only. */
+    if ( m_packed_bigram )
+        return false;
+
     GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
 
     if (!get_all_items(items)) {
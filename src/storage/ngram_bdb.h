@@ -27,6 +27,7 @@
 namespace pinyin{
 
 class SingleGram;
+class PackedBigram;
 
 /**
  * Bigram:
@@ -38,6 +39,9 @@ class Bigram{
 private:
     DB * m_db;
 
+    /* the read-only packed bi-gram, instead of the database. */
+    PackedBigram * m_packed_bigram;
+
     void reset();
 
 public:
@@ -83,11 +87,23 @@ public:
      * @flags: the flags of enum ATTACH_FLAG.
      * @returns: whether the attach operation is successful.
      *
-     * Attach this Bigram with the Berkeley DB.
+     * Attach this Bigram with the Berkeley DB,
+     * or create the in-memory DB when @dbfile is NULL with ATTACH_CREATE.
      *
      */
     bool attach(const char * dbfile, guint32 flags);
 
+    /**
+     * Bigram::attach_packed:
+     * @filename: the packed bi-gram file name.
+     * @returns: whether the attach operation is successful.
+     *
+     * Attach this Bigram with the read-only packed bi-gram,
+     * see PackedBigram.
+     *
+     */
+    bool attach_packed(const char * filename);
+
     /**
      * Bigram::load:
      * @index: the previous token in the bi-gram.
@@ -101,6 +117,22 @@ public:
     bool load(/* in */ phrase_token_t index,
               /* out */ SingleGram * & single_gram, bool copy=false);
 
+    /**
+     * Bigram::load_view:
+     * @index: the previous token in the bi-gram.
+     * @single_gram: the single gram to view the stored content.
+     * @returns: whether the load operation is successful.
+     *
+     * Load the single gram of the previous token into the buffer
+     * of the single gram, which is re-used by the following calls.
+     *
+     * Note: the view is read-only, and is valid until the next call
+     *   with the same single gram.
+     *
+     */
+    bool load_view(/* in */ phrase_token_t index,
+                   /* out */ SingleGram & single_gram);
+
     /**
      * Bigram::store:
      * @index: the previous token in the bi-gram.
@@ -20,6 +20,7 @@
  */
 
 #include "ngram.h"
+#include "ngram_packed.h"
 #include <assert.h>
 #include <errno.h>
 #include <kchashdb.h>
@@ -35,6 +36,7 @@ using namespace kyotocabinet;
 
 Bigram::Bigram(){
 	m_db = NULL;
+	m_packed_bigram = NULL;
 }
 
 Bigram::~Bigram(){
@@ -48,6 +50,11 @@ void Bigram::reset(){
         delete m_db;
         m_db = NULL;
     }
+
+    if ( m_packed_bigram ){
+        delete m_packed_bigram;
+        m_packed_bigram = NULL;
+    }
 }
 
 
@@ -100,19 +107,54 @@ bool Bigram::attach(const char * dbfile, guint32 flags){
     reset();
     uint32_t mode = attach_options(flags);
 
-    if (!dbfile)
-        return false;
+    if (!dbfile) {
+        if (!(flags & ATTACH_CREATE))
+            return false;
+
+        /* create the in-memory db. */
+        m_db = new ProtoHashDB;
+        return m_db->open("-", mode);
+    }
 
     m_db = new HashDB;
 
     return m_db->open(dbfile, mode);
 }
 
+bool Bigram::attach_packed(const char * filename){
+    reset();
+
+    if ( !filename )
+        return false;
+
+    m_packed_bigram = new PackedBigram;
+    if ( !m_packed_bigram->attach(filename) ){
+        delete m_packed_bigram;
+        m_packed_bigram = NULL;
+        return false;
+    }
+
+    return true;
+}
+
 /* Use DB interface, first check, second reserve the memory chunk,
-   third get value into the chunk. */
+   third get value into the chunk.
+
+   The chunk is owned by the caller, as the bi-gram is shared by
+   the lookups in the threads. */
 bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
                   bool copy){
     single_gram = NULL;
+
+    if ( m_packed_bigram ){
+        void * buffer = NULL; size_t length = 0;
+        if ( !m_packed_bigram->load(index, buffer, length) )
+            return false;
+
+        single_gram = new SingleGram(buffer, length, copy);
+        return true;
+    }
+
     if ( !m_db )
         return false;
 
@@ -122,12 +164,42 @@ bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
     if (-1 == vsiz)
         return false;
 
-    m_chunk.set_size(vsiz);
-    char * vbuf = (char *) m_chunk.begin();
+    single_gram = new SingleGram;
+    MemoryChunk & chunk = single_gram->m_chunk;
+    chunk.set_size(vsiz);
+    char * vbuf = (char *) chunk.begin();
     assert (vsiz == m_db->get(kbuf, sizeof(phrase_token_t),
                               vbuf, vsiz));
+    return true;
+}
+
+bool Bigram::load_view(phrase_token_t index, SingleGram & single_gram){
+    if ( m_packed_bigram ){
+        void * buffer = NULL; size_t length = 0;
+        if ( !m_packed_bigram->load(index, buffer, length) )
+            return false;
+
+        single_gram.m_chunk.set_chunk(buffer, length, NULL);
+        return true;
+    }
 
-    single_gram = new SingleGram(m_chunk.begin(), vsiz, copy);
+    if ( !m_db )
+        return false;
+
+    const char * kbuf = (char *) &index;
+    const int32_t vsiz = m_db->check(kbuf, sizeof(phrase_token_t));
+    /* -1 on failure. */
+    if (-1 == vsiz)
+        return false;
+
+    /* reuse the buffer of the view, the borrowed memory is dropped
+       before the resize. */
+    MemoryChunk & chunk = single_gram.m_chunk;
+    chunk.set_size(0);
+    chunk.set_size(vsiz);
+    char * vbuf = (char *) chunk.begin();
+    assert (vsiz == m_db->get(kbuf, sizeof(phrase_token_t),
+                              vbuf, vsiz));
     return true;
 }
 
@@ -175,6 +247,9 @@ public:
 bool Bigram::get_all_items(GArray * items){
     g_array_set_size(items, 0);
 
+    if ( m_packed_bigram )
+        return m_packed_bigram->get_all_items(items);
+
     if ( !m_db )
         return false;
 
@@ -186,6 +261,10 @@ bool Bigram::get_all_items(GArray * items){
 
 /* Note: sync mask_out code with ngram_bdb.cpp. */
 bool Bigram::mask_out(phrase_token_t mask, phrase_token_t value){
+    /* the packed bi-gram is read-only. */
+    if ( m_packed_bigram )
+        return false;
+
     GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
 
     if (!get_all_items(items)) {
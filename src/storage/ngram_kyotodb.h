@@ -28,6 +28,7 @@
 namespace pinyin{
 
 class SingleGram;
+class PackedBigram;
 
 /**
  * Bigram:
@@ -39,8 +40,8 @@ class Bigram{
 private:
     kyotocabinet::BasicDB * m_db;
 
-    /* memory chunk for Kyoto Cabinet. */
-    MemoryChunk m_chunk;
+    /* the read-only packed bi-gram, instead of the database. */
+    PackedBigram * m_packed_bigram;
 
     void reset();
 
@@ -87,11 +88,23 @@ public:
      * @flags: the flags of enum ATTACH_FLAG.
      * @returns: whether the attach operation is successful.
      *
-     * Attach this Bigram with the Berkeley DB.
+     * Attach this Bigram with the Berkeley DB,
+     * or create the in-memory DB when @dbfile is NULL with ATTACH_CREATE.
      *
      */
     bool attach(const char * dbfile, guint32 flags);
 
+    /**
+     * Bigram::attach_packed:
+     * @filename: the packed bi-gram file name.
+     * @returns: whether the attach operation is successful.
+     *
+     * Attach this Bigram with the read-only packed bi-gram,
+     * see PackedBigram.
+     *
+     */
+    bool attach_packed(const char * filename);
+
     /**
      * Bigram::load:
      * @index: the previous token in the bi-gram.
@@ -101,11 +114,32 @@ public:
      *
      * Load the single gram of the previous token.
      *
+     * Note: the single gram always owns the content read from
+     *   Kyoto Cabinet, so the loads are safe under the reader lock.
+     *
      */
     bool load(/* in */ phrase_token_t index,
               /* out */ SingleGram * & single_gram,
               bool copy=false);
 
+    /**
+     * Bigram::load_view:
+     * @index: the previous token in the bi-gram.
+     * @single_gram: the single gram to view the stored content.
+     * @returns: whether the load operation is successful.
+     *
+     * Load the single gram of the previous token without copy,
+     * the single gram borrows the memory of the packed bi-gram.
+     * The content of Kyoto Cabinet is read into the buffer of
+     * the view, which is reused by the next load_view.
+     *
+     * Note: the view is read-only, and is valid until the next call
+     *   of this bi-gram.
+     *
+     */
+    bool load_view(/* in */ phrase_token_t index,
+                   /* out */ SingleGram & single_gram);
+
     /**
      * Bigram::store:
      * @index: the previous token in the bi-gram.
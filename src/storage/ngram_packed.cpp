@@ -0,0 +1,194 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ngram_packed.h"
+#include <assert.h>
+#include "stl_lite.h"
+#include "ngram.h"
+
+using namespace pinyin;
+
+/* the header of the offset table begins and the token numbers. */
+static const size_t packed_bigram_header =
+    sizeof(guint32) * PHRASE_INDEX_LIBRARY_COUNT * 2;
+
+PackedBigram::PackedBigram(){
+    m_chunk = NULL;
+    m_table_begins = NULL;
+    m_table_lengths = NULL;
+    m_offsets = NULL;
+}
+
+PackedBigram::~PackedBigram(){
+    reset();
+}
+
+void PackedBigram::reset(){
+    if (m_chunk) {
+        delete m_chunk;
+        m_chunk = NULL;
+    }
+
+    m_table_begins = NULL;
+    m_table_lengths = NULL;
+    m_offsets = NULL;
+}
+
+bool PackedBigram::attach(const char * filename){
+    reset();
+
+    MemoryChunk * chunk = new MemoryChunk;
+#ifdef LIBPINYIN_USE_MMAP
+    if (!chunk->mmap(filename)) {
+#else
+    if (!chunk->load(filename)) {
+#endif
+        delete chunk;
+        return false;
+    }
+
+    if (chunk->size() < packed_bigram_header) {
+        delete chunk;
+        return false;
+    }
+
+    const guint32 * begins = (const guint32 *) chunk->begin();
+    const guint32 * lengths = begins + PHRASE_INDEX_LIBRARY_COUNT;
+    const guint32 * offsets = lengths + PHRASE_INDEX_LIBRARY_COUNT;
+
+    /* validate the offset table. */
+    size_t num = 0;
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i)
+        num = std_lite::max(num, (size_t) begins[i] + lengths[i] + 1);
+
+    const size_t table_end = packed_bigram_header + num * sizeof(guint32);
+    if (chunk->size() < table_end) {
+        delete chunk;
+        return false;
+    }
+
+    /* the offsets of each library are in the data, and never decrease. */
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        const guint32 * offset = offsets + begins[i];
+
+        for (size_t k = 0; k <= lengths[i]; ++k) {
+            if (offset[k] < table_end || offset[k] > chunk->size() ||
+                (k > 0 && offset[k] < offset[k - 1])) {
+                delete chunk;
+                return false;
+            }
+        }
+    }
+
+    m_chunk = chunk;
+    m_table_begins = begins;
+    m_table_lengths = lengths;
+    m_offsets = offsets;
+    return true;
+}
+
+bool PackedBigram::get_all_items(GArray * items) const{
+    g_array_set_size(items, 0);
+
+    if (NULL == m_chunk)
+        return false;
+
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        const guint32 * offset = m_offsets + m_table_begins[i];
+
+        for (size_t k = 0; k < m_table_lengths[i]; ++k) {
+            if (offset[k] == offset[k + 1])
+                continue;
+
+            phrase_token_t token = PHRASE_INDEX_MAKE_TOKEN(i, k);
+            g_array_append_val(items, token);
+        }
+    }
+
+    return true;
+}
+
+bool PackedBigram::convert(Bigram * bigram, const char * filename){
+    GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    if (!bigram->get_all_items(items)) {
+        g_array_free(items, TRUE);
+        return false;
+    }
+
+    /* compute the number of the tokens of each library. */
+    guint32 begins[PHRASE_INDEX_LIBRARY_COUNT];
+    guint32 lengths[PHRASE_INDEX_LIBRARY_COUNT];
+    memset(lengths, 0, sizeof(lengths));
+
+    for (size_t i = 0; i < items->len; ++i) {
+        const phrase_token_t token = g_array_index(items, phrase_token_t, i);
+        const guint8 library = PHRASE_INDEX_LIBRARY_INDEX(token);
+        lengths[library] = std_lite::max
+            (lengths[library], (guint32) (token & PHRASE_MASK) + 1);
+    }
+
+    /* one extra offset for each library. */
+    size_t num = 0;
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        begins[i] = num;
+        num += lengths[i] + 1;
+    }
+
+    MemoryChunk offsets;
+    offsets.set_size(num * sizeof(guint32));
+    guint32 * offset_begin = (guint32 *) offsets.begin();
+
+    MemoryChunk chunk;
+    chunk.set_content(0, begins, sizeof(begins));
+    chunk.set_content(sizeof(begins), lengths, sizeof(lengths));
+
+    const guint32 data_begin = packed_bigram_header + offsets.size();
+    guint32 data_end = data_begin;
+
+    /* append the single grams in the token order. */
+    MemoryChunk contents;
+    SingleGram single_gram;
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        guint32 * offset = offset_begin + begins[i];
+
+        for (size_t k = 0; k < lengths[i]; ++k) {
+            offset[k] = data_end;
+
+            phrase_token_t token = PHRASE_INDEX_MAKE_TOKEN(i, k);
+            if (!bigram->load_view(token, single_gram))
+                continue;
+
+            MemoryChunk & content = single_gram.m_chunk;
+            contents.set_content(data_end - data_begin,
+                                 content.begin(), content.size());
+            data_end += content.size();
+        }
+
+        offset[lengths[i]] = data_end;
+    }
+
+    chunk.set_content(packed_bigram_header,
+                      offsets.begin(), offsets.size());
+    chunk.set_content(data_begin, contents.begin(), contents.size());
+
+    g_array_free(items, TRUE);
+    return chunk.save(filename);
+}
@@ -0,0 +1,148 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef NGRAM_PACKED_H
+#define NGRAM_PACKED_H
+
+#include <glib.h>
+#include "novel_types.h"
+#include "memory_chunk.h"
+
+namespace pinyin{
+
+class Bigram;
+
+/**
+ * PackedBigram:
+ *
+ * The read-only packed bi-gram, which is memory-mapped from the file.
+ *
+ * The file layout:
+ *   guint32 the offset table begin of each library,
+ *     PHRASE_INDEX_LIBRARY_COUNT entries;
+ *   guint32 the number of the tokens of each library,
+ *     PHRASE_INDEX_LIBRARY_COUNT entries;
+ *   guint32 the offset table, n + 1 entries for the n tokens of a library,
+ *     the content of the token is between the two consecutive offsets;
+ *   the content of the single grams, the same as SingleGram.
+ *
+ * The empty content means the token has no single gram.
+ *
+ */
+class PackedBigram{
+private:
+    /* Disallow used outside. */
+    PackedBigram(const PackedBigram & bigram);
+    PackedBigram & operator = (const PackedBigram & bigram);
+
+protected:
+    MemoryChunk * m_chunk;
+
+    const guint32 * m_table_begins;
+    const guint32 * m_table_lengths;
+    const guint32 * m_offsets;
+
+    void reset();
+
+public:
+    /**
+     * PackedBigram::PackedBigram:
+     *
+     * The constructor of the PackedBigram.
+     *
+     */
+    PackedBigram();
+
+    /**
+     * PackedBigram::~PackedBigram:
+     *
+     * The destructor of the PackedBigram.
+     *
+     */
+    ~PackedBigram();
+
+    /**
+     * PackedBigram::attach:
+     * @filename: the packed bi-gram file name.
+     * @returns: whether the attach operation is successful.
+     *
+     * Attach this PackedBigram with the packed bi-gram file.
+     *
+     */
+    bool attach(const char * filename);
+
+    /**
+     * PackedBigram::load:
+     * @index: the previous token in the bi-gram.
+     * @buffer: the content of the single gram.
+     * @length: the length of the content.
+     * @returns: whether the single gram exists.
+     *
+     * Load the content of the single gram of the previous token.
+     *
+     */
+    bool load(/* in */ phrase_token_t index,
+              /* out */ void * & buffer,
+              /* out */ size_t & length) const {
+        const guint8 library = PHRASE_INDEX_LIBRARY_INDEX(index);
+        const guint32 item = index & PHRASE_MASK;
+
+        if (NULL == m_chunk)
+            return false;
+
+        if (item >= m_table_lengths[library])
+            return false;
+
+        const guint32 * offset = m_offsets + m_table_begins[library] + item;
+        const guint32 begin = offset[0], end = offset[1];
+        if (begin == end)
+            return false;
+
+        buffer = (char *) m_chunk->begin() + begin;
+        length = end - begin;
+        return true;
+    }
+
+    /**
+     * PackedBigram::get_all_items:
+     * @items: the GArray to store all previous tokens.
+     * @returns: whether the get operation is successful.
+     *
+     * Get the array of all previous tokens for parameter estimation.
+     *
+     */
+    bool get_all_items(/* out */ GArray * items) const;
+
+    /**
+     * PackedBigram::convert:
+     * @bigram: the bi-gram to be converted.
+     * @filename: the packed bi-gram file name.
+     * @returns: whether the convert operation is successful.
+     *
+     * Save the bi-gram in the packed format.
+     *
+     */
+    static bool convert(Bigram * bigram, const char * filename);
+};
+
+};
+
+#endif
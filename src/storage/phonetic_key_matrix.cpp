@@ -32,11 +32,11 @@ bool fill_matrix(PhoneticKeyMatrix * matrix,
                  ChewingKeyVector keys,
                  ChewingKeyRestVector key_rests,
                  size_t parsed_len) {
-    matrix->clear_all();
-
     assert(keys->len == key_rests->len);
-    if (0 == keys->len)
+    if (0 == keys->len) {
+        matrix->clear_all();
         return false;
+    }
 
     const ChewingKey * key = NULL;
     const ChewingKeyRest * key_rest = NULL;
@@ -348,11 +348,12 @@ bool dump_matrix(PhoneticKeyMatrix * matrix) {
     return true;
 }
 
+/* collect the key sequences into key_batches by the length,
+   the chewing table is searched later in batches. */
 int search_matrix_recur(GArray * cached_keys,
-                        FacadeChewingTable2 * table,
+                        GArray * key_batches[],
                         PhoneticKeyMatrix * matrix,
                         size_t start, size_t end,
-                        PhraseIndexRanges ranges,
                         size_t & longest) {
     if (start > end)
         return SEARCH_NONE;
@@ -370,8 +371,11 @@ int search_matrix_recur(GArray * cached_keys,
 #if 0
         printf("search table:%d\n", cached_keys->len);
 #endif
-        return table->search(cached_keys->len,
-                             (ChewingKey *)cached_keys->data, ranges);
+        GArray * & batch = key_batches[cached_keys->len];
+        if (NULL == batch)
+            batch = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+        g_array_append_vals(batch, cached_keys->data, cached_keys->len);
+        return SEARCH_NONE;
     }
 
     int result = SEARCH_NONE;
@@ -390,16 +394,16 @@ int search_matrix_recur(GArray * cached_keys,
         if (zero_key == key) {
             /* assume only one key here for "'" or the last key. */
             assert(1 == size);
-            return search_matrix_recur(cached_keys, table, matrix,
-                                       newstart, end, ranges, longest);
+            return search_matrix_recur(cached_keys, key_batches, matrix,
+                                       newstart, end, longest);
         }
 
         /* push value */
         g_array_append_val(cached_keys, key);
         longest = std_lite::max(longest, newstart);
 
-        result |= search_matrix_recur(cached_keys, table, matrix,
-                                      newstart, end, ranges, longest);
+        result |= search_matrix_recur(cached_keys, key_batches, matrix,
+                                      newstart, end, longest);
 
         /* pop value */
         g_array_set_size(cached_keys, cached_keys->len - 1);
@@ -424,10 +428,23 @@ int search_matrix(FacadeChewingTable2 * table,
         return SEARCH_CONTINUED;
 
     GArray * cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+    GArray * key_batches[MAX_PHRASE_LENGTH + 1];
+    memset(key_batches, 0, sizeof(key_batches));
 
     size_t longest = 0;
-    int result = search_matrix_recur(cached_keys, table, matrix,
-                                     start, end, ranges, longest);
+    int result = search_matrix_recur(cached_keys, key_batches, matrix,
+                                     start, end, longest);
+
+    /* search all the key sequences of the same length at once. */
+    for (size_t len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        GArray * batch = key_batches[len];
+        if (NULL == batch)
+            continue;
+
+        result |= table->search_batch(len, (ChewingKey *) batch->data,
+                                      batch->len / len, ranges);
+        g_array_free(batch, TRUE);
+    }
 
     /* if any recur search return SEARCH_CONTINUED or longest > end,
        then return SEARCH_CONTINUED. */
@@ -507,6 +524,366 @@ gfloat compute_pronunciation_possibility(PhoneticKeyMatrix * matrix,
         (matrix, start, end, cached_keys, item);
 }
 
+/* the memorized possibility of one phrase in the span. */
+struct span_possibility_t{
+    phrase_token_t m_token;
+    gfloat m_possibility;
+
+    bool operator < (const span_possibility_t & rhs) const{
+        return m_token < rhs.m_token;
+    }
+};
+
+/* the key sequences of one span, grouped by the sequence length. */
+struct phonetic_span_t{
+    /* the index in the spans of the cache. */
+    size_t m_slot;
+    /* Array of ChewingKey, the sequences of the same length. */
+    GArray * m_keys[MAX_PHRASE_LENGTH + 1];
+    /* Array of span_possibility_t, sorted by the token. */
+    GArray * m_possibilities;
+};
+
+static void free_phonetic_span(gpointer data){
+    phonetic_span_t * span = (phonetic_span_t *) data;
+    for (size_t i = 0; i <= MAX_PHRASE_LENGTH; ++i) {
+        if (span->m_keys[i])
+            g_array_free(span->m_keys[i], TRUE);
+    }
+    g_array_free(span->m_possibilities, TRUE);
+    delete span;
+}
+
+/* keep the arrays of the span item for the next span. */
+static void clear_phonetic_span(phonetic_span_t * span){
+    for (size_t i = 0; i <= MAX_PHRASE_LENGTH; ++i) {
+        if (span->m_keys[i])
+            g_array_set_size(span->m_keys[i], 0);
+    }
+    g_array_set_size(span->m_possibilities, 0);
+}
+
+static void collect_span_keys_recur(PhoneticKeyMatrix * matrix,
+                                    size_t start, size_t end,
+                                    GArray * cached_keys,
+                                    phonetic_span_t * span){
+    if (start > end)
+        return;
+
+    if (MAX_PHRASE_LENGTH < cached_keys->len)
+        return;
+
+    /* only collect with 'start' and 'end'. */
+    if (start == end) {
+        const size_t len = cached_keys->len;
+        if (0 == len)
+            return;
+
+        if (NULL == span->m_keys[len])
+            span->m_keys[len] = g_array_new
+                (FALSE, FALSE, sizeof(ChewingKey));
+        g_array_append_vals(span->m_keys[len], cached_keys->data, len);
+        return;
+    }
+
+    const size_t size = matrix->get_column_size(start);
+    /* assume pinyin parsers will filter invalid keys. */
+    assert(size > 0);
+
+    for (size_t i = 0; i < size; ++i) {
+        ChewingKey key; ChewingKeyRest key_rest;
+        matrix->get_item(start, i, key, key_rest);
+
+        const size_t newstart = key_rest.m_raw_end;
+
+        const ChewingKey zero_key;
+        if (zero_key == key) {
+            /* assume only one key here for "'" or the last key. */
+            assert(1 == size);
+            collect_span_keys_recur(matrix, newstart, end,
+                                    cached_keys, span);
+            return;
+        }
+
+        /* push value */
+        g_array_append_val(cached_keys, key);
+
+        collect_span_keys_recur(matrix, newstart, end, cached_keys, span);
+
+        /* pop value */
+        g_array_set_size(cached_keys, cached_keys->len - 1);
+    }
+}
+
+PhoneticSpanCache::PhoneticSpanCache() {
+    m_matrix = NULL;
+    m_spans = g_ptr_array_new();
+    m_span_pool = g_ptr_array_new();
+    m_num_used = 0;
+    m_cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+}
+
+PhoneticSpanCache::~PhoneticSpanCache() {
+    g_ptr_array_free(m_spans, TRUE);
+    m_spans = NULL;
+    for (size_t i = 0; i < m_span_pool->len; ++i)
+        free_phonetic_span(g_ptr_array_index(m_span_pool, i));
+    g_ptr_array_free(m_span_pool, TRUE);
+    m_span_pool = NULL;
+    g_array_free(m_cached_keys, TRUE);
+    m_cached_keys = NULL;
+}
+
+bool PhoneticSpanCache::reset(PhoneticKeyMatrix * matrix) {
+    /* only clear the used spans, the span items are kept. */
+    for (size_t i = 0; i < m_num_used; ++i) {
+        phonetic_span_t * span = (phonetic_span_t *)
+            g_ptr_array_index(m_span_pool, i);
+        g_ptr_array_index(m_spans, span->m_slot) = NULL;
+        clear_phonetic_span(span);
+    }
+    m_num_used = 0;
+
+    m_matrix = matrix;
+    const size_t size = matrix ? matrix->size() : 0;
+    g_ptr_array_set_size(m_spans, size * size);
+    return true;
+}
+
+gpointer PhoneticSpanCache::get_span(size_t start, size_t end) {
+    const size_t size = m_matrix->size();
+    assert(start < size && end < size);
+    assert(size * size == m_spans->len);
+    const size_t slot = start * size + end;
+
+    phonetic_span_t * span = (phonetic_span_t *)
+        g_ptr_array_index(m_spans, slot);
+    if (span)
+        return span;
+
+    if (m_num_used < m_span_pool->len) {
+        span = (phonetic_span_t *) g_ptr_array_index
+            (m_span_pool, m_num_used);
+    } else {
+        span = new phonetic_span_t;
+        memset(span->m_keys, 0, sizeof(span->m_keys));
+        span->m_possibilities = g_array_new
+            (FALSE, FALSE, sizeof(span_possibility_t));
+        g_ptr_array_add(m_span_pool, span);
+    }
+    ++m_num_used;
+    span->m_slot = slot;
+
+    g_array_set_size(m_cached_keys, 0);
+    collect_span_keys_recur(m_matrix, start, end, m_cached_keys, span);
+
+    g_ptr_array_index(m_spans, slot) = span;
+    return span;
+}
+
+bool PhoneticSpanCache::lookup_pronunciation_possibility
+(size_t start, size_t end, phrase_token_t token, gfloat & possibility) {
+    assert(end < m_matrix->size());
+
+    possibility = 0.;
+    if(m_matrix->get_column_size(start) <= 0)
+        return true;
+    if(m_matrix->get_column_size(end) <= 0)
+        return true;
+
+    phonetic_span_t * span = (phonetic_span_t *) get_span(start, end);
+
+    span_possibility_t item;
+    item.m_token = token;
+    span_possibility_t * begin = (span_possibility_t *)
+        span->m_possibilities->data;
+    span_possibility_t * last = begin + span->m_possibilities->len;
+    span_possibility_t * iter = std_lite::lower_bound(begin, last, item);
+    if (iter == last || iter->m_token != token)
+        return false;
+
+    possibility = iter->m_possibility;
+    return true;
+}
+
+gfloat PhoneticSpanCache::compute_pronunciation_possibility
+(size_t start, size_t end, phrase_token_t token, PhraseItem & item) {
+    gfloat possibility = 0.;
+    if (lookup_pronunciation_possibility(start, end, token, possibility))
+        return possibility;
+
+    phonetic_span_t * span = (phonetic_span_t *) get_span(start, end);
+
+    span_possibility_t result;
+    result.m_token = token;
+    result.m_possibility = 0.;
+
+    const size_t phrase_length = item.get_phrase_length();
+    GArray * keys = span->m_keys[phrase_length];
+    if (keys) {
+        for (size_t i = 0; i < keys->len; i += phrase_length) {
+            ChewingKey * sequence = &g_array_index(keys, ChewingKey, i);
+            result.m_possibility +=
+                item.get_pronunciation_possibility(sequence);
+        }
+    }
+
+    /* keep the possibilities sorted by the token. */
+    span_possibility_t * begin = (span_possibility_t *)
+        span->m_possibilities->data;
+    span_possibility_t * last = begin + span->m_possibilities->len;
+    const size_t pos = std_lite::lower_bound(begin, last, result) - begin;
+    g_array_insert_val(span->m_possibilities, pos, result);
+    return result.m_possibility;
+}
+
+/* the search result of one span. */
+struct search_span_t{
+    int m_result;
+    /* NULL for the libraries without the matched tokens. */
+    GArray * m_ranges[PHRASE_INDEX_LIBRARY_COUNT];
+};
+
+/* the memorized spans of one chewing table. */
+struct search_table_t{
+    FacadeChewingTable2 * m_table;
+    guint32 m_generation;
+    /* (start, end) => search_span_t. */
+    GHashTable * m_spans;
+};
+
+static void free_search_span(gpointer data){
+    search_span_t * span = (search_span_t *) data;
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        if (span->m_ranges[i])
+            g_array_free(span->m_ranges[i], TRUE);
+    }
+    delete span;
+}
+
+PhoneticSearchCache::PhoneticSearchCache() {
+    m_matrix = NULL;
+    m_matrix_generation = 0;
+    m_tables = g_ptr_array_new();
+
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i)
+        m_cached_ranges[i] = g_array_new
+            (FALSE, FALSE, sizeof(PhraseIndexRange));
+}
+
+PhoneticSearchCache::~PhoneticSearchCache() {
+    for (size_t i = 0; i < m_tables->len; ++i) {
+        search_table_t * table = (search_table_t *)
+            g_ptr_array_index(m_tables, i);
+        g_hash_table_destroy(table->m_spans);
+        delete table;
+    }
+    g_ptr_array_free(m_tables, TRUE);
+    m_tables = NULL;
+
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        g_array_free(m_cached_ranges[i], TRUE);
+        m_cached_ranges[i] = NULL;
+    }
+}
+
+bool PhoneticSearchCache::reset() {
+    for (size_t i = 0; i < m_tables->len; ++i) {
+        search_table_t * table = (search_table_t *)
+            g_ptr_array_index(m_tables, i);
+        g_hash_table_remove_all(table->m_spans);
+    }
+    return true;
+}
+
+gpointer PhoneticSearchCache::get_table(FacadeChewingTable2 * table) {
+    search_table_t * item = NULL;
+    for (size_t i = 0; i < m_tables->len; ++i) {
+        search_table_t * cur = (search_table_t *)
+            g_ptr_array_index(m_tables, i);
+        if (table == cur->m_table) {
+            item = cur;
+            break;
+        }
+    }
+
+    if (NULL == item) {
+        item = new search_table_t;
+        item->m_table = table;
+        item->m_generation = table->get_generation();
+        item->m_spans = g_hash_table_new_full
+            (g_direct_hash, g_direct_equal, NULL, free_search_span);
+        g_ptr_array_add(m_tables, item);
+    }
+
+    /* the table is changed. */
+    if (item->m_generation != table->get_generation()) {
+        item->m_generation = table->get_generation();
+        g_hash_table_remove_all(item->m_spans);
+    }
+
+    return item;
+}
+
+int PhoneticSearchCache::search(FacadeChewingTable2 * table,
+                                PhoneticKeyMatrix * matrix,
+                                size_t start, size_t end,
+                                PhraseIndexRanges ranges) {
+    /* the matrix is changed. */
+    if (m_matrix != matrix ||
+        m_matrix_generation != matrix->get_generation()) {
+        m_matrix = matrix;
+        m_matrix_generation = matrix->get_generation();
+        reset();
+    }
+
+    search_table_t * item = (search_table_t *) get_table(table);
+
+    /* the matrix is shorter than 65536 columns. */
+    assert(end < G_MAXUINT16);
+    const guint key = (start << 16) | end;
+
+    search_span_t * span = (search_span_t *)
+        g_hash_table_lookup(item->m_spans, GUINT_TO_POINTER(key));
+
+    if (NULL == span) {
+        for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i)
+            g_array_set_size(m_cached_ranges[i], 0);
+
+        span = new search_span_t;
+        span->m_result = search_matrix
+            (table, matrix, start, end, m_cached_ranges);
+
+        for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+            GArray * & range = span->m_ranges[i];
+            range = NULL;
+
+            GArray * cached = m_cached_ranges[i];
+            if (0 == cached->len)
+                continue;
+
+            range = g_array_sized_new
+                (FALSE, FALSE, sizeof(PhraseIndexRange), cached->len);
+            g_array_append_vals(range, cached->data, cached->len);
+        }
+
+        g_hash_table_insert(item->m_spans, GUINT_TO_POINTER(key), span);
+    }
+
+    /* only the libraries in the ranges are matched. */
+    int result = span->m_result & ~SEARCH_OK;
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        GArray * range = span->m_ranges[i];
+        if (NULL == range || NULL == ranges[i])
+            continue;
+
+        g_array_append_vals(ranges[i], range->data, range->len);
+        result |= SEARCH_OK;
+    }
+
+    return result;
+}
+
 bool increase_pronunciation_possibility_recur(PhoneticKeyMatrix * matrix,
                                               size_t start, size_t end,
                                               GArray * cached_keys,
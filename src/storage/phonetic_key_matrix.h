@@ -66,12 +66,25 @@ public:
     /* when call this function,
        reserve one extra slot for the end slot. */
     bool set_size(size_t size) {
-        clear_all();
+        /* keep the existing columns to avoid the re-allocations. */
+        for (size_t i = size; i < m_table_content->len; ++i) {
+            GArray * column = (GArray *)
+                g_ptr_array_index(m_table_content, i);
+            g_array_free(column, TRUE);
+        }
 
+        const size_t len = m_table_content->len;
         g_ptr_array_set_size(m_table_content, size);
+
         for (size_t i = 0; i < m_table_content->len; ++i) {
-            g_ptr_array_index(m_table_content, i) =
-                g_array_new(TRUE, TRUE, sizeof(Item));
+            if (i < len) {
+                GArray * column = (GArray *)
+                    g_ptr_array_index(m_table_content, i);
+                g_array_set_size(column, 0);
+            } else {
+                g_ptr_array_index(m_table_content, i) =
+                    g_array_new(TRUE, TRUE, sizeof(Item));
+            }
         }
 
         return true;
@@ -119,6 +132,37 @@ public:
         return true;
     }
 
+    bool copy(PhoneticTable<Item> & other) {
+        set_size(other.size());
+
+        for (size_t i = 0; i < m_table_content->len; ++i) {
+            GArray * column = (GArray *)
+                g_ptr_array_index(m_table_content, i);
+            GArray * other_column = (GArray *)
+                g_ptr_array_index(other.m_table_content, i);
+            g_array_append_vals(column, other_column->data,
+                                other_column->len);
+        }
+
+        return true;
+    }
+
+    bool equal_column(size_t index, PhoneticTable<Item> & other) {
+        assert(index < m_table_content->len);
+        assert(index < other.m_table_content->len);
+
+        GArray * column = (GArray *)
+            g_ptr_array_index(m_table_content, index);
+        GArray * other_column = (GArray *)
+            g_ptr_array_index(other.m_table_content, index);
+
+        if (column->len != other_column->len)
+            return false;
+
+        return 0 == memcmp(column->data, other_column->data,
+                           column->len * sizeof(Item));
+    }
+
 };
 
 class PhoneticKeyMatrix {
@@ -126,8 +170,20 @@ protected:
     PhoneticTable<ChewingKey> m_keys;
     PhoneticTable<ChewingKeyRest> m_key_rests;
 
+    /* increased when the matrix is changed. */
+    guint32 m_generation;
+
 public:
+    PhoneticKeyMatrix() {
+        m_generation = 0;
+    }
+
+    guint32 get_generation() const {
+        return m_generation;
+    }
+
     bool clear_all() {
+        ++m_generation;
         return m_keys.clear_all() && m_key_rests.clear_all();
     }
 
@@ -138,6 +194,7 @@ public:
 
     /* reserve one extra slot, same as PhoneticTable. */
     bool set_size(size_t size) {
+        ++m_generation;
         return m_keys.set_size(size) && m_key_rests.set_size(size);
     }
 
@@ -152,6 +209,7 @@ public:
 
     bool append(size_t index, const ChewingKey & key,
                 const ChewingKeyRest & key_rest) {
+        ++m_generation;
         return m_keys.append(index, key) &&
             m_key_rests.append(index, key_rest);
     }
@@ -168,6 +226,27 @@ public:
             m_key_rests.get_item(index, row, key_rest);
     }
 
+    /* copy all columns from the other matrix. */
+    bool copy(PhoneticKeyMatrix * other) {
+        ++m_generation;
+        return m_keys.copy(other->m_keys) &&
+            m_key_rests.copy(other->m_key_rests);
+    }
+
+    /* the number of the leading columns same as the other matrix. */
+    size_t get_common_prefix_size(PhoneticKeyMatrix * other) {
+        const size_t length = std_lite::min(size(), other->size());
+
+        size_t i = 0;
+        for (; i < length; ++i) {
+            if (!m_keys.equal_column(i, other->m_keys))
+                break;
+            if (!m_key_rests.equal_column(i, other->m_key_rests))
+                break;
+        }
+        return i;
+    }
+
 };
 
 /**
@@ -222,6 +301,167 @@ bool increase_pronunciation_possibility(PhoneticKeyMatrix * matrix,
                                         size_t start, size_t end,
                                         GArray * cached_keys,
                                         PhraseItem & item, gint32 delta);
+
+/**
+ * PhoneticSpanCache:
+ *
+ * Memorize the key sequences of the matrix spans,
+ * and the pronunciation possibilities of the phrases in the spans.
+ *
+ * Note: reset it when the matrix or the phrase items are changed.
+ *
+ */
+class PhoneticSpanCache {
+private:
+    /* Disallow used outside. */
+    PhoneticSpanCache(const PhoneticSpanCache & cache);
+    PhoneticSpanCache & operator = (const PhoneticSpanCache & cache);
+
+protected:
+    PhoneticKeyMatrix * m_matrix;
+
+    /* start * the matrix size + end => span item, NULL if not memorized. */
+    GPtrArray * m_spans;
+
+    /* the allocated span items, the first m_num_used ones are in use,
+       the others are re-used by the next spans. */
+    GPtrArray * m_span_pool;
+    size_t m_num_used;
+
+    /* the enumerated keys of one span. */
+    GArray * m_cached_keys;
+
+    gpointer get_span(size_t start, size_t end);
+
+public:
+    /**
+     * PhoneticSpanCache::PhoneticSpanCache:
+     *
+     * The constructor of the PhoneticSpanCache.
+     *
+     */
+    PhoneticSpanCache();
+
+    /**
+     * PhoneticSpanCache::~PhoneticSpanCache:
+     *
+     * The destructor of the PhoneticSpanCache.
+     *
+     */
+    ~PhoneticSpanCache();
+
+    /**
+     * PhoneticSpanCache::reset:
+     * @matrix: the phonetic key matrix.
+     * @returns: whether the reset operation is successful.
+     *
+     * Drop all memorized spans, and use the matrix for the next spans.
+     *
+     */
+    bool reset(PhoneticKeyMatrix * matrix);
+
+    /**
+     * PhoneticSpanCache::lookup_pronunciation_possibility:
+     * @start: the start of the span.
+     * @end: the end of the span.
+     * @token: the token of the phrase item.
+     * @possibility: the pronunciation possibility.
+     * @returns: whether the possibility is known without the phrase item.
+     *
+     * Lookup the memorized pronunciation possibility, so the caller
+     * can skip to get the phrase item.
+     *
+     */
+    bool lookup_pronunciation_possibility(size_t start, size_t end,
+                                          phrase_token_t token,
+                                          gfloat & possibility);
+
+    /**
+     * PhoneticSpanCache::compute_pronunciation_possibility:
+     * @start: the start of the span.
+     * @end: the end of the span.
+     * @token: the token of the phrase item.
+     * @item: the phrase item.
+     * @returns: the pronunciation possibility.
+     *
+     * The same as compute_pronunciation_possibility,
+     * with the memorized key sequences and possibilities.
+     *
+     */
+    gfloat compute_pronunciation_possibility(size_t start, size_t end,
+                                             phrase_token_t token,
+                                             PhraseItem & item);
+};
+
+/**
+ * PhoneticSearchCache:
+ *
+ * Memorize the search_matrix results of the matrix spans,
+ * keyed by the span, the matrix generation and the table generation.
+ *
+ */
+class PhoneticSearchCache {
+private:
+    /* Disallow used outside. */
+    PhoneticSearchCache(const PhoneticSearchCache & cache);
+    PhoneticSearchCache & operator = (const PhoneticSearchCache & cache);
+
+protected:
+    PhoneticKeyMatrix * m_matrix;
+    guint32 m_matrix_generation;
+
+    /* Array of the memorized spans of each table. */
+    GPtrArray * m_tables;
+
+    /* the ranges of all libraries for the search. */
+    PhraseIndexRanges m_cached_ranges;
+
+    gpointer get_table(FacadeChewingTable2 * table);
+
+public:
+    /**
+     * PhoneticSearchCache::PhoneticSearchCache:
+     *
+     * The constructor of the PhoneticSearchCache.
+     *
+     */
+    PhoneticSearchCache();
+
+    /**
+     * PhoneticSearchCache::~PhoneticSearchCache:
+     *
+     * The destructor of the PhoneticSearchCache.
+     *
+     */
+    ~PhoneticSearchCache();
+
+    /**
+     * PhoneticSearchCache::reset:
+     * @returns: whether the reset operation is successful.
+     *
+     * Drop all memorized search results.
+     *
+     */
+    bool reset();
+
+    /**
+     * PhoneticSearchCache::search:
+     * @table: the chewing table.
+     * @matrix: the phonetic key matrix.
+     * @start: the start of the span.
+     * @end: the end of the span.
+     * @ranges: the array of GArrays to store the matched phrase token.
+     * @returns: the search result of enum SearchResult.
+     *
+     * The same as search_matrix, with the memorized search results.
+     *
+     */
+    int search(FacadeChewingTable2 * table,
+               PhoneticKeyMatrix * matrix,
+               size_t start, size_t end,
+               PhraseIndexRanges ranges);
+};
+
 };
 
 #endif
@@ -140,20 +140,66 @@ guint32 SubPhraseIndex::get_phrase_index_total_freq(){
     return m_total_freq;
 }
 
-int SubPhraseIndex::add_unigram_frequency(phrase_token_t token, guint32 delta){
-    table_offset_t offset;
-    guint32 freq;
+int SubPhraseIndex::locate_phrase_item(phrase_token_t token,
+                                       MemoryChunk * & content,
+                                       table_offset_t & offset){
+    token &= PHRASE_MASK;
+
+    /* the overlay hides the phrase items in the base. */
+    gpointer value = NULL;
+    if ( m_overlay_index &&
+         g_hash_table_lookup_extended(m_overlay_index,
+                                      GUINT_TO_POINTER(token), NULL, &value) ){
+        content = &m_overlay_content;
+        offset = GPOINTER_TO_UINT(value);
+        return 0 == offset ? ERROR_NO_ITEM : ERROR_OK;
+    }
+
     bool result = m_phrase_index.get_content
-        ((token & PHRASE_MASK) 
-         * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
+        (token * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
 
     if ( !result )
         return ERROR_OUT_OF_RANGE;
 
+    content = &m_phrase_content;
     if ( 0 == offset )
         return ERROR_NO_ITEM;
 
-    result = m_phrase_content.get_content
+    return ERROR_OK;
+}
+
+size_t SubPhraseIndex::get_writable_item_size(phrase_token_t token){
+    MemoryChunk * content = NULL;
+    table_offset_t offset;
+
+    if ( locate_phrase_item(token, content, offset) )
+        return 0;
+
+    /* the phrase items of the loaded chunk are shared. */
+    if ( content != &get_writable_content() )
+        return 0;
+
+    PhraseItem item;
+    if ( get_phrase_item(token, item) )
+        return 0;
+    return item.m_chunk.size();
+}
+
+int SubPhraseIndex::add_unigram_frequency(phrase_token_t token, guint32 delta){
+    MemoryChunk * content = NULL;
+    table_offset_t offset;
+    guint32 freq;
+
+    /* copy the phrase item of the base into the overlay. */
+    PhraseItem item;
+    int retval = get_writable_phrase_item(token, item);
+    if ( retval )
+        return retval;
+
+    retval = locate_phrase_item(token, content, offset);
+    assert(ERROR_OK == retval);
+
+    bool result = content->get_content
         (offset + sizeof(guint8) + sizeof(guint8), &freq, sizeof(guint32));
 
     if ( !result )
@@ -165,47 +211,89 @@ int SubPhraseIndex::add_unigram_frequency(phrase_token_t token, guint32 delta){
 
     freq += delta;
     m_total_freq += delta;
-    m_phrase_content.set_content(offset + sizeof(guint8) + sizeof(guint8), &freq, sizeof(guint32));
+    content->set_content(offset + sizeof(guint8) + sizeof(guint8), &freq, sizeof(guint32));
+
+    const size_t index = token & PHRASE_MASK;
+    phrase_hot_item_t * hot_item =
+        get_hot_block(index / hot_block_size) + index % hot_block_size;
+    hot_item->m_unigram_frequency = freq;
 
     return ERROR_OK;
 }
 
 int SubPhraseIndex::get_phrase_item(phrase_token_t token, PhraseItem & item){
+    MemoryChunk * content = NULL;
     table_offset_t offset;
     guint8 phrase_length;
     guint8 n_prons;
-    
-    bool result = m_phrase_index.get_content
-        ((token & PHRASE_MASK) 
-         * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
-
-    if ( !result )
-        return ERROR_OUT_OF_RANGE;
 
-    if ( 0 == offset )
-        return ERROR_NO_ITEM;
+    int retval = locate_phrase_item(token, content, offset);
+    if ( retval )
+        return retval;
 
-    result = m_phrase_content.get_content(offset, &phrase_length, sizeof(guint8));
+    bool result = content->get_content(offset, &phrase_length, sizeof(guint8));
     if ( !result ) 
         return ERROR_FILE_CORRUPTION;
     
-    result = m_phrase_content.get_content(offset+sizeof(guint8), &n_prons, sizeof(guint8));
+    result = content->get_content(offset+sizeof(guint8), &n_prons, sizeof(guint8));
     if ( !result ) 
         return ERROR_FILE_CORRUPTION;
 
     size_t length = phrase_item_header + phrase_length * sizeof ( ucs4_t ) + n_prons * ( phrase_length * sizeof (ChewingKey) + sizeof(guint32) );
-    item.m_chunk.set_chunk((char *)m_phrase_content.begin() + offset, length, NULL);
+    item.m_chunk.set_chunk((char *)content->begin() + offset, length, NULL);
     return ERROR_OK;
 }
 
+int SubPhraseIndex::get_writable_phrase_item(phrase_token_t token,
+                                             PhraseItem & item){
+    MemoryChunk * content = NULL;
+    table_offset_t offset;
+
+    int retval = locate_phrase_item(token, content, offset);
+    if ( retval )
+        return retval;
+
+    if ( m_overlay_index && content != &m_overlay_content ){
+        /* copy on write. */
+        PhraseItem base_item;
+        retval = get_phrase_item(token, base_item);
+        if ( retval )
+            return retval;
+
+        offset = m_overlay_content.size();
+        if ( 0 == offset )
+            offset = 8;
+        m_overlay_content.set_content(offset, base_item.m_chunk.begin(),
+                                      base_item.m_chunk.size());
+        g_hash_table_insert(m_overlay_index,
+                            GUINT_TO_POINTER(token & PHRASE_MASK),
+                            GUINT_TO_POINTER(offset));
+    }
+
+    return get_phrase_item(token, item);
+}
+
 int SubPhraseIndex::add_phrase_item(phrase_token_t token, PhraseItem * item){
-    table_offset_t offset = m_phrase_content.size();
+    MemoryChunk & content = get_writable_content();
+
+    /* the replaced phrase item is unreachable. */
+    m_dead_bytes += get_writable_item_size(token);
+
+    table_offset_t offset = content.size();
     if ( 0 == offset )
         offset = 8;
-    m_phrase_content.set_content(offset, item->m_chunk.begin(), item->m_chunk.size());
-    m_phrase_index.set_content((token & PHRASE_MASK) 
-                               * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
+    content.set_content(offset, item->m_chunk.begin(), item->m_chunk.size());
+
+    if ( m_overlay_index ){
+        g_hash_table_insert(m_overlay_index,
+                            GUINT_TO_POINTER(token & PHRASE_MASK),
+                            GUINT_TO_POINTER(offset));
+    } else {
+        m_phrase_index.set_content((token & PHRASE_MASK)
+                                   * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
+    }
     m_total_freq += item->get_unigram_frequency();
+    update_hot_item(token, item);
     return ERROR_OK;
 }
 
@@ -220,13 +308,131 @@ int SubPhraseIndex::remove_phrase_item(phrase_token_t token, PhraseItem * & item
     //implictly copy data from m_chunk_content.
     item->m_chunk.set_content(0, (char *) old_item.m_chunk.begin() , old_item.m_chunk.size());
 
-    const table_offset_t zero_const = 0;
-    m_phrase_index.set_content((token & PHRASE_MASK)
-                               * sizeof(table_offset_t), &zero_const, sizeof(table_offset_t));
+    m_dead_bytes += get_writable_item_size(token);
+
+    if ( m_overlay_index ){
+        /* hide the phrase item in the base. */
+        g_hash_table_insert(m_overlay_index,
+                            GUINT_TO_POINTER(token & PHRASE_MASK),
+                            GUINT_TO_POINTER(0));
+    } else {
+        const table_offset_t zero_const = 0;
+        m_phrase_index.set_content((token & PHRASE_MASK)
+                                   * sizeof(table_offset_t), &zero_const, sizeof(table_offset_t));
+    }
     m_total_freq -= item->get_unigram_frequency();
+    update_hot_item(token, NULL);
     return ERROR_OK;
 }
 
+bool SubPhraseIndex::compact_overlay(){
+    if ( !m_overlay_index )
+        return false;
+
+    MemoryChunk new_content;
+    GHashTable * new_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    GHashTableIter iter;
+    gpointer key = NULL, value = NULL;
+    g_hash_table_iter_init(&iter, m_overlay_index);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        phrase_token_t token = GPOINTER_TO_UINT(key);
+        table_offset_t offset = GPOINTER_TO_UINT(value);
+
+        /* keep the removed phrase items hidden. */
+        if ( 0 == offset ){
+            g_hash_table_insert(new_index, key, GUINT_TO_POINTER(0));
+            continue;
+        }
+
+        PhraseItem item;
+        int retval = get_phrase_item(token, item);
+        assert(ERROR_OK == retval);
+
+        offset = new_content.size();
+        if ( 0 == offset )
+            offset = 8;
+        new_content.set_content(offset, item.m_chunk.begin(),
+                                item.m_chunk.size());
+        g_hash_table_insert(new_index, key, GUINT_TO_POINTER(offset));
+    }
+
+    g_hash_table_destroy(m_overlay_index);
+    m_overlay_index = new_index;
+
+    m_overlay_content.set_size(0);
+    m_overlay_content.set_content(0, new_content.begin(), new_content.size());
+    m_dead_bytes = 0;
+    return true;
+}
+
+/* fill the block on the first access, the readers of the context
+   may fill the blocks from different threads. */
+phrase_hot_item_t * SubPhraseIndex::get_hot_block(size_t block){
+    assert(block < m_hot_blocks->len);
+    gpointer * slot = &g_ptr_array_index(m_hot_blocks, block);
+
+    phrase_hot_item_t * hot_items = (phrase_hot_item_t *)
+        g_atomic_pointer_get(slot);
+    if (hot_items)
+        return hot_items;
+
+    g_mutex_lock(&m_hot_mutex);
+    hot_items = (phrase_hot_item_t *) g_atomic_pointer_get(slot);
+    if (NULL == hot_items) {
+        hot_items = g_new0(phrase_hot_item_t, hot_block_size);
+
+        PhraseItem item;
+        const phrase_token_t begin = block * hot_block_size;
+        for (size_t i = 0; i < hot_block_size; ++i) {
+            if (ERROR_OK != get_phrase_item(begin + i, item))
+                continue;
+
+            hot_items[i].m_unigram_frequency = item.get_unigram_frequency();
+            hot_items[i].m_phrase_length = item.get_phrase_length();
+            hot_items[i].m_n_pronunciation = item.get_n_pronunciation();
+        }
+
+        g_atomic_pointer_set(slot, hot_items);
+    }
+    g_mutex_unlock(&m_hot_mutex);
+
+    return hot_items;
+}
+
+void SubPhraseIndex::update_hot_item(phrase_token_t token, PhraseItem * item){
+    const size_t index = token & PHRASE_MASK;
+
+    /* the skipped tokens have no phrase items. */
+    if (index >= m_num_hot_items) {
+        m_num_hot_items = index + 1;
+        const size_t num_blocks =
+            (m_num_hot_items + hot_block_size - 1) / hot_block_size;
+        if (num_blocks > m_hot_blocks->len)
+            g_ptr_array_set_size(m_hot_blocks, num_blocks);
+    }
+
+    phrase_hot_item_t * hot_item =
+        get_hot_block(index / hot_block_size) + index % hot_block_size;
+    memset(hot_item, 0, sizeof(phrase_hot_item_t));
+
+    if (item) {
+        hot_item->m_unigram_frequency = item->get_unigram_frequency();
+        hot_item->m_phrase_length = item->get_phrase_length();
+        hot_item->m_n_pronunciation = item->get_n_pronunciation();
+    }
+}
+
+void SubPhraseIndex::reset_hot_items(size_t num){
+    for (size_t i = 0; i < m_hot_blocks->len; ++i)
+        g_free(g_ptr_array_index(m_hot_blocks, i));
+
+    m_num_hot_items = num;
+    g_ptr_array_set_size(m_hot_blocks, 0);
+    g_ptr_array_set_size(m_hot_blocks,
+                         (num + hot_block_size - 1) / hot_block_size);
+}
+
 bool FacadePhraseIndex::load(guint8 phrase_index, MemoryChunk * chunk){
     SubPhraseIndex * & sub_phrases = m_sub_phrase_indices[phrase_index];
     if ( !sub_phrases ){
@@ -258,6 +464,34 @@ bool FacadePhraseIndex::unload(guint8 phrase_index){
     m_total_freq -= sub_phrases->get_phrase_index_total_freq();
     delete sub_phrases;
     sub_phrases = NULL;
+
+    PhraseIndexLogger * & journal = m_journals[phrase_index];
+    if ( journal ){
+        delete journal;
+        journal = NULL;
+    }
+    return true;
+}
+
+bool FacadePhraseIndex::move_sub_phrase(guint8 phrase_index,
+                                        FacadePhraseIndex * source){
+    SubPhraseIndex * & sub_phrases = m_sub_phrase_indices[phrase_index];
+    SubPhraseIndex * & source_sub_phrases =
+        source->m_sub_phrase_indices[phrase_index];
+    if ( sub_phrases || !source_sub_phrases )
+        return false;
+
+    guint32 total_freq = source_sub_phrases->get_phrase_index_total_freq();
+    source->m_total_freq -= total_freq;
+    m_total_freq += total_freq;
+    sub_phrases = source_sub_phrases;
+    source_sub_phrases = NULL;
+
+    PhraseIndexLogger * & journal = m_journals[phrase_index];
+    if ( journal )
+        delete journal;
+    journal = source->m_journals[phrase_index];
+    source->m_journals[phrase_index] = NULL;
     return true;
 }
 
@@ -324,6 +558,113 @@ bool FacadePhraseIndex::merge_with_mask(guint8 phrase_index,
     return retval;
 }
 
+bool FacadePhraseIndex::start_journal(guint8 phrase_index){
+    SubPhraseIndex * sub_phrases = m_sub_phrase_indices[phrase_index];
+    if ( !sub_phrases )
+        return false;
+
+    PhraseIndexLogger * & journal = m_journals[phrase_index];
+    if ( journal )
+        delete journal;
+    journal = new PhraseIndexLogger;
+    return true;
+}
+
+bool FacadePhraseIndex::flush_journal(guint8 phrase_index,
+                                      MemoryChunk * tail){
+    PhraseIndexLogger * & journal = m_journals[phrase_index];
+    if ( !journal )
+        return false;
+
+    journal->store(tail);
+    /* drop the flushed records. */
+    journal->load(new MemoryChunk);
+    return true;
+}
+
+void FacadePhraseIndex::journal_add_record(phrase_token_t token){
+    PhraseItem item;
+    if ( get_phrase_item(token, item) )
+        return;
+
+    guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
+    m_journals[index]->append_record(LOG_ADD_RECORD, token,
+                                     NULL, &(item.m_chunk));
+}
+
+void FacadePhraseIndex::journal_remove_record(phrase_token_t token,
+                                              PhraseItem * item){
+    guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
+    m_journals[index]->append_record(LOG_REMOVE_RECORD, token,
+                                     &(item->m_chunk), NULL);
+}
+
+bool FacadePhraseIndex::replay_journal(guint8 phrase_index,
+                                       MemoryChunk * journal){
+    SubPhraseIndex * & sub_phrases = m_sub_phrase_indices[phrase_index];
+    if ( !sub_phrases )
+        return false;
+
+    m_total_freq -= sub_phrases->get_phrase_index_total_freq();
+    PhraseIndexLogger logger;
+    logger.load(journal);
+
+    bool retval = sub_phrases->replay(&logger);
+    m_total_freq += sub_phrases->get_phrase_index_total_freq();
+
+    return retval;
+}
+
+bool FacadePhraseIndex::replay_journal_with_mask(guint8 phrase_index,
+                                                 MemoryChunk * journal,
+                                                 phrase_token_t mask,
+                                                 phrase_token_t value){
+    SubPhraseIndex * & sub_phrases = m_sub_phrase_indices[phrase_index];
+    if ( !sub_phrases )
+        return false;
+
+    /* check mask and value. */
+    phrase_token_t index_mask = PHRASE_INDEX_LIBRARY_INDEX(mask);
+    phrase_token_t index_value = PHRASE_INDEX_LIBRARY_INDEX(value);
+    if ((phrase_index & index_mask) != index_value)
+        return false;
+
+    /* calculate the sub phrase index mask and value. */
+    mask &= PHRASE_MASK; value &= PHRASE_MASK;
+
+    /* skip the records of the masked tokens. */
+    PhraseIndexLogger oldlogger, newlogger;
+    oldlogger.load(journal);
+
+    LOG_TYPE log_type = LOG_INVALID_RECORD;
+    phrase_token_t token = null_token;
+    MemoryChunk oldchunk, newchunk;
+
+    while (oldlogger.has_next_record()) {
+        if (!oldlogger.next_record(log_type, token, &oldchunk, &newchunk))
+            break;
+
+        if ((token & mask) == value)
+            continue;
+
+        switch(log_type) {
+        case LOG_ADD_RECORD:
+            newlogger.append_record(log_type, token, NULL, &newchunk);
+            break;
+        case LOG_REMOVE_RECORD:
+            newlogger.append_record(log_type, token, &oldchunk, NULL);
+            break;
+        default:
+            return false;
+        }
+    }
+
+    m_total_freq -= sub_phrases->get_phrase_index_total_freq();
+    bool retval = sub_phrases->replay(&newlogger);
+    m_total_freq += sub_phrases->get_phrase_index_total_freq();
+
+    return retval;
+}
 
 bool SubPhraseIndex::load(MemoryChunk * chunk, 
                           table_offset_t offset, table_offset_t end){
@@ -352,11 +693,40 @@ bool SubPhraseIndex::load(MemoryChunk * chunk,
     m_phrase_content.set_chunk(buf_begin + index_two, 
                                index_three - 1 - index_two, NULL);
     g_return_val_if_fail( index_three <= end, FALSE);
+
+    /* the loaded chunk is read-only, changes go to the overlay. */
+    if ( m_overlay_index )
+        g_hash_table_remove_all(m_overlay_index);
+    else
+        m_overlay_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+    m_overlay_content.set_size(0);
+    m_dead_bytes = 0;
+
+    /* the hot items are filled on the first access. */
+    reset_hot_items(m_phrase_index.size() / sizeof(table_offset_t));
     return true;
 }
 
 bool SubPhraseIndex::store(MemoryChunk * new_chunk, 
                            table_offset_t offset, table_offset_t& end){
+    if ( m_overlay_index ){
+        /* merge the overlay with the base. */
+        PhraseIndexRange range;
+        get_range(range);
+
+        SubPhraseIndex flat;
+        PhraseItem item;
+        for ( phrase_token_t token = range.m_range_begin;
+              token < range.m_range_end; ++token ){
+            if ( ERROR_OK != get_phrase_item(token, item) )
+                continue;
+            flat.add_phrase_item(token, &item);
+        }
+
+        flat.m_total_freq = m_total_freq;
+        return flat.store(new_chunk, offset, end);
+    }
+
     new_chunk->set_content(offset, &m_total_freq, sizeof(guint32));
     table_offset_t index = offset + sizeof(guint32);
         
@@ -468,7 +838,7 @@ bool SubPhraseIndex::merge(PhraseIndexLogger * logger){
             break;
         }
         case LOG_MODIFY_RECORD:{
-            get_phrase_item(token, item);
+            get_writable_phrase_item(token, item);
             olditem.m_chunk.set_chunk(oldchunk.begin(), oldchunk.size(),
                                       NULL);
             newitem.m_chunk.set_chunk(newchunk.begin(), newchunk.size(),
@@ -490,6 +860,8 @@ bool SubPhraseIndex::merge(PhraseIndexLogger * logger){
                  */
                 memmove(item.m_chunk.begin(), newchunk.begin(),
                         newchunk.size());
+                m_dead_bytes += item.m_chunk.size() - newchunk.size();
+                update_hot_item(token, &newitem);
             }
             break;
         }
@@ -512,6 +884,42 @@ bool SubPhraseIndex::merge(PhraseIndexLogger * logger){
     return true;
 }
 
+bool SubPhraseIndex::replay(PhraseIndexLogger * logger){
+    LOG_TYPE log_type = LOG_INVALID_RECORD;
+    phrase_token_t token = null_token;
+    MemoryChunk oldchunk, newchunk;
+    PhraseItem newitem, * tmpitem;
+
+    while(logger->has_next_record()){
+        bool retval = logger->next_record
+            (log_type, token, &oldchunk, &newchunk);
+
+        if (!retval)
+            break;
+
+        /* the records store the whole phrase items,
+           replace the current phrase item anyway. */
+        tmpitem = NULL;
+        remove_phrase_item(token, tmpitem);
+        if (tmpitem)
+            delete tmpitem;
+
+        switch(log_type){
+        case LOG_ADD_RECORD:{
+            newitem.m_chunk.set_chunk(newchunk.begin(), newchunk.size(),
+                                      NULL);
+            add_phrase_item(token, &newitem);
+            break;
+        }
+        case LOG_REMOVE_RECORD:
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
 bool FacadePhraseIndex::load_text(guint8 phrase_index, FILE * infile){
     SubPhraseIndex * & sub_phrases = m_sub_phrase_indices[phrase_index];
     if ( !sub_phrases ){
@@ -613,52 +1021,68 @@ int SubPhraseIndex::get_range(/* out */ PhraseIndexRange & range){
     const table_offset_t * begin = (const table_offset_t *)m_phrase_index.begin();
     const table_offset_t * end = (const table_offset_t *)m_phrase_index.end();
 
-    if (begin == end) {
-        /* skip empty sub phrase index. */
-        range.m_range_begin = 1;
-        range.m_range_end = 1;
-        return ERROR_OK;
-    }
-
     /* remove trailing zeros. */
-    const table_offset_t * poffset = NULL;
-    for (poffset = end; poffset > begin + 1; --poffset) {
-        if (0 !=  *(poffset - 1))
-            break;
+    const table_offset_t * poffset = begin + 1;
+    if (begin != end) {
+        for (poffset = end; poffset > begin + 1; --poffset) {
+            if (0 !=  *(poffset - 1))
+                break;
+        }
     }
 
     range.m_range_begin = 1; /* token starts with 1 in gen_pinyin_table. */
     range.m_range_end = poffset - begin; /* removed zeros. */
 
+    if ( m_overlay_index ){
+        /* the overlay may add the tokens beyond the base. */
+        GHashTableIter iter;
+        gpointer key = NULL, value = NULL;
+        g_hash_table_iter_init(&iter, m_overlay_index);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            if ( 0 == GPOINTER_TO_UINT(value) )
+                continue;
+            range.m_range_end = std_lite::max
+                (range.m_range_end, (phrase_token_t)GPOINTER_TO_UINT(key) + 1);
+        }
+    }
+
     return ERROR_OK;
 }
 
 bool FacadePhraseIndex::compact(){
-    for ( size_t index = 0; index < PHRASE_INDEX_LIBRARY_COUNT; ++index) {
-        SubPhraseIndex * sub_phrase = m_sub_phrase_indices[index];
-        if ( !sub_phrase )
-            continue;
+    for ( size_t index = 0; index < PHRASE_INDEX_LIBRARY_COUNT; ++index)
+        compact(index);
+    return true;
+}
 
-        PhraseIndexRange range;
-        int result = sub_phrase->get_range(range);
-        if ( result != ERROR_OK )
-            continue;
+bool FacadePhraseIndex::compact(guint8 phrase_index){
+    SubPhraseIndex * sub_phrase = m_sub_phrase_indices[phrase_index];
+    if ( !sub_phrase )
+        return false;
 
-        SubPhraseIndex * new_sub_phrase =  new SubPhraseIndex;
+    /* keep the loaded chunk shared. */
+    if ( sub_phrase->compact_overlay() )
+        return true;
 
-        PhraseItem item;
-        for ( phrase_token_t token = range.m_range_begin;
-              token < range.m_range_end;
-              ++token ) {
-            result = sub_phrase->get_phrase_item(token, item);
-            if ( result != ERROR_OK )
-                continue;
-            new_sub_phrase->add_phrase_item(token, &item);
-        }
+    PhraseIndexRange range;
+    int result = sub_phrase->get_range(range);
+    if ( result != ERROR_OK )
+        return false;
+
+    SubPhraseIndex * new_sub_phrase =  new SubPhraseIndex;
 
-        delete sub_phrase;
-        m_sub_phrase_indices[index] = new_sub_phrase;
+    PhraseItem item;
+    for ( phrase_token_t token = range.m_range_begin;
+          token < range.m_range_end;
+          ++token ) {
+        result = sub_phrase->get_phrase_item(token, item);
+        if ( result != ERROR_OK )
+            continue;
+        new_sub_phrase->add_phrase_item(token, &item);
     }
+
+    delete sub_phrase;
+    m_sub_phrase_indices[phrase_index] = new_sub_phrase;
     return true;
 }
 
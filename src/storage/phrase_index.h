@@ -61,6 +61,7 @@ const size_t phrase_item_header = sizeof(guint8) + sizeof(guint8) + sizeof(guint
  */
 class PhraseItem{
     friend class SubPhraseIndex;
+    friend class FacadePhraseIndex;
     friend bool _compute_new_header(PhraseIndexLogger * logger,
                                     phrase_token_t mask,
                                     phrase_token_t value,
@@ -242,6 +243,24 @@ public:
     }
 };
 
+/**
+ * phrase_hot_item_t:
+ *
+ * The header fields of the phrase item, which are read by the lookup
+ * for every candidate token.
+ *
+ * Note: zero phrase length means no phrase item.
+ *
+ */
+struct phrase_hot_item_t{
+    guint32 m_unigram_frequency;
+    guint8 m_phrase_length;
+    guint8 m_n_pronunciation;
+};
+
+/* the number of the hot items in one block. */
+const size_t hot_block_size = 256;
+
 /*
  *  In Sub Phrase Index, token == (token & PHRASE_MASK).
  */
@@ -259,10 +278,44 @@ private:
     MemoryChunk m_phrase_content;
     MemoryChunk * m_chunk;
 
+    /* the token-indexed blocks of phrase_hot_item_t, each block is
+       filled from the phrase items on the first access, NULL until then,
+       so the load does not read every phrase item. */
+    GPtrArray * m_hot_blocks;
+    size_t m_num_hot_items;
+    GMutex m_hot_mutex;
+
+    /* the changed phrase items of the loaded read-only chunk,
+       NULL when the sub phrase index is not loaded. */
+    /* token => offset in m_overlay_content, zero for removed item. */
+    GHashTable * m_overlay_index;
+    MemoryChunk m_overlay_content;
+
+    /* the unreachable bytes of the writable phrase content. */
+    size_t m_dead_bytes;
+
+    int locate_phrase_item(phrase_token_t token,
+                           MemoryChunk * & content, table_offset_t & offset);
+    MemoryChunk & get_writable_content(){
+        return m_overlay_index ? m_overlay_content : m_phrase_content;
+    }
+    size_t get_writable_item_size(phrase_token_t token);
+
+    phrase_hot_item_t * get_hot_block(size_t block);
+    void update_hot_item(phrase_token_t token, PhraseItem * item);
+    void reset_hot_items(size_t num);
+
     void reset(){
         m_total_freq = 0;
         m_phrase_index.set_size(0);
         m_phrase_content.set_size(0);
+        reset_hot_items(0);
+        if ( m_overlay_index ){
+            g_hash_table_destroy(m_overlay_index);
+            m_overlay_index = NULL;
+        }
+        m_overlay_content.set_size(0);
+        m_dead_bytes = 0;
         if ( m_chunk ){
             delete m_chunk;
             m_chunk = NULL;
@@ -278,6 +331,11 @@ public:
      */
     SubPhraseIndex():m_total_freq(0){
         m_chunk = NULL;
+        m_hot_blocks = g_ptr_array_new();
+        m_num_hot_items = 0;
+        g_mutex_init(&m_hot_mutex);
+        m_overlay_index = NULL;
+        m_dead_bytes = 0;
     }
 
     /**
@@ -288,6 +346,8 @@ public:
      */
     ~SubPhraseIndex(){
         reset();
+        g_ptr_array_free(m_hot_blocks, TRUE);
+        g_mutex_clear(&m_hot_mutex);
     }
     
     /**
@@ -340,6 +400,17 @@ public:
      */
     bool merge(PhraseIndexLogger * logger);
 
+    /**
+     * SubPhraseIndex::replay:
+     * @logger: the journal of the phrase item changes.
+     * @returns: whether the replay operation is successful.
+     *
+     * Replay the journal with this sub phrase index, the add record
+     * replaces the phrase item, and the remove record removes it.
+     *
+     */
+    bool replay(PhraseIndexLogger * logger);
+
     /**
      * SubPhraseIndex::get_range:
      * @range: the token range.
@@ -383,13 +454,47 @@ public:
      *
      * Get the phrase item from this sub phrase index.
      *
-     * Note:get_phrase_item function can't modify the phrase item size,
-     * but can increment the freq of the special pronunciation,
-     * or change the content without size increasing.
+     * Note: the phrase item may point to the read-only loaded chunk,
+     * use get_writable_phrase_item for the in-place changes.
      *
      */
     int get_phrase_item(phrase_token_t token, PhraseItem & item);
 
+    /**
+     * SubPhraseIndex::get_writable_phrase_item:
+     * @token: the phrase token.
+     * @item: the phrase item of the token.
+     * @returns: the status of the get operation.
+     *
+     * Get the phrase item for the in-place changes, the phrase item
+     * of the loaded chunk is copied into the overlay at first.
+     *
+     */
+    int get_writable_phrase_item(phrase_token_t token, PhraseItem & item);
+
+    /**
+     * SubPhraseIndex::get_hot_item:
+     * @token: the phrase token.
+     * @item: the header fields of the phrase item.
+     * @returns: the status of the get operation.
+     *
+     * Get the phrase length, the number of the pronunciations and
+     * the uni-gram frequency without locating the phrase item.
+     *
+     */
+    int get_hot_item(phrase_token_t token, phrase_hot_item_t & item){
+        const size_t index = token & PHRASE_MASK;
+        if (index >= m_num_hot_items)
+            return ERROR_OUT_OF_RANGE;
+
+        const phrase_hot_item_t * block =
+            get_hot_block(index / hot_block_size);
+        item = block[index % hot_block_size];
+        if (0 == item.m_phrase_length)
+            return ERROR_NO_ITEM;
+        return ERROR_OK;
+    }
+
     /**
      * SubPhraseIndex::add_phrase_item:
      * @token: the phrase token.
@@ -415,6 +520,31 @@ public:
      */
     int remove_phrase_item(phrase_token_t token, /* out */ PhraseItem * & item);
 
+    /**
+     * SubPhraseIndex::compact_overlay:
+     * @returns: whether the sub phrase index has the overlay.
+     *
+     * Drop the replaced phrase items in the overlay.
+     *
+     */
+    bool compact_overlay();
+
+    /**
+     * SubPhraseIndex::get_content_usage:
+     * @live_bytes: the bytes of the reachable phrase items.
+     * @total_bytes: the bytes of the writable phrase content.
+     *
+     * Get the fragmentation of the writable phrase content, which is
+     * the overlay of the loaded sub phrase index.
+     *
+     */
+    void get_content_usage(/* out */ size_t & live_bytes,
+                           /* out */ size_t & total_bytes){
+        total_bytes = get_writable_content().size();
+        assert(m_dead_bytes <= total_bytes);
+        live_bytes = total_bytes - m_dead_bytes;
+    }
+
     /**
      * SubPhraseIndex::mask_out:
      * @mask: the mask.
@@ -437,6 +567,11 @@ class FacadePhraseIndex{
 private:
     guint32 m_total_freq;
     SubPhraseIndex * m_sub_phrase_indices[PHRASE_INDEX_LIBRARY_COUNT];
+    /* the pending journal records, NULL when not journaled. */
+    PhraseIndexLogger * m_journals[PHRASE_INDEX_LIBRARY_COUNT];
+
+    void journal_add_record(phrase_token_t token);
+    void journal_remove_record(phrase_token_t token, PhraseItem * item);
 public:
     /**
      * FacadePhraseIndex::FacadePhraseIndex:
@@ -447,6 +582,7 @@ public:
     FacadePhraseIndex(){
         m_total_freq = 0;
         memset(m_sub_phrase_indices, 0, sizeof(m_sub_phrase_indices));
+        memset(m_journals, 0, sizeof(m_journals));
     }
 
     /**
@@ -461,6 +597,10 @@ public:
                 delete m_sub_phrase_indices[i];
                 m_sub_phrase_indices[i] = NULL;
             }
+            if ( m_journals[i] ){
+                delete m_journals[i];
+                m_journals[i] = NULL;
+            }
         }
     }
 
@@ -508,6 +648,18 @@ public:
      */
     bool unload(guint8 phrase_index);
 
+    /**
+     * FacadePhraseIndex::move_sub_phrase:
+     * @phrase_index: the index of sub phrase index to be moved.
+     * @source: the facade phrase index which loaded the sub phrase index.
+     * @returns: whether the move operation is successful.
+     *
+     * Move one sub phrase index and its journal from the source,
+     * used to load the sub phrase indices in the threads.
+     *
+     */
+    bool move_sub_phrase(guint8 phrase_index, FacadePhraseIndex * source);
+
 
     /**
      * FacadePhraseIndex::diff:
@@ -553,6 +705,58 @@ public:
     bool merge_with_mask(guint8 phrase_index, MemoryChunk * log,
                          phrase_token_t mask, phrase_token_t value);
 
+    /**
+     * FacadePhraseIndex::start_journal:
+     * @phrase_index: the index of sub phrase index to be journaled.
+     * @returns: whether the start operation is successful.
+     *
+     * Record the later changes of the sub phrase index in the journal,
+     * and drop the pending journal records.
+     *
+     */
+    bool start_journal(guint8 phrase_index);
+
+    /**
+     * FacadePhraseIndex::flush_journal:
+     * @phrase_index: the index of the journaled sub phrase index.
+     * @tail: the memory chunk to store the pending journal records.
+     * @returns: whether the sub phrase index is journaled.
+     *
+     * Move the pending journal records to the tail, which is appended
+     * to the journal file in user home directory.
+     *
+     */
+    bool flush_journal(guint8 phrase_index, MemoryChunk * tail);
+
+    /**
+     * FacadePhraseIndex::replay_journal:
+     * @phrase_index: the index of sub phrase index to be replayed.
+     * @journal: the journal in user home directory.
+     * @returns: whether the replay operation is successful.
+     *
+     * Replay the journal after merging the logger of difference.
+     *
+     * Note: the ownership of journal is transfered here.
+     *
+     */
+    bool replay_journal(guint8 phrase_index, MemoryChunk * journal);
+
+    /**
+     * FacadePhraseIndex::replay_journal_with_mask:
+     * @phrase_index: the index of sub phrase index to be replayed.
+     * @journal: the journal in user home directory.
+     * @mask: the mask.
+     * @value: the value.
+     * @returns: whether the replay operation is successful.
+     *
+     * Replay the journal with mask operation.
+     *
+     * Note: the ownership of journal is transfered here.
+     *
+     */
+    bool replay_journal_with_mask(guint8 phrase_index, MemoryChunk * journal,
+                                  phrase_token_t mask, phrase_token_t value);
+
     /**
      * FacadePhraseIndex::compact:
      * @returns: whether the compact operation is successful.
@@ -562,6 +766,37 @@ public:
      */
     bool compact();
 
+    /**
+     * FacadePhraseIndex::compact:
+     * @phrase_index: the index of sub phrase index to be compacted.
+     * @returns: whether the compact operation is successful.
+     *
+     * Compact one sub phrase index memory usage.
+     *
+     */
+    bool compact(guint8 phrase_index);
+
+    /**
+     * FacadePhraseIndex::get_content_usage:
+     * @phrase_index: the index of sub phrase index.
+     * @live_bytes: the bytes of the reachable phrase items.
+     * @total_bytes: the bytes of the writable phrase content.
+     * @returns: whether the sub phrase index exists.
+     *
+     * Get the fragmentation of the sub phrase index, compact() drops
+     * the unreachable bytes.
+     *
+     */
+    bool get_content_usage(guint8 phrase_index,
+                           /* out */ size_t & live_bytes,
+                           /* out */ size_t & total_bytes){
+        SubPhraseIndex * sub_phrase = m_sub_phrase_indices[phrase_index];
+        if ( !sub_phrase )
+            return false;
+        sub_phrase->get_content_usage(live_bytes, total_bytes);
+        return true;
+    }
+
     /**
      * FacadePhraseIndex::mask_out:
      * @phrase_index: the index of sub phrase index.
@@ -627,7 +862,10 @@ public:
         if ( !sub_phrase )
             return ERROR_NO_SUB_PHRASE_INDEX;
         m_total_freq += delta;
-        return sub_phrase->add_unigram_frequency(token, delta);
+        int result = sub_phrase->add_unigram_frequency(token, delta);
+        if ( !result && m_journals[index] )
+            journal_add_record(token);
+        return result;
     }
 
     /**
@@ -647,6 +885,59 @@ public:
         return sub_phrase->get_phrase_item(token, item);
     }
 
+    /**
+     * FacadePhraseIndex::get_writable_phrase_item:
+     * @token: the phrase token.
+     * @item: the phrase item of the token.
+     * @returns: the status of the get operation.
+     *
+     * Get the phrase item for the in-place changes.
+     *
+     */
+    int get_writable_phrase_item(phrase_token_t token, PhraseItem & item){
+        guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
+        SubPhraseIndex * sub_phrase = m_sub_phrase_indices[index];
+        if ( !sub_phrase )
+            return ERROR_NO_SUB_PHRASE_INDEX;
+        return sub_phrase->get_writable_phrase_item(token, item);
+    }
+
+    /**
+     * FacadePhraseIndex::update_phrase_item:
+     * @token: the phrase token.
+     * @returns: the status of the update operation.
+     *
+     * Record the in-place changes of the writable phrase item,
+     * like the pronunciation possibilities, in the journal.
+     *
+     */
+    int update_phrase_item(phrase_token_t token){
+        guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
+        SubPhraseIndex * sub_phrase = m_sub_phrase_indices[index];
+        if ( !sub_phrase )
+            return ERROR_NO_SUB_PHRASE_INDEX;
+        if ( m_journals[index] )
+            journal_add_record(token);
+        return ERROR_OK;
+    }
+
+    /**
+     * FacadePhraseIndex::get_hot_item:
+     * @token: the phrase token.
+     * @item: the header fields of the phrase item.
+     * @returns: the status of the get operation.
+     *
+     * Get the header fields of the phrase item from the facade phrase index.
+     *
+     */
+    int get_hot_item(phrase_token_t token, phrase_hot_item_t & item){
+        guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
+        SubPhraseIndex * sub_phrase = m_sub_phrase_indices[index];
+        if ( !sub_phrase )
+            return ERROR_NO_SUB_PHRASE_INDEX;
+        return sub_phrase->get_hot_item(token, item);
+    }
+
     /**
      * FacadePhraseIndex::add_phrase_item:
      * @token: the phrase token.
@@ -663,7 +954,10 @@ public:
             sub_phrase = new SubPhraseIndex;
         }   
         m_total_freq += item->get_unigram_frequency();
-        return sub_phrase->add_phrase_item(token, item);
+        int result = sub_phrase->add_phrase_item(token, item);
+        if ( !result && m_journals[index] )
+            journal_add_record(token);
+        return result;
     }
 
     /**
@@ -685,6 +979,8 @@ public:
         if ( result )
             return result;
         m_total_freq -= item->get_unigram_frequency();
+        if ( m_journals[index] )
+            journal_remove_record(token, item);
         return result;
     }
 
@@ -710,6 +1006,35 @@ public:
         return true;
     }
 
+    /**
+     * FacadePhraseIndex::update_ranges:
+     * @ranges: the ranges to be updated.
+     * @returns: whether the update operation is successful.
+     *
+     * Prepare the ranges of the loaded sub phrase indices, and reuse
+     * the ranges prepared by the previous calls.
+     *
+     */
+    bool update_ranges(PhraseIndexRanges ranges) {
+        for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+            GArray * & range = ranges[i];
+
+            SubPhraseIndex * sub_phrase = m_sub_phrase_indices[i];
+            if (sub_phrase && NULL == range) {
+                range = g_array_new(FALSE, FALSE, sizeof(PhraseIndexRange));
+            }
+
+            if (NULL == sub_phrase && range) {
+                g_array_free(range, TRUE);
+                range = NULL;
+            }
+
+            if (range)
+                g_array_set_size(range, 0);
+        }
+        return true;
+    }
+
     /**
      * FacadePhraseIndex::clear_ranges:
      * @ranges: the ranges to be cleared.
@@ -22,6 +22,7 @@
 #include "phrase_large_table3.h"
 #include <errno.h>
 #include "bdb_utils.h"
+#include "thread_chunk.h"
 
 namespace pinyin{
 
@@ -31,8 +32,9 @@ PhraseLargeTable3::PhraseLargeTable3() {
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE|DB_THREAD, 0600);
     assert(0 == ret);
 
     m_entry = new PhraseTableEntry;
@@ -65,8 +67,9 @@ bool PhraseLargeTable3::attach(const char * dbfile, guint32 flags) {
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, dbfile, NULL,
-                     DB_BTREE, db_flags, 0644);
+                     DB_BTREE, db_flags|DB_THREAD, 0644);
     if (ret != 0)
         return false;
 
@@ -83,8 +86,9 @@ bool PhraseLargeTable3::load_db(const char * filename) {
     int ret = db_create(&m_db, NULL, 0);
     assert(0 == ret);
 
+    /* shared by the lookups in the threads. */
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE|DB_THREAD, 0600);
     if (ret != 0)
         return false;
 
@@ -147,25 +151,27 @@ int PhraseLargeTable3::search(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
+
+    /* the local entry keeps the search re-entrant. */
+    PhraseTableEntry entry;
 
     DBT db_key;
     memset(&db_key, 0, sizeof(DBT));
     db_key.data = (void *) phrase;
     db_key.size = phrase_length * sizeof(ucs4_t);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    /* read into the per-thread buffer, as the handle is shared. */
+    MemoryChunk * chunk = get_thread_chunk();
+    int ret = get_bdb_chunk(m_db, &db_key, *chunk);
     if (ret != 0)
         return result;
 
     /* continue searching. */
     result |= SEARCH_CONTINUED;
 
-    m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    entry.m_chunk.set_chunk(chunk->begin(), chunk->size(), NULL);
 
-    result = m_entry->search(tokens) | result;
+    result = entry.search(tokens) | result;
 
     return result;
 }
@@ -183,10 +189,9 @@ int PhraseLargeTable3::add_index(int phrase_length,
     db_key.data = (void *) phrase;
     db_key.size = phrase_length * sizeof(ucs4_t);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    int ret = get_bdb_chunk(m_db, &db_key, m_entry->m_chunk);
 
+    DBT db_data;
     if (ret != 0) {
         /* new entry. */
         PhraseTableEntry entry;
@@ -205,11 +210,8 @@ int PhraseLargeTable3::add_index(int phrase_length,
             db_key.data = (void *) phrase;
             db_key.size = len * sizeof(ucs4_t);
 
-            memset(&db_data, 0, sizeof(DBT));
-
-            ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
             /* found entry. */
-            if (0 == ret)
+            if (exists_bdb_key(m_db, &db_key))
                 return ERROR_OK;
 
             /* new entry with empty content. */
@@ -224,7 +226,6 @@ int PhraseLargeTable3::add_index(int phrase_length,
     }
 
     /* already have keys. */
-    m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
     int result = m_entry->add_index(token);
 
     /* store the entry. */
@@ -249,19 +250,16 @@ int PhraseLargeTable3::remove_index(int phrase_length,
     db_key.data = (void *) phrase;
     db_key.size = phrase_length * sizeof(ucs4_t);
 
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    int ret = get_bdb_chunk(m_db, &db_key, m_entry->m_chunk);
     if (ret != 0)
         return ERROR_REMOVE_ITEM_DONOT_EXISTS;
 
-    m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
-
     int result = m_entry->remove_index(token);
     if (ERROR_OK != result)
         return result;
 
     /* removed the token. */
+    DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
     db_data.data = m_entry->m_chunk.begin();
     db_data.size = m_entry->m_chunk.size();
@@ -279,7 +277,7 @@ bool PhraseLargeTable3::mask_out(phrase_token_t mask,
     PhraseTableEntry entry;
 
     DBC * cursorp = NULL;
-    DBT db_key, db_data;
+    DBT db_key, db_data, new_data;
 
     /* Get a cursor */
     m_db->cursor(m_db, NULL, &cursorp, 0);
@@ -288,8 +286,8 @@ bool PhraseLargeTable3::mask_out(phrase_token_t mask,
         return false;
 
     /* Initialize our DBTs. */
-    memset(&db_key, 0, sizeof(DBT));
-    memset(&db_data, 0, sizeof(DBT));
+    init_cursor_dbt(&db_key);
+    init_cursor_dbt(&db_data);
 
     /* Iterate over the database, retrieving each record in turn. */
     int ret = 0;
@@ -298,14 +296,17 @@ bool PhraseLargeTable3::mask_out(phrase_token_t mask,
 
         entry.mask_out(mask, value);
 
-        memset(&db_data, 0, sizeof(DBT));
-        db_data.data = entry.m_chunk.begin();
-        db_data.size = entry.m_chunk.size();
-        int ret = cursorp->put(cursorp, &db_key, &db_data,  DB_CURRENT);
+        memset(&new_data, 0, sizeof(DBT));
+        new_data.data = entry.m_chunk.begin();
+        new_data.size = entry.m_chunk.size();
+        int ret = cursorp->put(cursorp, &db_key, &new_data,  DB_CURRENT);
         assert(ret == 0);
     }
     assert(ret == DB_NOTFOUND);
 
+    fini_cursor_dbt(&db_key);
+    fini_cursor_dbt(&db_data);
+
     /* Cursors must be closed */
     if (cursorp != NULL)
         cursorp->c_close(cursorp);
@@ -122,7 +122,10 @@ int PhraseLargeTable3::search(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
+
+    /* the local entry keeps the search re-entrant,
+       and borrows the per-thread buffer. */
+    PhraseTableEntry entry;
 
     const char * kbuf = (char *) phrase;
     const int32_t vsiz = m_db->check(kbuf, phrase_length * sizeof(ucs4_t));
@@ -135,13 +138,15 @@ int PhraseLargeTable3::search(int phrase_length,
     if (0 == vsiz)
         return result;
 
-    m_entry->m_chunk.set_size(vsiz);
-    /* m_chunk may re-allocate here. */
-    char * vbuf = (char *) m_entry->m_chunk.begin();
+    MemoryChunk * chunk = get_thread_chunk();
+    chunk->set_size(vsiz);
+    /* chunk may re-allocate here. */
+    char * vbuf = (char *) chunk->begin();
     assert (vsiz == m_db->get(kbuf, phrase_length * sizeof(ucs4_t),
                               vbuf, vsiz));
+    entry.m_chunk.set_chunk(vbuf, vsiz, NULL);
 
-    result = m_entry->search(tokens) | result;
+    result = entry.search(tokens) | result;
 
     return result;
 }
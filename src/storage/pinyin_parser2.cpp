@@ -150,10 +150,16 @@ static inline bool search_pinyin_index2(pinyin_option_t options,
 }
 
 
+/* the per-thread parse steps, as the parser is shared by the threads. */
+static void free_parse_steps(gpointer data){
+    g_array_free((ParseValueVector) data, TRUE);
+}
+
+static GPrivate parse_steps_key = G_PRIVATE_INIT(free_parse_steps);
+
 /* Full Pinyin Parser */
 FullPinyinParser2::FullPinyinParser2 (){
     m_pinyin_index = NULL; m_pinyin_index_len = 0;
-    m_parse_steps = g_array_new(TRUE, FALSE, sizeof(parse_value_t));
 
     set_scheme(FULL_PINYIN_DEFAULT);
 }
@@ -218,12 +224,18 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
     g_array_set_size(keys, 0);
     g_array_set_size(key_rests, 0);
 
-    /* init m_parse_steps, and prepare dynamic programming. */
+    /* init parse_steps, and prepare dynamic programming. */
     int step_len = len + 1;
-    g_array_set_size(m_parse_steps, 0);
+    ParseValueVector parse_steps = (ParseValueVector)
+        g_private_get(&parse_steps_key);
+    if (NULL == parse_steps) {
+        parse_steps = g_array_new(TRUE, FALSE, sizeof(parse_value_t));
+        g_private_set(&parse_steps_key, parse_steps);
+    }
+    g_array_set_size(parse_steps, 0);
     parse_value_t value;
     for (i = 0; i < step_len; ++i) {
-        g_array_append_val(m_parse_steps, value);
+        g_array_append_val(parse_steps, value);
     }
 
     size_t next_sep = 0;
@@ -232,8 +244,8 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
 
     for (i = 0; i < len; ++i) {
         if (input[i] == '\'') {
-            curstep = &g_array_index(m_parse_steps, parse_value_t, i);
-            nextstep = &g_array_index(m_parse_steps, parse_value_t, i + 1);
+            curstep = &g_array_index(parse_steps, parse_value_t, i);
+            nextstep = &g_array_index(parse_steps, parse_value_t, i + 1);
 
             /* propagate current step into next step. */
             nextstep->m_key = ChewingKey();
@@ -259,11 +271,11 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
         /* for (size_t m = i; m < next_sep; ++m) */
         {
             size_t m = i;
-            curstep = &g_array_index(m_parse_steps, parse_value_t, m);
+            curstep = &g_array_index(parse_steps, parse_value_t, m);
             size_t try_len = std_lite::min
                 (m + max_full_pinyin_length, next_sep);
             for (size_t n = m + 1; n < try_len + 1; ++n) {
-                nextstep = &g_array_index(m_parse_steps, parse_value_t, n);
+                nextstep = &g_array_index(parse_steps, parse_value_t, n);
 
                 /* gen next step */
                 const char * onepinyin = input + m;
@@ -318,7 +330,7 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
     }
 
     /* final step for back tracing. */
-    gint16 parsed_len = final_step(step_len, keys, key_rests);
+    gint16 parsed_len = final_step(parse_steps, step_len, keys, key_rests);
 
 #if 0
     /* post processing for re-split table. */
@@ -331,7 +343,8 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
     return parsed_len;
 }
 
-int FullPinyinParser2::final_step(size_t step_len, ChewingKeyVector & keys,
+int FullPinyinParser2::final_step(ParseValueVector parse_steps,
+                                  size_t step_len, ChewingKeyVector & keys,
                                   ChewingKeyRestVector & key_rests) const{
     int i;
     gint16 parsed_len = 0;
@@ -339,7 +352,7 @@ int FullPinyinParser2::final_step(size_t step_len, ChewingKeyVector & keys,
 
     /* find longest match, which starts from the beginning of input. */
     for (i = step_len - 1; i >= 0; --i) {
-        curstep = &g_array_index(m_parse_steps, parse_value_t, i);
+        curstep = &g_array_index(parse_steps, parse_value_t, i);
         if (i == curstep->m_parsed_len)
             break;
     }
@@ -362,7 +375,7 @@ int FullPinyinParser2::final_step(size_t step_len, ChewingKeyVector & keys,
         }
 
         /* back ward */
-        curstep = &g_array_index(m_parse_steps, parse_value_t,
+        curstep = &g_array_index(parse_steps, parse_value_t,
                                  curstep->m_last_step);
     }
     return parsed_len;
@@ -146,16 +146,15 @@ class FullPinyinParser2 : public PhoneticParser2
     size_t m_pinyin_index_len;
 
 protected:
-    ParseValueVector m_parse_steps;
-
-    int final_step(size_t step_len, ChewingKeyVector & keys,
+    /* the parse steps are kept per thread,
+       so that the parser can be shared by the threads. */
+    int final_step(ParseValueVector parse_steps,
+                   size_t step_len, ChewingKeyVector & keys,
                    ChewingKeyRestVector & key_rests) const;
 
 public:
     FullPinyinParser2();
-    virtual ~FullPinyinParser2() {
-        g_array_free(m_parse_steps, TRUE);
-    }
+    virtual ~FullPinyinParser2() {}
 
     virtual bool parse_one_key(pinyin_option_t options, ChewingKey & key, const char *str, int len) const;
 
@@ -23,9 +23,14 @@
 #define PINYIN_PHRASE3_H
 
 #include <assert.h>
+#include <string.h>
 #include "novel_types.h"
 #include "chewing_key.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* All compare function should be symmetric for the lhs and rhs operands.
    URL: http://en.cppreference.com/w/cpp/algorithm/equal_range . */
 
@@ -230,6 +235,210 @@ inline int phrase_less_than_with_tones(const PinyinIndexItem2<phrase_length> &lh
     return 0 > phrase_compare_with_tones<phrase_length>(lhs, rhs);
 }
 
+/* the raw 16 bits of the ChewingKey. */
+inline guint16 chewing_key_to_raw(ChewingKey key) {
+    guint16 raw = 0;
+    assert(sizeof(ChewingKey) == sizeof(guint16));
+    memcpy(&raw, &key, sizeof(ChewingKey));
+    return raw;
+}
+
+/**
+ * PinyinIndexItemMatcher:
+ *
+ * Test whether pinyin_compare_with_tones returns zero for the query keys
+ * and the index items, by comparing the raw ChewingKeys under bit masks.
+ *
+ * The zero middle and final, or the zero tone, of either side matches
+ * any value, so the masks of the query keys are computed once, and the
+ * masks of the index items are computed on the fly.
+ *
+ * With SSE2, the index items are compared in blocks of 16 bytes, which
+ * cover a whole number of index items.
+ *
+ */
+template<size_t phrase_length>
+class PinyinIndexItemMatcher{
+protected:
+    typedef PinyinIndexItem2<phrase_length> IndexItem;
+
+    /* the bit masks of the fields in the raw ChewingKey. */
+    guint16 m_initial_mask;
+    guint16 m_middle_final_mask;
+    guint16 m_tone_mask;
+
+    /* the raw query keys and their compared bits. */
+    guint16 m_keys[phrase_length];
+    guint16 m_masks[phrase_length];
+
+#ifdef __SSE2__
+    /* the largest block is 144 bytes for 4 index items of length 16. */
+    enum { max_block_vectors = 9, max_block_items = 4 };
+
+    size_t m_block_items;
+    size_t m_block_vectors;
+
+    /* the query keys and masks repeated in the block layout. */
+    __m128i m_block_keys[max_block_vectors];
+    __m128i m_block_masks[max_block_vectors];
+
+    /* the movemask bits of the keys of each index item in the block. */
+    guint16 m_item_bits[max_block_items][max_block_vectors];
+
+    guint32 match_block(const IndexItem * items) const {
+        const char * data = (const char *) items;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i initial_mask = _mm_set1_epi16((short) m_initial_mask);
+        const __m128i middle_final_mask =
+            _mm_set1_epi16((short) m_middle_final_mask);
+        const __m128i tone_mask = _mm_set1_epi16((short) m_tone_mask);
+
+        guint16 bits[max_block_vectors];
+        for (size_t v = 0; v < m_block_vectors; ++v) {
+            const __m128i keys = _mm_loadu_si128
+                ((const __m128i *) (data + v * sizeof(__m128i)));
+
+            /* the zero fields of the index items match any value. */
+            __m128i mask = _mm_or_si128
+                (_mm_andnot_si128(_mm_cmpeq_epi16
+                                  (_mm_and_si128(keys, middle_final_mask),
+                                   zero), middle_final_mask),
+                 _mm_andnot_si128(_mm_cmpeq_epi16
+                                  (_mm_and_si128(keys, tone_mask),
+                                   zero), tone_mask));
+            mask = _mm_or_si128(mask, initial_mask);
+            mask = _mm_and_si128(mask, m_block_masks[v]);
+
+            const __m128i diff = _mm_and_si128
+                (_mm_xor_si128(keys, m_block_keys[v]), mask);
+            bits[v] = _mm_movemask_epi8(_mm_cmpeq_epi16(diff, zero));
+        }
+
+        guint32 matched = 0;
+        for (size_t j = 0; j < m_block_items; ++j) {
+            bool found = true;
+            for (size_t v = 0; v < m_block_vectors; ++v) {
+                const guint16 item_bits = m_item_bits[j][v];
+                if ((bits[v] & item_bits) != item_bits)
+                    found = false;
+            }
+            if (found)
+                matched |= 1U << j;
+        }
+
+        return matched;
+    }
+
+    void init_blocks() {
+        const size_t item_size = sizeof(IndexItem);
+        size_t block_size = item_size;
+        while (0 != block_size % sizeof(__m128i))
+            block_size += item_size;
+
+        m_block_items = block_size / item_size;
+        m_block_vectors = block_size / sizeof(__m128i);
+        assert(m_block_items <= max_block_items);
+        assert(m_block_vectors <= max_block_vectors);
+
+        IndexItem item;
+        const size_t keys_offset = (char *) item.m_keys - (char *) &item;
+
+        guint16 keys[max_block_vectors * 8];
+        guint16 masks[max_block_vectors * 8];
+        memset(keys, 0, sizeof(keys));
+        memset(masks, 0, sizeof(masks));
+        memset(m_item_bits, 0, sizeof(m_item_bits));
+
+        for (size_t j = 0; j < m_block_items; ++j) {
+            for (size_t i = 0; i < phrase_length; ++i) {
+                const size_t offset =
+                    j * item_size + keys_offset + i * sizeof(ChewingKey);
+                keys[offset / sizeof(guint16)] = m_keys[i];
+                masks[offset / sizeof(guint16)] = m_masks[i];
+
+                /* two movemask bits for each key. */
+                const size_t v = offset / sizeof(__m128i);
+                const size_t bit = offset % sizeof(__m128i);
+                m_item_bits[j][v] |= 0x3 << bit;
+            }
+        }
+
+        for (size_t v = 0; v < m_block_vectors; ++v) {
+            m_block_keys[v] = _mm_loadu_si128((const __m128i *) (keys + v * 8));
+            m_block_masks[v] = _mm_loadu_si128
+                ((const __m128i *) (masks + v * 8));
+        }
+    }
+#endif
+
+public:
+    PinyinIndexItemMatcher(const ChewingKey * keys) {
+        ChewingKey key;
+        key.m_initial = 0x1f;
+        m_initial_mask = chewing_key_to_raw(key);
+
+        key = ChewingKey();
+        key.m_middle = 0x3; key.m_final = 0x1f;
+        m_middle_final_mask = chewing_key_to_raw(key);
+
+        key = ChewingKey();
+        key.m_tone = 0x7;
+        m_tone_mask = chewing_key_to_raw(key);
+
+        for (size_t i = 0; i < phrase_length; ++i) {
+            m_keys[i] = chewing_key_to_raw(keys[i]);
+            m_masks[i] = compute_mask(m_keys[i]);
+        }
+
+#ifdef __SSE2__
+        init_blocks();
+#endif
+    }
+
+    /* the compared bits, without the zero fields. */
+    guint16 compute_mask(guint16 raw) const {
+        guint16 mask = m_initial_mask;
+        if (raw & m_middle_final_mask)
+            mask |= m_middle_final_mask;
+        if (raw & m_tone_mask)
+            mask |= m_tone_mask;
+        return mask;
+    }
+
+    bool match(const IndexItem * item) const {
+        for (size_t i = 0; i < phrase_length; ++i) {
+            const guint16 raw = chewing_key_to_raw(item->m_keys[i]);
+            if ((raw ^ m_keys[i]) & m_masks[i] & compute_mask(raw))
+                return false;
+        }
+        return true;
+    }
+
+    /* match at most 32 index items from begin,
+       returns the bit mask of the matched index items. */
+    guint32 match(const IndexItem * begin, const IndexItem * end,
+                  size_t & num) const {
+        num = end - begin;
+        if (num > 32)
+            num = 32;
+
+        guint32 matched = 0;
+        size_t k = 0;
+
+#ifdef __SSE2__
+        for (; k + m_block_items <= num; k += m_block_items)
+            matched |= match_block(begin + k) << k;
+#endif
+
+        for (; k < num; ++k) {
+            if (match(begin + k))
+                matched |= 1U << k;
+        }
+
+        return matched;
+    }
+};
+
 };
 
 #endif
@@ -0,0 +1,159 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "single_gram_cache.h"
+
+using namespace pinyin;
+
+struct single_gram_cache_item_t{
+    phrase_token_t m_token;
+    /* NULL when neither bi-gram contains the token. */
+    SingleGram * m_single_gram;
+};
+
+static void free_cache_item(single_gram_cache_item_t * item){
+    if (item->m_single_gram)
+        delete item->m_single_gram;
+    delete item;
+}
+
+SingleGramCache::SingleGramCache(Bigram * system_bigram,
+                                 Bigram * user_bigram,
+                                 size_t capacity,
+                                 Bigram * merged_bigram){
+    assert(capacity > 0);
+
+    m_system_bigram = system_bigram;
+    m_user_bigram = user_bigram;
+    m_merged_bigram = merged_bigram;
+    m_capacity = capacity;
+
+    m_lru = g_queue_new();
+    m_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+SingleGramCache::~SingleGramCache(){
+    reset();
+
+    g_hash_table_destroy(m_index);
+    m_index = NULL;
+    g_queue_free(m_lru);
+    m_lru = NULL;
+}
+
+bool SingleGramCache::evict_one(){
+    single_gram_cache_item_t * item = (single_gram_cache_item_t *)
+        g_queue_pop_tail(m_lru);
+    if (NULL == item)
+        return false;
+
+    gboolean removed = g_hash_table_remove
+        (m_index, GUINT_TO_POINTER(item->m_token));
+    assert(removed);
+    free_cache_item(item);
+    return true;
+}
+
+bool SingleGramCache::load(phrase_token_t index,
+                           const SingleGram * & merged){
+    merged = NULL;
+
+    gpointer value = NULL;
+    gboolean found = g_hash_table_lookup_extended
+        (m_index, GUINT_TO_POINTER(index), NULL, &value);
+
+    if (found) {
+        /* move to the most recently used position. */
+        GList * link = (GList *) value;
+        g_queue_unlink(m_lru, link);
+        g_queue_push_head_link(m_lru, link);
+
+        single_gram_cache_item_t * item =
+            (single_gram_cache_item_t *) link->data;
+        merged = item->m_single_gram;
+        return NULL != merged;
+    }
+
+    /* the cached single gram must own its memory. */
+    SingleGram * single_gram = NULL;
+
+    /* the single gram is merged ahead of time. */
+    if (m_merged_bigram)
+        m_merged_bigram->load(index, single_gram, true);
+
+    if (NULL == single_gram) {
+        SingleGram * system = NULL, * user = NULL;
+        m_system_bigram->load(index, system, true);
+        m_user_bigram->load(index, user, true);
+
+        if (NULL == system) {
+            single_gram = user;
+        } else if (NULL == user) {
+            single_gram = system;
+        } else {
+            single_gram = new SingleGram;
+            merge_single_gram(single_gram, system, user);
+            delete system;
+            delete user;
+        }
+    }
+
+    if (g_hash_table_size(m_index) >= m_capacity)
+        evict_one();
+
+    single_gram_cache_item_t * item = new single_gram_cache_item_t;
+    item->m_token = index;
+    item->m_single_gram = single_gram;
+
+    g_queue_push_head(m_lru, item);
+    g_hash_table_insert(m_index, GUINT_TO_POINTER(index), m_lru->head);
+
+    merged = single_gram;
+    return NULL != merged;
+}
+
+bool SingleGramCache::invalidate(phrase_token_t index){
+    if (m_merged_bigram)
+        m_merged_bigram->remove(index);
+
+    gpointer value = NULL;
+    gboolean found = g_hash_table_lookup_extended
+        (m_index, GUINT_TO_POINTER(index), NULL, &value);
+    if (!found)
+        return false;
+
+    GList * link = (GList *) value;
+    single_gram_cache_item_t * item =
+        (single_gram_cache_item_t *) link->data;
+
+    g_queue_delete_link(m_lru, link);
+    g_hash_table_remove(m_index, GUINT_TO_POINTER(index));
+    free_cache_item(item);
+    return true;
+}
+
+bool SingleGramCache::reset(){
+    while (evict_one())
+        ;
+
+    assert(0 == g_hash_table_size(m_index));
+    return true;
+}
@@ -0,0 +1,142 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SINGLE_GRAM_CACHE_H
+#define SINGLE_GRAM_CACHE_H
+
+#include <glib.h>
+#include "novel_types.h"
+#include "memory_chunk.h"
+#include "ngram.h"
+
+namespace pinyin{
+
+/**
+ * SingleGramCache:
+ *
+ * The bounded LRU cache of the merged system and user single grams,
+ * keyed by the previous phrase token.
+ *
+ * Note: the cached single grams must be invalidated when the user
+ *   bi-gram is changed, see SingleGramCache::invalidate and
+ *   SingleGramCache::reset.
+ *
+ * The optional merged bi-gram holds the single grams merged ahead of
+ *   time, which are loaded without the merge on miss.
+ *
+ */
+class SingleGramCache{
+private:
+    /* Disallow used outside. */
+    SingleGramCache(const SingleGramCache & cache);
+    SingleGramCache & operator = (const SingleGramCache & cache);
+
+protected:
+    Bigram * m_system_bigram;
+    Bigram * m_user_bigram;
+    Bigram * m_merged_bigram;
+
+    size_t m_capacity;
+
+    /* the least recently used item is at the tail. */
+    GQueue * m_lru;
+    /* phrase_token_t => GList * in m_lru. */
+    GHashTable * m_index;
+
+    bool evict_one();
+
+public:
+    /**
+     * SingleGramCache::SingleGramCache:
+     * @system_bigram: the system bi-gram.
+     * @user_bigram: the user bi-gram.
+     * @capacity: the maximum number of the cached single grams.
+     * @merged_bigram: the merged single grams of the system and user
+     *                 bi-gram, or NULL.
+     *
+     * The constructor of the SingleGramCache.
+     *
+     */
+    SingleGramCache(Bigram * system_bigram, Bigram * user_bigram,
+                    size_t capacity = 1024,
+                    Bigram * merged_bigram = NULL);
+
+    /**
+     * SingleGramCache::~SingleGramCache:
+     *
+     * The destructor of the SingleGramCache.
+     *
+     */
+    ~SingleGramCache();
+
+    /**
+     * SingleGramCache::load:
+     * @index: the previous token in the bi-gram.
+     * @merged: the merged single gram of the previous token.
+     * @returns: whether the single gram exists.
+     *
+     * Load the merged single gram from the cache, or from the system
+     * and user bi-gram on miss. The missing single grams are cached too.
+     *
+     * Note: the merged single gram is owned by the cache, and is valid
+     *   until the next load, invalidate or reset call.
+     *
+     */
+    bool load(/* in */ phrase_token_t index,
+              /* out */ const SingleGram * & merged);
+
+    /**
+     * SingleGramCache::invalidate:
+     * @index: the previous token in the bi-gram.
+     * @returns: whether the single gram was cached.
+     *
+     * Drop the cached single gram after the user bi-gram stored it.
+     *
+     * Note: the stale single gram in the merged bi-gram is removed too,
+     *   so the caller must have the exclusive access to it.
+     *
+     */
+    bool invalidate(/* in */ phrase_token_t index);
+
+    /**
+     * SingleGramCache::reset:
+     * @returns: whether the reset operation is successful.
+     *
+     * Drop all cached single grams, used after the user bi-gram mask out.
+     *
+     */
+    bool reset();
+
+    /**
+     * SingleGramCache::get_length:
+     * @returns: the number of the cached single grams.
+     *
+     * Get the number of the cached single grams.
+     *
+     */
+    size_t get_length() const {
+        return g_hash_table_size(m_index);
+    }
+};
+
+};
+
+#endif
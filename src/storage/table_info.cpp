@@ -48,6 +48,8 @@ SystemTableInfo2::SystemTableInfo2() {
     m_lambda = 0.;
 
     m_table_phonetic_type = PINYIN_TABLE;
+    m_bigram_file_format = BIGRAM_DB_FORMAT;
+    m_pinyin_index_file_format = PINYIN_INDEX_DB_FORMAT;
 
 #define INIT_TABLE_INFO(tables, index) do {                 \
         pinyin_table_info_t * table_info = &tables[index];  \
@@ -78,6 +80,8 @@ void SystemTableInfo2::reset() {
     m_lambda = 0.;
 
     m_table_phonetic_type = PINYIN_TABLE;
+    m_bigram_file_format = BIGRAM_DB_FORMAT;
+    m_pinyin_index_file_format = PINYIN_INDEX_DB_FORMAT;
 
 #define FINI_TABLE_INFO(tables, index) do {                \
         pinyin_table_info_t * table_info = &tables[index];  \
@@ -117,6 +121,26 @@ static TABLE_PHONETIC_TYPE to_table_phonetic_type(const char * str) {
     assert(FALSE);
 }
 
+static BIGRAM_FILE_FORMAT to_bigram_file_format(const char * str) {
+    if (0 == strcmp("db", str))
+        return BIGRAM_DB_FORMAT;
+
+    if (0 == strcmp("packed", str))
+        return BIGRAM_PACKED_FORMAT;
+
+    assert(FALSE);
+}
+
+static PINYIN_INDEX_FILE_FORMAT to_pinyin_index_file_format(const char * str) {
+    if (0 == strcmp("db", str))
+        return PINYIN_INDEX_DB_FORMAT;
+
+    if (0 == strcmp("packed", str))
+        return PINYIN_INDEX_PACKED_FORMAT;
+
+    assert(FALSE);
+}
+
 static TABLE_TARGET to_table_target(const char * str) {
     if (0 == strcmp("default", str))
         return DEFAULT_TABLE;
@@ -198,6 +222,19 @@ bool SystemTableInfo2::load(const char * filename) {
     num = fscanf(input, "source table format:%256s", str);
     type = to_table_phonetic_type(str);
 
+    /* the optional system file format lines. */
+    BIGRAM_FILE_FORMAT format = BIGRAM_DB_FORMAT;
+    PINYIN_INDEX_FILE_FORMAT index_format = PINYIN_INDEX_DB_FORMAT;
+    char name[256];
+    while (2 == fscanf(input, " system %256[^:]:%256s", name, str)) {
+        if (0 == strcmp("bigram format", name))
+            format = to_bigram_file_format(str);
+        else if (0 == strcmp("pinyin index format", name))
+            index_format = to_pinyin_index_file_format(str);
+        else
+            fprintf(stderr, "unknown system file format:%s\n", name);
+    }
+
 #if 0
     printf("binver:%d modelver:%d lambda:%f\n", binver, modelver, lambda);
     printf("type:%d\n", type);
@@ -211,6 +248,9 @@ bool SystemTableInfo2::load(const char * filename) {
     assert(PINYIN_TABLE == type);
     m_table_phonetic_type = type;
 
+    m_bigram_file_format = format;
+    m_pinyin_index_file_format = index_format;
+
     int index = 0;
     char tableinfo[256], dictstr[256];
     char tablefile[256], sysfile[256], userfile[256], filetype[256];
@@ -268,6 +308,14 @@ gfloat SystemTableInfo2::get_lambda() {
     return m_lambda;
 }
 
+BIGRAM_FILE_FORMAT SystemTableInfo2::get_bigram_file_format() {
+    return m_bigram_file_format;
+}
+
+PINYIN_INDEX_FILE_FORMAT SystemTableInfo2::get_pinyin_index_file_format() {
+    return m_pinyin_index_file_format;
+}
+
 
 UserTableInfo::UserTableInfo() {
     m_binary_format_version = 0;
@@ -32,6 +32,16 @@ typedef enum {
     ZHUYIN_TABLE,                 /* use zhuyin. */
 } TABLE_PHONETIC_TYPE;
 
+typedef enum {
+    BIGRAM_DB_FORMAT,             /* use the bi-gram database. */
+    BIGRAM_PACKED_FORMAT,         /* use the packed bi-gram. */
+} BIGRAM_FILE_FORMAT;
+
+typedef enum {
+    PINYIN_INDEX_DB_FORMAT,       /* use the pinyin index database. */
+    PINYIN_INDEX_PACKED_FORMAT,   /* use the packed pinyin index. */
+} PINYIN_INDEX_FILE_FORMAT;
+
 typedef enum {
     DEFAULT_TABLE,
     ADDON_TABLE,
@@ -64,6 +74,10 @@ private:
 
     TABLE_PHONETIC_TYPE m_table_phonetic_type;
 
+    BIGRAM_FILE_FORMAT m_bigram_file_format;
+
+    PINYIN_INDEX_FILE_FORMAT m_pinyin_index_file_format;
+
     pinyin_table_info_t m_default_tables[PHRASE_INDEX_LIBRARY_COUNT];
 
     pinyin_table_info_t m_addon_tables[PHRASE_INDEX_LIBRARY_COUNT];
@@ -85,6 +99,10 @@ public:
     gfloat get_lambda();
 
     TABLE_PHONETIC_TYPE get_table_phonetic_type();
+
+    BIGRAM_FILE_FORMAT get_bigram_file_format();
+
+    PINYIN_INDEX_FILE_FORMAT get_pinyin_index_file_format();
 };
 
 class UserTableInfo{
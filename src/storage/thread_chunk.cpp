@@ -0,0 +1,41 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "thread_chunk.h"
+
+namespace pinyin{
+
+static void free_thread_chunk(gpointer data){
+    delete (MemoryChunk *) data;
+}
+
+static GPrivate thread_chunk_key = G_PRIVATE_INIT(free_thread_chunk);
+
+MemoryChunk * get_thread_chunk(){
+    MemoryChunk * chunk = (MemoryChunk *) g_private_get(&thread_chunk_key);
+    if (NULL == chunk) {
+        chunk = new MemoryChunk;
+        g_private_set(&thread_chunk_key, chunk);
+    }
+    return chunk;
+}
+
+};
@@ -0,0 +1,44 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef THREAD_CHUNK_H
+#define THREAD_CHUNK_H
+
+#include <glib.h>
+#include "memory_chunk.h"
+
+namespace pinyin{
+
+/**
+ * get_thread_chunk:
+ * @returns: the memory chunk of the calling thread.
+ *
+ * Get the per-thread buffer to read the values of the database,
+ * as the tables are shared by the lookups in the threads.
+ *
+ * Note: the content is valid until the next call from the same thread.
+ *
+ */
+MemoryChunk * get_thread_chunk();
+
+};
+
+#endif
@@ -0,0 +1,65 @@
+/* 
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *  
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ALLOCATION_COUNT_H
+#define ALLOCATION_COUNT_H
+
+#include <stdlib.h>
+
+/* Note: include it in one source file of the program only,
+   as it replaces the malloc functions of the program. */
+
+#ifdef __GLIBC__
+/* count the heap allocations, including the ones inside glib. */
+extern "C" {
+    void * __libc_malloc(size_t size);
+    void * __libc_calloc(size_t nmemb, size_t size);
+    void * __libc_realloc(void * ptr, size_t size);
+    void __libc_free(void * ptr);
+}
+
+static size_t num_of_allocations = 0;
+
+extern "C" void * malloc(size_t size){
+    ++num_of_allocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t nmemb, size_t size){
+    ++num_of_allocations;
+    return __libc_calloc(nmemb, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size){
+    ++num_of_allocations;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void * ptr){
+    __libc_free(ptr);
+}
+#define HAVE_ALLOCATION_COUNT 1
+#else
+static size_t num_of_allocations = 0;
+#define HAVE_ALLOCATION_COUNT 0
+#endif
+
+#endif
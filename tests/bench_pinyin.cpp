@@ -0,0 +1,298 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "pinyin.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "allocation_count.h"
+
+/* Benchmark the keystroke latency of the pinyin lookup,
+   on a fixed corpus for the comparable results across commits. */
+
+static const char * default_corpus[] = {
+    "nihao",
+    "zhongguo",
+    "women",
+    "jintiantianqihenhao",
+    "woxianghechakafei",
+    "zhegewentihenfuza",
+    "qingnibangwokanyixia",
+    "mingtianxiawuliangdiankaihui",
+    "xiexienidebangzhu",
+    "tamenzaitushuguanxuexi",
+    "zhongguorenmingongheguo",
+    "beijingshidaxue",
+    "jisuanjikexue",
+    "shurufa",
+    "pinyinshurufa",
+    "zhinengpinyin",
+    "woaibeijingtiananmen",
+    "womenyiqiqukandianying",
+    "zheshiyigeceshi",
+    "zhendehenbucuo",
+    "nishishuia",
+    "shangwushidian",
+    "xianzaijidianle",
+    "qingwenchezhanzainali",
+    "yinhangkazaizheli",
+    "dianhuahaomashiduoshao",
+    "huanyingguanglin",
+    "shengrikuaile",
+    "xinniankuaile",
+    "zhuninyiluxunfeng",
+    "zai'jian",
+    "xi'an",
+    "fang'an",
+    "chang'e",
+};
+
+struct option_set_t{
+    const char * m_name;
+    pinyin_option_t m_options;
+};
+
+static const option_set_t option_sets[] = {
+    {"plain", USE_TONE},
+    {"amb_all", USE_TONE | PINYIN_AMB_ALL},
+    {"incomplete", USE_TONE | PINYIN_INCOMPLETE},
+};
+
+static size_t rounds = 3;
+
+static gint compare_latency(gconstpointer lhs, gconstpointer rhs){
+    gint64 lhs_latency = *(const gint64 *) lhs;
+    gint64 rhs_latency = *(const gint64 *) rhs;
+    if (lhs_latency == rhs_latency)
+        return 0;
+    return lhs_latency < rhs_latency ? -1 : 1;
+}
+
+/* the nearest rank percentile of the sorted latencies. */
+static gint64 percentile(GArray * latencies, guint percent){
+    if (0 == latencies->len)
+        return 0;
+
+    size_t rank = (latencies->len * percent + 99) / 100;
+    if (rank > 0)
+        --rank;
+    return g_array_index(latencies, gint64, rank);
+}
+
+/* type the pinyin string key by key, as the input method does. */
+static void type_pinyin(pinyin_instance_t * instance,
+                        const char * pinyin,
+                        GArray * latencies){
+    size_t len = strlen(pinyin);
+    gchar * buffer = g_strdup(pinyin);
+
+    pinyin_reset(instance);
+    for (size_t i = 1; i <= len; ++i) {
+        buffer[i - 1] = pinyin[i - 1];
+        buffer[i] = '\0';
+
+        gint64 start_time = g_get_monotonic_time();
+
+        pinyin_parse_more_full_pinyins(instance, buffer);
+        pinyin_guess_sentence(instance);
+        pinyin_guess_candidates(instance, 0);
+
+        gint64 latency = g_get_monotonic_time() - start_time;
+        if (latencies)
+            g_array_append_val(latencies, latency);
+    }
+
+    g_free(buffer);
+}
+
+static void bench_option_set(pinyin_context_t * context,
+                             pinyin_instance_t * instance,
+                             const option_set_t * option_set,
+                             GPtrArray * corpus){
+    pinyin_set_options(context, option_set->m_options);
+
+    /* warm up the caches and the page cache. */
+    for (size_t i = 0; i < corpus->len; ++i)
+        type_pinyin(instance, (const char *)
+                    g_ptr_array_index(corpus, i), NULL);
+
+    GArray * latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+    guint64 expanded = 0, width_pruned = 0, margin_pruned = 0;
+    pinyin_get_beam_statistics(instance, &expanded,
+                               &width_pruned, &margin_pruned);
+    const guint64 last_expanded = expanded;
+    const guint64 last_pruned = width_pruned + margin_pruned;
+
+    size_t allocations = num_of_allocations;
+    gint64 start_time = g_get_monotonic_time();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < corpus->len; ++i)
+            type_pinyin(instance, (const char *)
+                        g_ptr_array_index(corpus, i), latencies);
+    }
+    gint64 elapsed = g_get_monotonic_time() - start_time;
+    allocations = num_of_allocations - allocations;
+
+    pinyin_get_beam_statistics(instance, &expanded,
+                               &width_pruned, &margin_pruned);
+    expanded -= last_expanded;
+    const guint64 skipped = width_pruned + margin_pruned - last_pruned;
+
+    g_array_sort(latencies, compare_latency);
+
+    const guint keystrokes = latencies->len;
+    /* print one json object per line. */
+    printf("{\"options\": \"%s\", \"keystrokes\": %u, "
+           "\"p50_us\": %" G_GINT64_FORMAT ", "
+           "\"p95_us\": %" G_GINT64_FORMAT ", "
+           "\"p99_us\": %" G_GINT64_FORMAT ", "
+           "\"keystrokes_per_second\": %.1f, "
+           "\"expanded\": %" G_GUINT64_FORMAT ", "
+           "\"skipped\": %" G_GUINT64_FORMAT ", ",
+           option_set->m_name, keystrokes,
+           percentile(latencies, 50),
+           percentile(latencies, 95),
+           percentile(latencies, 99),
+           elapsed ? keystrokes * 1000000.0 / elapsed : 0.,
+           expanded, skipped);
+    if (HAVE_ALLOCATION_COUNT && keystrokes)
+        printf("\"allocations_per_keystroke\": %.1f}\n",
+               (double) allocations / keystrokes);
+    else
+        printf("\"allocations_per_keystroke\": null}\n");
+
+    g_array_free(latencies, TRUE);
+}
+
+/* convert the corpus in batch with the worker threads,
+   the sentences should be the same as the ones of the calling thread. */
+static void bench_convert_batch(pinyin_context_t * context,
+                                GPtrArray * corpus,
+                                guint num_of_threads){
+    pinyin_set_options(context, USE_TONE | PINYIN_INCOMPLETE);
+
+    const size_t num = corpus->len;
+    const char ** pinyins = g_new0(const char *, num);
+    for (size_t i = 0; i < num; ++i)
+        pinyins[i] = (const char *) g_ptr_array_index(corpus, i);
+
+    char ** expected = g_new0(char *, num);
+    size_t converted = pinyin_convert_batch(context, pinyins, num,
+                                            expected, 1);
+
+    char ** sentences = g_new0(char *, num);
+    gint64 start_time = g_get_monotonic_time();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < num; ++i) {
+            g_free(sentences[i]);
+            sentences[i] = NULL;
+        }
+
+        size_t retval = pinyin_convert_batch
+            (context, pinyins, num, sentences, num_of_threads);
+        assert(converted == retval);
+    }
+    gint64 elapsed = g_get_monotonic_time() - start_time;
+
+    for (size_t i = 0; i < num; ++i) {
+        assert((NULL == expected[i]) == (NULL == sentences[i]));
+        if (expected[i])
+            assert(0 == strcmp(expected[i], sentences[i]));
+    }
+
+    printf("{\"batch_threads\": %u, \"items\": %u, "
+           "\"items_per_second\": %.1f}\n",
+           num_of_threads, (guint) (num * rounds),
+           elapsed ? num * rounds * 1000000.0 / elapsed : 0.);
+
+    for (size_t i = 0; i < num; ++i) {
+        g_free(expected[i]);
+        g_free(sentences[i]);
+    }
+    g_free(sentences);
+    g_free(expected);
+    g_free(pinyins);
+}
+
+int main(int argc, char * argv[]){
+    /* the optional corpus file, one pinyin string per line. */
+    GPtrArray * corpus = g_ptr_array_new();
+    if (argc > 1) {
+        FILE * input = fopen(argv[1], "r");
+        if (NULL == input) {
+            fprintf(stderr, "open %s failed!\n", argv[1]);
+            exit(ENOENT);
+        }
+
+        char * linebuf = NULL; size_t size = 0; ssize_t read;
+        while ((read = getline(&linebuf, &size, input)) != -1) {
+            if ('\n' == linebuf[strlen(linebuf) - 1]) {
+                linebuf[strlen(linebuf) - 1] = '\0';
+            }
+
+            if (0 == strlen(linebuf))
+                continue;
+
+            g_ptr_array_add(corpus, g_strdup(linebuf));
+        }
+        free(linebuf);
+        fclose(input);
+    } else {
+        for (size_t i = 0; i < G_N_ELEMENTS(default_corpus); ++i)
+            g_ptr_array_add(corpus, g_strdup(default_corpus[i]));
+    }
+
+    /* the empty user directory, for the reproducible results. */
+    gchar * user_dir = g_dir_make_tmp("libpinyin-bench-XXXXXX", NULL);
+    if (NULL == user_dir) {
+        fprintf(stderr, "create user directory failed!\n");
+        exit(ENOENT);
+    }
+
+    pinyin_context_t * context = pinyin_init("../data", user_dir);
+    pinyin_instance_t * instance = pinyin_alloc_instance(context);
+
+    const char * component = NULL; gint64 usec = 0;
+    for (guint i = 0; pinyin_get_init_timing(context, i, &component, &usec);
+         ++i)
+        fprintf(stderr, "init %s: %" G_GINT64_FORMAT " usec\n",
+                component, usec);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(option_sets); ++i)
+        bench_option_set(context, instance, option_sets + i, corpus);
+
+    bench_convert_batch(context, corpus, 4);
+
+    pinyin_free_instance(instance);
+    pinyin_fini(context);
+
+    rmdir(user_dir);
+    g_free(user_dir);
+
+    for (size_t i = 0; i < corpus->len; ++i)
+        g_free(g_ptr_array_index(corpus, i));
+    g_ptr_array_free(corpus, TRUE);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include "pinyin_internal.h"
+
+int main(int argc, char * argv[]){
+    MemoryArena arena(64);
+    assert(0 == arena.size());
+    assert(64 == arena.capacity());
+
+    int * ints = arena.allocate_array<int>(4);
+    for (int i = 0; i < 4; ++i)
+        ints[i] = i;
+
+    /* the allocations are aligned. */
+    char * chars = arena.allocate_array<char>(3);
+    memcpy(chars, "ab", 3);
+    double * doubles = arena.allocate_array<double>(1);
+    assert(0 == ((size_t) doubles) % sizeof(double));
+    *doubles = 1.5;
+
+    /* grow beyond the first block. */
+    guint32 * zeros = arena.allocate_array0<guint32>(256);
+    for (int i = 0; i < 256; ++i)
+        assert(0 == zeros[i]);
+    printf("size:%ld\tcapacity:%ld\n", arena.size(), arena.capacity());
+    assert(arena.size() >= 256 * sizeof(guint32));
+    assert(arena.capacity() >= arena.size());
+
+    /* the previous blocks are still valid. */
+    for (int i = 0; i < 4; ++i)
+        assert(i == ints[i]);
+    assert(0 == strcmp(chars, "ab"));
+    assert(1.5 == *doubles);
+
+    /* reset coalesces the blocks. */
+    const size_t capacity = arena.capacity();
+    arena.reset();
+    assert(0 == arena.size());
+    assert(capacity == arena.capacity());
+
+    /* no more blocks in the steady state. */
+    arena.allocate_array<guint32>(256);
+    assert(capacity == arena.capacity());
+
+    return 0;
+}
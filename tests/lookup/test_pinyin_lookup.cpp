@@ -24,8 +24,130 @@
 #include <string.h>
 #include "pinyin_internal.h"
 #include "tests_helper.h"
+#include "allocation_count.h"
 
 size_t bench_times = 100;
+size_t nbest = 5;
+
+static bool fill_phonetic_matrix(pinyin_option_t options,
+                                 PhoneticKeyMatrix * matrix,
+                                 const char * pinyins, size_t len){
+    FullPinyinParser2 parser;
+    ChewingKeyVector keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+    ChewingKeyRestVector key_rests =
+        g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+    int parsed_len = parser.parse(options, keys, key_rests, pinyins, len);
+
+    const bool retval = 0 != keys->len;
+    if (retval) {
+        fill_matrix(matrix, keys, key_rests, parsed_len);
+
+        resplit_step(options, matrix);
+
+        inner_split_step(options, matrix);
+
+        fuzzy_syllable_step(options, matrix);
+    }
+
+    g_array_free(keys, TRUE);
+    g_array_free(key_rests, TRUE);
+    return retval;
+}
+
+static void reset_constraints(CandidateConstraints constraints,
+                              size_t size){
+    g_array_set_size(constraints, size);
+    for ( size_t i = 0; i < constraints->len; ++i){
+        lookup_constraint_t * constraint = &g_array_index(constraints, lookup_constraint_t, i);
+        constraint->m_type = NO_CONSTRAINT;
+    }
+}
+
+/* type the pinyins one by one across the long input length,
+   the reused steps should give the same result as the full search. */
+static void check_incremental_search(pinyin_option_t options,
+                                     PinyinLookup2 & pinyin_lookup,
+                                     TokenVector prefixes,
+                                     CandidateConstraints constraints,
+                                     const char * pinyins){
+    const size_t len = strlen(pinyins);
+
+    PhoneticKeyMatrix matrix;
+    if (!fill_phonetic_matrix(options, &matrix, pinyins, len))
+        return;
+    if (matrix.size() < 4)
+        return;
+
+    assert(pinyin_lookup.set_beam_options(0, 0., matrix.size() / 2));
+
+    MatchResults incremental = g_array_new
+        (FALSE, FALSE, sizeof(phrase_token_t));
+    for (size_t i = 1; i <= len; ++i) {
+        PhoneticKeyMatrix prefix_matrix;
+        if (!fill_phonetic_matrix(options, &prefix_matrix, pinyins, i))
+            continue;
+
+        reset_constraints(constraints, prefix_matrix.size());
+        pinyin_lookup.get_best_match(prefixes, &prefix_matrix,
+                                     constraints, incremental);
+    }
+
+    MatchResults cold = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    pinyin_lookup.invalidate_steps();
+    reset_constraints(constraints, matrix.size());
+    pinyin_lookup.get_best_match(prefixes, &matrix, constraints, cold);
+
+    assert(incremental->len == cold->len);
+    assert(0 == memcmp(incremental->data, cold->data,
+                       cold->len * sizeof(phrase_token_t)));
+
+    assert(pinyin_lookup.set_beam_options(0, 0., 0));
+
+    g_array_free(cold, TRUE);
+    g_array_free(incremental, TRUE);
+}
+
+/* repeat the full search of the same input, the scratch data of
+   the search is re-used, so only the returned sentences allocate. */
+static void check_repeated_search(PinyinLookup2 & pinyin_lookup,
+                                  TokenVector prefixes,
+                                  PhoneticKeyMatrix * matrix,
+                                  CandidateConstraints constraints,
+                                  MatchResults results){
+    if (!HAVE_ALLOCATION_COUNT)
+        return;
+
+    PhoneticSearchCache search_cache;
+    GPtrArray * sentences = g_ptr_array_new();
+
+    for (size_t round = 0; round < 3; ++round) {
+        /* the first rounds grow the arrays and the arena. */
+        const bool measured = 2 == round;
+        size_t allocations = num_of_allocations;
+
+        pinyin_lookup.invalidate_steps();
+        pinyin_lookup.get_best_match(prefixes, matrix, constraints,
+                                     results, &search_cache);
+        if (measured)
+            assert(allocations == num_of_allocations);
+
+        allocations = num_of_allocations;
+        pinyin_lookup.invalidate_steps();
+        pinyin_lookup.get_nbest_match(nbest, prefixes, matrix, constraints,
+                                      sentences, &search_cache);
+        /* each returned sentence allocates its array. */
+        if (measured)
+            assert(num_of_allocations - allocations <=
+                   3 * (sentences->len + 1));
+
+        for (size_t i = 0; i < sentences->len; ++i)
+            g_array_free((MatchResults) g_ptr_array_index(sentences, i),
+                         TRUE);
+        g_ptr_array_set_size(sentences, 0);
+    }
+
+    g_ptr_array_free(sentences, TRUE);
+}
 
 int main( int argc, char * argv[]){
     SystemTableInfo2 system_table_info;
@@ -78,39 +200,24 @@ int main( int argc, char * argv[]){
         if ( strcmp ( linebuf, "quit" ) == 0)
             break;
 	
-        FullPinyinParser2 parser;
-        ChewingKeyVector keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
-        ChewingKeyRestVector key_rests =
-            g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
-        int parsed_len = parser.parse(options, keys, key_rests,
-                                      linebuf, strlen(linebuf));
-
         PhoneticKeyMatrix matrix;
 
-        if ( 0 == keys->len ) /* invalid pinyin */
-            continue;
-
         /* fill the matrix. */
-        fill_matrix(&matrix, keys, key_rests, parsed_len);
-
-        resplit_step(options, &matrix);
-
-        inner_split_step(options, &matrix);
-
-        fuzzy_syllable_step(options, &matrix);
+        if (!fill_phonetic_matrix(options, &matrix,
+                                  linebuf, strlen(linebuf)))
+            continue; /* invalid pinyin */
 
         dump_matrix(&matrix);
 
         /* initialize constraints. */
-        g_array_set_size(constraints, matrix.size());
-        for ( size_t i = 0; i < constraints->len; ++i){
-            lookup_constraint_t * constraint = &g_array_index(constraints, lookup_constraint_t, i);
-            constraint->m_type = NO_CONSTRAINT;
-        }
+        reset_constraints(constraints, matrix.size());
 
         guint32 start_time = record_time();
-        for (size_t i = 0; i < bench_times; ++i)
+        for (size_t i = 0; i < bench_times; ++i) {
+            /* measure the full search instead of the reused steps. */
+            pinyin_lookup.invalidate_steps();
             pinyin_lookup.get_best_match(prefixes, &matrix, constraints, results);
+        }
         print_time(start_time, bench_times);
 
         for (size_t i = 0; i < results->len; ++i){
@@ -125,8 +232,28 @@ int main( int argc, char * argv[]){
         pinyin_lookup.convert_to_utf8(results, sentence);
         printf("%s\n", sentence);
 
-        g_array_free(keys, TRUE);
-        g_array_free(key_rests, TRUE);
+        GPtrArray * sentences = g_ptr_array_new();
+        pinyin_lookup.get_nbest_match(nbest, prefixes, &matrix,
+                                      constraints, sentences);
+        for (size_t i = 0; i < sentences->len; ++i) {
+            MatchResults one = (MatchResults)
+                g_ptr_array_index(sentences, i);
+
+            char * nth_sentence = NULL;
+            pinyin_lookup.convert_to_utf8(one, nth_sentence);
+            printf("%ld:%s\n", i, nth_sentence);
+            g_free(nth_sentence);
+            g_array_free(one, TRUE);
+        }
+        g_ptr_array_free(sentences, TRUE);
+
+        check_incremental_search(options, pinyin_lookup, prefixes,
+                                 constraints, linebuf);
+
+        reset_constraints(constraints, matrix.size());
+        check_repeated_search(pinyin_lookup, prefixes, &matrix,
+                              constraints, results);
+
         g_free(sentence);
     }
 
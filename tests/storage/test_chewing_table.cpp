@@ -26,7 +26,92 @@
 
 size_t bench_times = 1000;
 
+static bool equal_ranges(PhraseIndexRanges lhs, PhraseIndexRanges rhs) {
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        GArray * lhs_range = lhs[i], * rhs_range = rhs[i];
+        if (NULL == lhs_range || NULL == rhs_range) {
+            if (lhs_range != rhs_range)
+                return false;
+            continue;
+        }
+
+        if (lhs_range->len != rhs_range->len)
+            return false;
+
+        if (0 != memcmp(lhs_range->data, rhs_range->data,
+                        lhs_range->len * sizeof(PhraseIndexRange)))
+            return false;
+    }
+
+    return true;
+}
+
+static gint compare_range(gconstpointer lhs, gconstpointer rhs) {
+    const PhraseIndexRange * lhs_range = (const PhraseIndexRange *) lhs;
+    const PhraseIndexRange * rhs_range = (const PhraseIndexRange *) rhs;
+
+    if (lhs_range->m_range_begin != rhs_range->m_range_begin)
+        return lhs_range->m_range_begin < rhs_range->m_range_begin ? -1 : 1;
+    if (lhs_range->m_range_end != rhs_range->m_range_end)
+        return lhs_range->m_range_end < rhs_range->m_range_end ? -1 : 1;
+    return 0;
+}
+
+static void sort_ranges(PhraseIndexRanges ranges) {
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        if (ranges[i])
+            g_array_sort(ranges[i], compare_range);
+    }
+}
+
+/* the matcher agrees with pinyin_compare_with_tones. */
+template<size_t phrase_length>
+static bool check_index_item_matcher(const ChewingKey keys[],
+                                     const ChewingKey * candidates,
+                                     size_t num) {
+    typedef PinyinIndexItem2<phrase_length> IndexItem;
+    const size_t count = num / phrase_length;
+    IndexItem * items = new IndexItem[count];
+    for (size_t i = 0; i < count; ++i)
+        items[i] = IndexItem(candidates + i * phrase_length, i);
+
+    const PinyinIndexItemMatcher<phrase_length> matcher(keys);
+    bool retval = true;
+    guint32 matched = 0; size_t left = 0;
+    for (size_t i = 0; i < count; ++i, matched >>= 1, --left) {
+        if (0 == left)
+            matched = matcher.match(items + i, items + count, left);
+
+        const bool expected = 0 == pinyin_compare_with_tones
+            (keys, items[i].m_keys, phrase_length);
+        if (expected != (bool) (matched & 1))
+            retval = false;
+    }
+
+    delete [] items;
+    return retval;
+}
+
 int main(int argc, char * argv[]) {
+    /* complete, toneless and incomplete pinyin keys. */
+    ChewingKey candidates[36];
+    for (size_t i = 0; i < G_N_ELEMENTS(candidates); ++i) {
+        ChewingKey key(CHEWING_B, CHEWING_ZERO_MIDDLE, CHEWING_A);
+        if (i % 3 == 1)
+            key.m_tone = CHEWING_1;
+        if (i % 4 == 2)
+            key.m_final = CHEWING_ZERO_FINAL;
+        if (i % 5 == 3)
+            key.m_initial = CHEWING_P;
+        candidates[i] = key;
+    }
+
+    for (size_t i = 0; i < 6; ++i) {
+        assert(check_index_item_matcher<1>(candidates + i, candidates, 36));
+        assert(check_index_item_matcher<2>(candidates + i, candidates, 36));
+        assert(check_index_item_matcher<3>(candidates + i, candidates, 36));
+    }
+
     SystemTableInfo2 system_table_info;
 
     bool retval = system_table_info.load("../../data/table.conf");
@@ -45,6 +130,11 @@ int main(int argc, char * argv[]) {
     if (!load_phrase_table(phrase_files, &largetable, NULL, &phrase_index))
         exit(ENOENT);
 
+    /* the packed chewing table keeps the same chewing indexes. */
+    assert(largetable.store_packed("/tmp/test.packed"));
+    ChewingLargeTable2 packedtable;
+    assert(packedtable.attach_packed("/tmp/test.packed"));
+
 #if 0
     MemoryChunk * new_chunk = new MemoryChunk;
     largetable.store(new_chunk);
@@ -84,15 +174,71 @@ int main(int argc, char * argv[]) {
         }
         print_time(start, bench_times);
 
+        PhraseIndexRanges packed_ranges;
+        memset(packed_ranges, 0, sizeof(PhraseIndexRanges));
+
+        phrase_index.prepare_ranges(packed_ranges);
+
+        start = record_time();
+        for (i = 0; i < bench_times; ++i) {
+            phrase_index.clear_ranges(packed_ranges);
+            packedtable.search(keys->len, (ChewingKey *)keys->data,
+                               packed_ranges);
+        }
+        print_time(start, bench_times);
+
         /* test search continued information. */
         int retval = SEARCH_NONE;
-        for (i = 1; i < keys->len; ++i) {
+        for (i = 1; i <= keys->len; ++i) {
             phrase_index.clear_ranges(ranges);
             retval = largetable.search(i, (ChewingKey *)keys->data, ranges);
-            if (retval & SEARCH_CONTINUED)
+            if (i < keys->len && (retval & SEARCH_CONTINUED))
                 printf("return continued information with length:%ld\n", i);
+
+            phrase_index.clear_ranges(packed_ranges);
+            assert(retval == packedtable.search
+                   (i, (ChewingKey *)keys->data, packed_ranges));
+            assert(equal_ranges(ranges, packed_ranges));
+        }
+
+        /* test the batch search with the toneless keys,
+           and the empty keys, which are missing in the table. */
+        GArray * batch_keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+        g_array_append_vals(batch_keys, keys->data, keys->len);
+        for (i = 0; i < keys->len; ++i) {
+            ChewingKey key = g_array_index(keys, ChewingKey, i);
+            key.m_tone = CHEWING_ZERO_TONE;
+            g_array_append_val(batch_keys, key);
+        }
+        for (i = 0; i < keys->len; ++i) {
+            ChewingKey key;
+            g_array_append_val(batch_keys, key);
         }
 
+        phrase_index.clear_ranges(ranges);
+        retval = SEARCH_NONE;
+        for (i = 0; i < 3; ++i)
+            retval |= largetable.search
+                (keys->len, (ChewingKey *)batch_keys->data + i * keys->len,
+                 ranges);
+
+        phrase_index.clear_ranges(packed_ranges);
+        assert(retval == largetable.search_batch
+               (keys->len, (ChewingKey *)batch_keys->data, 3,
+                packed_ranges));
+        sort_ranges(ranges); sort_ranges(packed_ranges);
+        assert(equal_ranges(ranges, packed_ranges));
+
+        phrase_index.clear_ranges(packed_ranges);
+        assert(retval == packedtable.search_batch
+               (keys->len, (ChewingKey *)batch_keys->data, 3,
+                packed_ranges));
+        sort_ranges(packed_ranges);
+        assert(equal_ranges(ranges, packed_ranges));
+        g_array_free(batch_keys, TRUE);
+
+        phrase_index.destroy_ranges(packed_ranges);
+
         phrase_index.clear_ranges(ranges);
         largetable.search(keys->len, (ChewingKey *)keys->data, ranges);
 
@@ -108,6 +254,7 @@ int main(int argc, char * argv[]) {
 
     /* mask out all index items. */
     largetable.mask_out(0x0, 0x0);
+    assert(!packedtable.mask_out(0x0, 0x0));
 
     return 0;
 }
@@ -33,6 +33,7 @@ bool test_pronunciation_possibility(PhoneticKeyMatrix * matrix,
                                     FacadePhraseIndex * phrase_index,
                                     PhraseIndexRanges ranges) {
     GArray * cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+    PhoneticSpanCache span_cache;
 
     for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
         GArray * & range = ranges[i];
@@ -58,6 +59,11 @@ bool test_pronunciation_possibility(PhoneticKeyMatrix * matrix,
                 gfloat origin = compute_pronunciation_possibility
                     (matrix, start, end, cached_keys, item);
 
+                /* the memorized possibility is the same. */
+                span_cache.reset(matrix);
+                assert(origin == span_cache.compute_pronunciation_possibility
+                       (start, end, token, item));
+
                 bool increased = increase_pronunciation_possibility
                     (matrix, start, end, cached_keys, item, 30);
 
@@ -106,6 +112,7 @@ int main(int argc, char * argv[]) {
         g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
 
     PhoneticKeyMatrix matrix;
+    PhoneticSearchCache search_cache;
 
     char* linebuf = NULL; size_t size = 0; ssize_t read;
     while( (read = getline(&linebuf, &size, stdin)) != -1 ){
@@ -143,6 +150,11 @@ int main(int argc, char * argv[]) {
 
         phrase_index.prepare_ranges(ranges);
 
+        PhraseIndexRanges cached_ranges;
+        memset(cached_ranges, 0, sizeof(PhraseIndexRanges));
+
+        phrase_index.prepare_ranges(cached_ranges);
+
         for (size_t i = 0; i < matrix.size(); ++i) {
             for (size_t j = i + 1; j < matrix.size(); ++j) {
                 phrase_index.clear_ranges(ranges);
@@ -150,6 +162,19 @@ int main(int argc, char * argv[]) {
                 printf("search index: start %ld\t end %ld\n", i, j);
                 int retval = search_matrix(&largetable, &matrix, i, j, ranges);
 
+                /* the second search is memorized. */
+                for (size_t k = 0; k < 2; ++k) {
+                    phrase_index.clear_ranges(cached_ranges);
+                    int cached = search_cache.search
+                        (&largetable, &matrix, i, j, cached_ranges);
+                    assert(retval == cached);
+
+                    for (size_t n = 0; n < PHRASE_INDEX_LIBRARY_COUNT; ++n) {
+                        if (ranges[n])
+                            assert(ranges[n]->len == cached_ranges[n]->len);
+                    }
+                }
+
 #if 0
                 if (retval & SEARCH_OK) {
                     dump_ranges(&phrase_index, ranges);
@@ -164,6 +189,7 @@ int main(int argc, char * argv[]) {
         }
 
         phrase_index.destroy_ranges(ranges);
+        phrase_index.destroy_ranges(cached_ranges);
     }
 
     if (linebuf)
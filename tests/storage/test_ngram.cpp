@@ -1,6 +1,36 @@
 #include <stdio.h>
 #include "pinyin_internal.h"
 
+/* the shared bi-grams of the concurrent lookups. */
+struct merged_lookup_t{
+    Bigram * m_system_bigram;
+    Bigram * m_user_bigram;
+    Bigram * m_merged_bigram;
+    guint32 m_merged_total_freq;
+};
+
+static gpointer merged_lookup_thread(gpointer data){
+    merged_lookup_t * lookup = (merged_lookup_t *) data;
+
+    /* one cache per lookup instance, the bi-grams are shared. */
+    SingleGramCache cache(lookup->m_system_bigram, lookup->m_user_bigram,
+                          1, lookup->m_merged_bigram);
+
+    const SingleGram * merged = NULL;
+    guint32 freq = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        /* the capacity is one, so every load of 2 misses the cache,
+           and is loaded from the merged bi-gram. */
+        assert(cache.load(2, merged));
+        assert(merged->get_total_freq(freq));
+        assert(freq == lookup->m_merged_total_freq);
+        assert(cache.load(1, merged));
+        assert(merged->get_total_freq(freq));
+        assert(freq == 16);
+    }
+
+    return NULL;
+}
 
 int main(int argc, char * argv[]){
     SingleGram single_gram;
@@ -60,6 +90,39 @@ int main(int argc, char * argv[]){
         delete gram;
     }
     
+    /* the view borrows the memory of the bi-gram. */
+    SingleGram view;
+    assert(bigram.load_view(2, view));
+    assert(view.get_total_freq(freq));
+    assert(freq == 32);
+    assert(view.get_freq(5, freq));
+    assert(freq == 8);
+    assert(!bigram.load_view(7, view));
+
+    /* the packed bi-gram keeps the same single grams. */
+    assert(PackedBigram::convert(&bigram, "/tmp/test.bin"));
+    Bigram packed_bigram;
+    assert(packed_bigram.attach_packed("/tmp/test.bin"));
+    assert(packed_bigram.load_view(2, view));
+    assert(view.get_total_freq(freq));
+    assert(freq == 32);
+    assert(view.get_freq(5, freq));
+    assert(freq == 8);
+    assert(!packed_bigram.load_view(3, view));
+    assert(!packed_bigram.store(2, &single_gram));
+
+    /* the corrupt offset in the middle is rejected. */
+    MemoryChunk packed_chunk;
+    assert(packed_chunk.load("/tmp/test.bin"));
+    const size_t middle_offset = sizeof(guint32) *
+        (PHRASE_INDEX_LIBRARY_COUNT * 2 + 1);
+    guint32 corrupt_offset = G_MAXUINT32;
+    packed_chunk.set_content(middle_offset, &corrupt_offset,
+                             sizeof(guint32));
+    assert(packed_chunk.save("/tmp/test_corrupt.bin"));
+    Bigram corrupt_bigram;
+    assert(!corrupt_bigram.attach_packed("/tmp/test_corrupt.bin"));
+
     printf("--------------------------------------------------------\n");
     assert(single_gram.get_total_freq(freq));
     printf("total_freq:%d\n", freq);
@@ -80,6 +143,82 @@ int main(int argc, char * argv[]){
 
     g_array_free(items, TRUE);
 
+    printf("----------------------cache-----------------------------\n");
+    Bigram user_bigram;
+    unlink("/tmp/test_user.db");
+    assert(user_bigram.attach("/tmp/test_user.db",
+                              ATTACH_CREATE|ATTACH_READWRITE));
+    SingleGramCache cache(&bigram, &user_bigram, 1);
+
+    const SingleGram * merged = NULL;
+    assert(cache.load(2, merged));
+    assert(merged->get_total_freq(freq));
+    assert(freq == 32);
+    /* missing single gram is cached, and evicts the least recently used. */
+    assert(!cache.load(3, merged));
+    assert(1 == cache.get_length());
+
+    SingleGram user_gram;
+    assert(user_gram.set_total_freq(4));
+    assert(user_gram.insert_freq(5, 4));
+    assert(user_bigram.store(2, &user_gram));
+
+    assert(cache.load(2, merged));
+    assert(merged->get_freq(5, freq));
+    assert(freq == 8 + 4);
+
+    /* stale until invalidated. */
+    assert(user_gram.set_total_freq(8));
+    assert(user_gram.set_freq(5, 8));
+    assert(user_bigram.store(2, &user_gram));
+    assert(cache.load(2, merged));
+    assert(merged->get_total_freq(freq));
+    assert(freq == 32 + 4);
+
+    assert(cache.invalidate(2));
+    assert(cache.load(2, merged));
+    assert(merged->get_total_freq(freq));
+    assert(freq == 32 + 8);
+    assert(cache.reset());
+    assert(0 == cache.get_length());
+
+    /* the merged single gram is loaded without the merge. */
+    Bigram merged_bigram;
+    assert(merged_bigram.attach(NULL, ATTACH_CREATE|ATTACH_READWRITE));
+    SingleGram system_view, user_view, merged_gram;
+    assert(bigram.load_view(2, system_view));
+    assert(user_bigram.load_view(2, user_view));
+    assert(merge_single_gram(&merged_gram, &system_view, &user_view));
+    assert(merged_bigram.store(2, &merged_gram));
+
+    SingleGramCache merged_cache(&bigram, &user_bigram, 1, &merged_bigram);
+    assert(merged_cache.load(2, merged));
+    assert(merged->get_total_freq(freq));
+    assert(freq == 32 + 8);
+
+    /* the stale merged single gram is removed. */
+    assert(merged_cache.invalidate(2));
+    assert(!merged_bigram.load(2, gram));
+
+    /* the concurrent lookups share the merged bi-gram. */
+    SingleGram distinct_gram;
+    assert(distinct_gram.set_total_freq(64));
+    assert(distinct_gram.insert_freq(5, 16));
+    assert(merged_bigram.store(2, &distinct_gram));
+
+    merged_lookup_t lookup;
+    lookup.m_system_bigram = &bigram;
+    lookup.m_user_bigram = &user_bigram;
+    lookup.m_merged_bigram = &merged_bigram;
+    lookup.m_merged_total_freq = 64;
+
+    GThread * threads[4];
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); ++i)
+        threads[i] = g_thread_new("test_ngram", merged_lookup_thread,
+                                  &lookup);
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); ++i)
+        g_thread_join(threads[i]);
+
     /* mask out all index items. */
     bigram.mask_out(0x0, 0x0);
 
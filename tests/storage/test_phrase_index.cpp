@@ -55,6 +55,14 @@ int main(int argc, char * argv[]){
     }
     print_time(time, bench_times);
 
+    /* the hot item is filled from the loaded chunk on the first access. */
+    phrase_hot_item_t hot_item;
+    assert(!phrase_index_test.get_hot_item(1, hot_item));
+    assert(hot_item.m_unigram_frequency == 0);
+    assert(hot_item.m_n_pronunciation == 2);
+    assert(hot_item.m_phrase_length == 1);
+    assert(ERROR_NO_ITEM == phrase_index_test.get_hot_item(0, hot_item));
+
     {
         PhraseItem item3;
         phrase_index_test.get_phrase_item(1, item3);
@@ -70,6 +78,51 @@ int main(int argc, char * argv[]){
         assert(poss == 0.5);
     }
 
+    {
+        /* the journal replays the changes after the store. */
+        MemoryChunk * base = new MemoryChunk;
+        assert(phrase_index_test.store(0, base));
+        assert(phrase_index_test.start_journal(0));
+        assert(!phrase_index_test.add_unigram_frequency(1, 5));
+
+        MemoryChunk * journal = new MemoryChunk;
+        assert(phrase_index_test.flush_journal(0, journal));
+
+        FacadePhraseIndex replayed;
+        assert(replayed.load(0, base));
+        assert(replayed.replay_journal(0, journal));
+
+        PhraseItem item6;
+        assert(!replayed.get_phrase_item(1, item6));
+        assert(item6.get_unigram_frequency() == 5);
+        assert(item6.get_pronunciation_possibility(&key1) == 0.5);
+        assert(replayed.get_phrase_index_total_freq() == 5);
+
+        /* the pronunciation change alone is journaled. */
+        PhraseItem item7;
+        assert(!phrase_index_test.get_writable_phrase_item(1, item7));
+        item7.increase_pronunciation_possibility(&key1, 600);
+        assert(!phrase_index_test.update_phrase_item(1));
+
+        journal = new MemoryChunk;
+        assert(phrase_index_test.flush_journal(0, journal));
+        assert(replayed.replay_journal(0, journal));
+        assert(!replayed.get_phrase_item(1, item6));
+        assert(item6.get_pronunciation_possibility(&key1) == 0.75);
+        assert(item6.get_unigram_frequency() == 5);
+
+        /* the removed phrase item is not replayed. */
+        PhraseItem * removed = NULL;
+        assert(!phrase_index_test.remove_phrase_item(1, removed));
+        delete removed;
+
+        journal = new MemoryChunk;
+        assert(phrase_index_test.flush_journal(0, journal));
+        assert(replayed.replay_journal(0, journal));
+        assert(ERROR_NO_ITEM == replayed.get_phrase_item(1, item6));
+        assert(replayed.get_phrase_index_total_freq() == 0);
+    }
+
     SystemTableInfo2 system_table_info;
 
     bool retval = system_table_info.load("../../data/table.conf");
@@ -112,10 +165,58 @@ int main(int argc, char * argv[]){
     phrase_index.add_unigram_frequency(16870553, delta);
     phrase_index.get_phrase_item(16870553, item2);
     assert( item2.get_unigram_frequency() == 3);
+    assert(!phrase_index.get_hot_item(16870553, hot_item));
+    assert(hot_item.m_unigram_frequency == 3);
+    assert(hot_item.m_phrase_length == 14);
+
+    /* the hot item is kept in sync with the phrase item. */
+    PhraseItem * removed_item = NULL;
+    assert(!phrase_index.remove_phrase_item(16870553, removed_item));
+    assert(ERROR_NO_ITEM == phrase_index.get_hot_item(16870553, hot_item));
+    assert(!phrase_index.add_phrase_item(16870553, removed_item));
+    assert(!phrase_index.get_hot_item(16870553, hot_item));
+    assert(hot_item.m_unigram_frequency == 3);
+    delete removed_item;
 
     phrase_index.get_phrase_item(16777222, item2);
     assert(item2.get_phrase_length() == 1);
     assert(item2.get_n_pronunciation() == 2);
 
+    /* the changed phrase item is copied into the overlay. */
+    PhraseItem base_item;
+    phrase_index.get_phrase_item(16777222, base_item);
+    guint32 base_freq = base_item.get_unigram_frequency();
+    phrase_index.add_unigram_frequency(16777222, delta);
+    assert(base_item.get_unigram_frequency() == base_freq);
+    phrase_index.get_phrase_item(16777222, item2);
+    assert(item2.get_unigram_frequency() == base_freq + delta);
+
+    /* the replaced phrase item in the overlay is unreachable. */
+    size_t live_bytes = 0, total_bytes = 0;
+    assert(phrase_index.get_content_usage(1, live_bytes, total_bytes));
+    PhraseItem * replaced = NULL;
+    assert(!phrase_index.remove_phrase_item(16777222, replaced));
+    assert(!phrase_index.add_phrase_item(16777222, replaced));
+    delete replaced;
+
+    size_t new_live_bytes = 0, new_total_bytes = 0;
+    assert(phrase_index.get_content_usage(1, new_live_bytes, new_total_bytes));
+    assert(new_live_bytes == live_bytes);
+    assert(new_total_bytes > total_bytes);
+
+    assert(phrase_index.compact(1));
+    assert(phrase_index.get_content_usage(1, new_live_bytes, new_total_bytes));
+    assert(new_live_bytes == new_total_bytes);
+    assert(new_live_bytes == live_bytes);
+
+    /* the overlay is stored with the loaded chunk. */
+    MemoryChunk* store3 = new MemoryChunk;
+    phrase_index.store(1, store3);
+    phrase_index.load(1, store3);
+    phrase_index.get_phrase_item(16777222, item2);
+    assert(item2.get_unigram_frequency() == base_freq + delta);
+    phrase_index.get_phrase_item(16870553, item2);
+    assert(item2.get_unigram_frequency() == 3);
+
     return 0;
 }
@@ -33,6 +33,7 @@ static GOptionEntry entries[] =
 };
 
 bool generate_binary_files(const char * pinyin_table_filename,
+                           const char * packed_pinyin_table_filename,
                            const char * phrase_table_filename,
                            const pinyin_table_info_t * phrase_files) {
     /* generate pinyin index*/
@@ -72,6 +73,10 @@ bool generate_binary_files(const char * pinyin_table_filename,
         g_free(filename);
     }
 
+    /* generate packed pinyin index */
+    if (!pinyin_table.store_packed(packed_pinyin_table_filename))
+        exit(ENOENT);
+
     phrase_index.compact();
 
     if (!save_phrase_index(phrase_files, &phrase_index))
@@ -110,12 +115,14 @@ int main(int argc, char * argv[]){
         system_table_info.get_default_tables();
 
     generate_binary_files(SYSTEM_PINYIN_INDEX,
+                          SYSTEM_PACKED_PINYIN_INDEX,
                           SYSTEM_PHRASE_INDEX,
                           phrase_files);
 
     phrase_files = system_table_info.get_addon_tables();
 
     generate_binary_files(ADDON_SYSTEM_PINYIN_INDEX,
+                          ADDON_SYSTEM_PACKED_PINYIN_INDEX,
                           ADDON_SYSTEM_PHRASE_INDEX,
                           phrase_files);
 
@@ -0,0 +1,82 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2016 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <locale.h>
+#include <glib.h>
+#include "pinyin_internal.h"
+#include "utils_helper.h"
+
+static const gchar * table_dir = ".";
+
+static GOptionEntry entries[] =
+{
+    {"table-dir", 0, 0, G_OPTION_ARG_FILENAME, &table_dir, "table directory", NULL},
+    {NULL}
+};
+
+int main(int argc, char * argv[]){
+    setlocale(LC_ALL, "");
+
+    GError * error = NULL;
+    GOptionContext * context;
+
+    context = g_option_context_new("- generate packed bi-gram");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_print("option parsing failed:%s\n", error->message);
+        exit(EINVAL);
+    }
+
+    Bigram bigram;
+    gchar * filename = g_build_filename(table_dir, SYSTEM_BIGRAM, NULL);
+    if (!bigram.attach(filename, ATTACH_READONLY)) {
+        fprintf(stderr, "open %s failed.\n", filename);
+        exit(ENOENT);
+    }
+    g_free(filename);
+
+    filename = g_build_filename(table_dir, SYSTEM_PACKED_BIGRAM, NULL);
+    if (!PackedBigram::convert(&bigram, filename)) {
+        fprintf(stderr, "save %s failed.\n", filename);
+        exit(ENOENT);
+    }
+    g_free(filename);
+
+    /* verify the packed bi-gram. */
+    Bigram packed;
+    filename = g_build_filename(table_dir, SYSTEM_PACKED_BIGRAM, NULL);
+    if (!packed.attach_packed(filename)) {
+        fprintf(stderr, "attach %s failed.\n", filename);
+        exit(ENOENT);
+    }
+    g_free(filename);
+
+    GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    GArray * packed_items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    bigram.get_all_items(items);
+    packed.get_all_items(packed_items);
+    assert(items->len == packed_items->len);
+
+    g_array_free(items, TRUE);
+    g_array_free(packed_items, TRUE);
+    return 0;
+}
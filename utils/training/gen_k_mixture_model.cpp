@@ -25,6 +25,7 @@
 #include "pinyin_internal.h"
 #include "utils_helper.h"
 #include "k_mixture_model.h"
+#include "merge_k_mixture_model.h"
 
 /* Hash token of Hash token of word count. */
 typedef GHashTable * HashofDocument;
@@ -38,6 +39,7 @@ void print_help(){
            "                           [--maximum-occurs-allowed <INT>]\n"
            "                           [--maximum-increase-rates-allowed <FLOAT>]\n"
            "                           [--k-mixture-model-file <FILENAME>]\n"
+           "                           [--threads <INT>]\n"
            "                           {<FILENAME>}+\n");
 }
 
@@ -46,6 +48,7 @@ static gint g_maximum_occurs = 20;
 static parameter_t g_maximum_increase_rates = 3.;
 static gboolean g_train_pi_gram = TRUE;
 static const gchar * g_k_mixture_model_filename = NULL;
+static gint g_threads = 1;
 
 static GOptionEntry entries[] =
 {
@@ -53,6 +56,7 @@ static GOptionEntry entries[] =
     {"maximum-occurs-allowed", 0, 0, G_OPTION_ARG_INT, &g_maximum_occurs, "maximum occurs allowed", NULL},
     {"maximum-increase-rates-allowed", 0, 0, G_OPTION_ARG_DOUBLE, &g_maximum_increase_rates, "maximum increase rates allowed", NULL},
     {"k-mixture-model-file", 0, 0, G_OPTION_ARG_FILENAME, &g_k_mixture_model_filename, "k mixture model file", NULL},
+    {"threads", 0, 0, G_OPTION_ARG_INT, &g_threads, "the number of worker threads", NULL},
     {NULL}
 };
 
@@ -314,6 +318,141 @@ static bool post_processing_unigram(KMixtureModelBigram * bigram,
     return true;
 }
 
+/* train one document into the k mixture model. */
+static bool train_document(PhraseLargeTable3 * phrase_table,
+                           FacadePhraseIndex * phrase_index,
+                           KMixtureModelBigram * bigram,
+                           const char * filename){
+    FILE * document = fopen(filename, "r");
+    if ( NULL == document ){
+        int err_saved = errno;
+        fprintf(stderr, "can't open file: %s.\n", filename);
+        fprintf(stderr, "error:%s.\n", strerror(err_saved));
+        exit(err_saved);
+    }
+
+    HashofDocument hash_of_document = g_hash_table_new
+        (g_direct_hash, g_direct_equal);
+    HashofUnigram hash_of_unigram = g_hash_table_new
+        (g_direct_hash, g_direct_equal);
+
+    assert(read_document(phrase_table, phrase_index, document,
+                         hash_of_document, hash_of_unigram));
+    fclose(document);
+    document = NULL;
+
+    GHashTableIter iter;
+    gpointer key, value;
+
+    /* train the document, and convert it to k mixture model. */
+    g_hash_table_iter_init(&iter, hash_of_document);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        phrase_token_t token1 = GPOINTER_TO_UINT(key);
+        train_second_word(hash_of_unigram, bigram,
+                          hash_of_document, token1);
+    }
+
+    KMixtureModelMagicHeader magic_header;
+    assert(bigram->get_magic_header(magic_header));
+    magic_header.m_N ++;
+    assert(bigram->set_magic_header(magic_header));
+
+    post_processing_unigram(bigram, hash_of_unigram);
+
+    /* free resources of g_hash_of_document */
+    g_hash_table_iter_init(&iter, hash_of_document);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        HashofSecondWord second_word = (HashofSecondWord) value;
+        g_hash_table_iter_steal(&iter);
+        g_hash_table_unref(second_word);
+    }
+    g_hash_table_unref(hash_of_document);
+    hash_of_document = NULL;
+
+    g_hash_table_unref(hash_of_unigram);
+    hash_of_unigram = NULL;
+    return true;
+}
+
+/* the documents of one worker thread, which are trained into
+   the private in-memory k mixture model. */
+struct k_mixture_model_worker_t{
+    PhraseLargeTable3 * m_phrase_table;
+    FacadePhraseIndex * m_phrase_index;
+
+    /* train the documents from m_first with the step of m_step. */
+    char ** m_filenames;
+    int m_num_of_filenames;
+    int m_first;
+    int m_step;
+
+    KMixtureModelBigram * m_bigram;
+    int m_num_of_documents;
+};
+
+static gpointer train_documents_thread(gpointer data){
+    k_mixture_model_worker_t * worker = (k_mixture_model_worker_t *) data;
+
+    for (int i = worker->m_first; i < worker->m_num_of_filenames;
+         i += worker->m_step) {
+        train_document(worker->m_phrase_table, worker->m_phrase_index,
+                       worker->m_bigram, worker->m_filenames[i]);
+        ++worker->m_num_of_documents;
+    }
+
+    return NULL;
+}
+
+/* shard the documents across the worker threads,
+   then merge the private models into the k mixture model. */
+static bool train_documents_parallel(PhraseLargeTable3 * phrase_table,
+                                     FacadePhraseIndex * phrase_index,
+                                     KMixtureModelBigram * bigram,
+                                     char ** filenames,
+                                     int num_of_filenames,
+                                     int num_of_threads){
+    k_mixture_model_worker_t * workers =
+        g_new0(k_mixture_model_worker_t, num_of_threads);
+    GThread ** threads = g_new0(GThread *, num_of_threads);
+
+    for (int i = 0; i < num_of_threads; ++i) {
+        k_mixture_model_worker_t * worker = workers + i;
+        worker->m_phrase_table = phrase_table;
+        worker->m_phrase_index = phrase_index;
+        worker->m_filenames = filenames;
+        worker->m_num_of_filenames = num_of_filenames;
+        worker->m_first = i;
+        worker->m_step = num_of_threads;
+
+        worker->m_bigram = new KMixtureModelBigram
+            (K_MIXTURE_MODEL_MAGIC_NUMBER);
+        bool retval = worker->m_bigram->attach
+            (NULL, ATTACH_READWRITE|ATTACH_CREATE);
+        assert(retval);
+
+        threads[i] = g_thread_new("gen_k_mixture_model",
+                                  train_documents_thread, worker);
+    }
+
+    bool retval = true;
+    /* merge in the order of the shards, for the same output. */
+    for (int i = 0; i < num_of_threads; ++i) {
+        k_mixture_model_worker_t * worker = workers + i;
+        g_thread_join(threads[i]);
+
+        /* the empty model has no magic header. */
+        if (retval && worker->m_num_of_documents > 0)
+            retval = merge_two_k_mixture_model(bigram, worker->m_bigram);
+
+        delete worker->m_bigram;
+        worker->m_bigram = NULL;
+    }
+
+    g_free(threads);
+    g_free(workers);
+    return retval;
+}
+
 int main(int argc, char * argv[]){
     int i = 1;
 
@@ -351,57 +490,19 @@ int main(int argc, char * argv[]){
     KMixtureModelBigram bigram(K_MIXTURE_MODEL_MAGIC_NUMBER);
     bigram.attach(g_k_mixture_model_filename, ATTACH_READWRITE|ATTACH_CREATE);
 
+    /* the phrase table and index are only read by the workers. */
+    if ( g_threads > 1 ) {
+        retval = train_documents_parallel
+            (&phrase_table, &phrase_index, &bigram,
+             argv + i, argc - i, g_threads);
+        if ( !retval )
+            exit(EINVAL);
+        return 0;
+    }
+
     while ( i < argc ){
         const char * filename = argv[i];
-        FILE * document = fopen(filename, "r");
-        if ( NULL == document ){
-            int err_saved = errno;
-            fprintf(stderr, "can't open file: %s.\n", filename);
-            fprintf(stderr, "error:%s.\n", strerror(err_saved));
-            exit(err_saved);
-        }
-
-        HashofDocument hash_of_document = g_hash_table_new
-            (g_direct_hash, g_direct_equal);
-        HashofUnigram hash_of_unigram = g_hash_table_new
-            (g_direct_hash, g_direct_equal);
-
-        assert(read_document(&phrase_table, &phrase_index, document,
-                             hash_of_document, hash_of_unigram));
-        fclose(document);
-        document = NULL;
-
-        GHashTableIter iter;
-        gpointer key, value;
-
-        /* train the document, and convert it to k mixture model. */
-        g_hash_table_iter_init(&iter, hash_of_document);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            phrase_token_t token1 = GPOINTER_TO_UINT(key);
-            train_second_word(hash_of_unigram, &bigram,
-                              hash_of_document, token1);
-        }
-
-        KMixtureModelMagicHeader magic_header;
-        assert(bigram.get_magic_header(magic_header));
-        magic_header.m_N ++;
-        assert(bigram.set_magic_header(magic_header));
-
-        post_processing_unigram(&bigram, hash_of_unigram);
-
-        /* free resources of g_hash_of_document */
-        g_hash_table_iter_init(&iter, hash_of_document);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            HashofSecondWord second_word = (HashofSecondWord) value;
-            g_hash_table_iter_steal(&iter);
-            g_hash_table_unref(second_word);
-        }
-        g_hash_table_unref(hash_of_document);
-        hash_of_document = NULL;
-
-        g_hash_table_unref(hash_of_unigram);
-        hash_of_unigram = NULL;
-
+        train_document(&phrase_table, &phrase_index, &bigram, filename);
         ++i;
     }
 
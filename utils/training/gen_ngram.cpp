@@ -29,14 +29,359 @@
 
 static gboolean train_pi_gram = TRUE;
 static const gchar * bigram_filename = SYSTEM_BIGRAM;
+static gint num_of_threads = 1;
+static gint chunk_size = 1000000;
 
 static GOptionEntry entries[] =
 {
     {"skip-pi-gram-training", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &train_pi_gram, "skip pi-gram training", NULL},
     {"bigram-file", 0, 0, G_OPTION_ARG_FILENAME, &bigram_filename, "bi-gram file", NULL},
+    {"threads", 0, 0, G_OPTION_ARG_INT, &num_of_threads, "the number of worker threads", NULL},
+    {"chunk-size", 0, 0, G_OPTION_ARG_INT, &chunk_size, "the number of lines counted in memory before spill", NULL},
     {NULL}
 };
 
+/* merge the sorted runs into one run, when there are too many runs. */
+static const guint MAX_NGRAM_RUNS = 64;
+
+/* the count of the (prev, cur) pair,
+   the uni-gram count uses null_token as the prev token. */
+struct ngram_record_t{
+    phrase_token_t m_prev;
+    phrase_token_t m_cur;
+    guint32 m_count;
+};
+
+static gint compare_ngram_record(gconstpointer lhs, gconstpointer rhs){
+    const ngram_record_t * lhs_record = (const ngram_record_t *) lhs;
+    const ngram_record_t * rhs_record = (const ngram_record_t *) rhs;
+
+    if (lhs_record->m_prev != rhs_record->m_prev)
+        return lhs_record->m_prev < rhs_record->m_prev ? -1 : 1;
+    if (lhs_record->m_cur != rhs_record->m_cur)
+        return lhs_record->m_cur < rhs_record->m_cur ? -1 : 1;
+    return 0;
+}
+
+typedef void (* ngram_record_func_t) (const ngram_record_t * record,
+                                      gpointer user_data);
+
+/* the sorted run, spilled to the temporary file. */
+struct ngram_run_t{
+    FILE * m_file;
+    ngram_record_t m_record;
+};
+
+static bool read_ngram_record(ngram_run_t * run){
+    return 1 == fread(&run->m_record, sizeof(ngram_record_t), 1, run->m_file);
+}
+
+/* the min heap of the runs. */
+struct ngram_run_greater{
+    bool operator () (const ngram_run_t * lhs,
+                      const ngram_run_t * rhs) const {
+        return compare_ngram_record(&lhs->m_record, &rhs->m_record) > 0;
+    }
+};
+
+/* k-way merge of the sorted runs, the counts of the same pair are summed,
+   and the runs are closed. */
+static void merge_ngram_runs(GPtrArray * files,
+                             ngram_record_func_t func,
+                             gpointer user_data){
+    ngram_run_t * runs = g_new0(ngram_run_t, files->len);
+    ngram_run_t ** heap = g_new0(ngram_run_t *, files->len);
+    size_t heap_size = 0;
+
+    for (size_t i = 0; i < files->len; ++i) {
+        ngram_run_t * run = runs + i;
+        run->m_file = (FILE *) g_ptr_array_index(files, i);
+        if (read_ngram_record(run))
+            heap[heap_size++] = run;
+    }
+    std_lite::make_heap(heap, heap + heap_size, ngram_run_greater());
+
+    bool has_pending = false;
+    ngram_record_t pending;
+    while (heap_size) {
+        std_lite::pop_heap(heap, heap + heap_size, ngram_run_greater());
+        ngram_run_t * run = heap[heap_size - 1];
+
+        if (has_pending &&
+            0 == compare_ngram_record(&pending, &run->m_record)) {
+            pending.m_count += run->m_record.m_count;
+        } else {
+            if (has_pending)
+                func(&pending, user_data);
+            pending = run->m_record;
+            has_pending = true;
+        }
+
+        if (read_ngram_record(run))
+            std_lite::push_heap(heap, heap + heap_size, ngram_run_greater());
+        else
+            --heap_size;
+    }
+
+    if (has_pending)
+        func(&pending, user_data);
+
+    for (size_t i = 0; i < files->len; ++i)
+        fclose(runs[i].m_file);
+
+    g_free(heap);
+    g_free(runs);
+}
+
+static void write_ngram_run(const ngram_record_t * record,
+                            gpointer user_data){
+    FILE * output = (FILE *) user_data;
+    size_t written = fwrite(record, sizeof(ngram_record_t), 1, output);
+    assert(1 == written);
+}
+
+static FILE * create_ngram_run(){
+    FILE * output = tmpfile();
+    if (NULL == output) {
+        int err_saved = errno;
+        fprintf(stderr, "can't create temporary file.\n");
+        fprintf(stderr, "error:%s.\n", strerror(err_saved));
+        exit(err_saved);
+    }
+    return output;
+}
+
+/* Hash token of Hash token of count. */
+typedef GHashTable * HashofNgram;
+typedef GHashTable * HashofSecondWord;
+
+static void accumulate_ngram(HashofNgram hash_of_ngram,
+                             phrase_token_t prev,
+                             phrase_token_t cur){
+    HashofSecondWord hash_of_second_word = (HashofSecondWord)
+        g_hash_table_lookup(hash_of_ngram, GUINT_TO_POINTER(prev));
+    if (NULL == hash_of_second_word) {
+        hash_of_second_word = g_hash_table_new
+            (g_direct_hash, g_direct_equal);
+        g_hash_table_insert(hash_of_ngram, GUINT_TO_POINTER(prev),
+                            hash_of_second_word);
+    }
+
+    guint32 count = GPOINTER_TO_UINT(g_hash_table_lookup
+        (hash_of_second_word, GUINT_TO_POINTER(cur)));
+    g_hash_table_insert(hash_of_second_word, GUINT_TO_POINTER(cur),
+                        GUINT_TO_POINTER(count + 1));
+}
+
+/* spill the counts to the sorted run. */
+static FILE * spill_ngram_run(HashofNgram hash_of_ngram){
+    GArray * records = g_array_new(FALSE, FALSE, sizeof(ngram_record_t));
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, hash_of_ngram);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        HashofSecondWord hash_of_second_word = (HashofSecondWord) value;
+
+        GHashTableIter second_iter;
+        gpointer second_key, second_value;
+        g_hash_table_iter_init(&second_iter, hash_of_second_word);
+        while (g_hash_table_iter_next
+               (&second_iter, &second_key, &second_value)) {
+            ngram_record_t record;
+            record.m_prev = GPOINTER_TO_UINT(key);
+            record.m_cur = GPOINTER_TO_UINT(second_key);
+            record.m_count = GPOINTER_TO_UINT(second_value);
+            g_array_append_val(records, record);
+        }
+    }
+
+    g_array_sort(records, compare_ngram_record);
+
+    FILE * output = create_ngram_run();
+    size_t written = fwrite(records->data, sizeof(ngram_record_t),
+                            records->len, output);
+    assert(written == records->len);
+    rewind(output);
+
+    g_array_free(records, TRUE);
+    return output;
+}
+
+/* the lines of the input, the last line of the previous chunk
+   is only used as the context of the first bi-gram. */
+struct ngram_chunk_t{
+    gchar * m_context;
+    GPtrArray * m_lines;
+};
+
+static void free_ngram_chunk(ngram_chunk_t * chunk){
+    g_free(chunk->m_context);
+    for (size_t i = 0; i < chunk->m_lines->len; ++i)
+        g_free(g_ptr_array_index(chunk->m_lines, i));
+    g_ptr_array_free(chunk->m_lines, TRUE);
+    delete chunk;
+}
+
+struct ngram_counter_t{
+    FacadePhraseIndex * m_phrase_index;
+
+    GMutex m_mutex;
+    GCond m_cond;
+    /* the number of queued chunks, to bound the memory usage. */
+    gint m_pending;
+    /* the spilled sorted runs. */
+    GPtrArray * m_runs;
+};
+
+static void add_ngram_run(ngram_counter_t * counter, FILE * run){
+    GPtrArray * runs = NULL;
+
+    g_mutex_lock(&counter->m_mutex);
+    g_ptr_array_add(counter->m_runs, run);
+    if (counter->m_runs->len >= MAX_NGRAM_RUNS) {
+        runs = counter->m_runs;
+        counter->m_runs = g_ptr_array_new();
+    }
+    g_mutex_unlock(&counter->m_mutex);
+
+    if (NULL == runs)
+        return;
+
+    /* merge the runs outside of the lock. */
+    FILE * output = create_ngram_run();
+    merge_ngram_runs(runs, write_ngram_run, output);
+    rewind(output);
+    g_ptr_array_free(runs, TRUE);
+
+    add_ngram_run(counter, output);
+}
+
+static void count_ngram_chunk(ngram_counter_t * counter,
+                              ngram_chunk_t * chunk){
+    HashofNgram hash_of_ngram = g_hash_table_new_full
+        (g_direct_hash, g_direct_equal,
+         NULL, (GDestroyNotify) g_hash_table_unref);
+
+    phrase_token_t last_token, cur_token = last_token = 0;
+    if (chunk->m_context) {
+        TAGLIB_PARSE_SEGMENTED_LINE(counter->m_phrase_index,
+                                    token, chunk->m_context);
+        cur_token = token;
+    }
+
+    for (size_t i = 0; i < chunk->m_lines->len; ++i) {
+        gchar * linebuf = (gchar *) g_ptr_array_index(chunk->m_lines, i);
+
+        TAGLIB_PARSE_SEGMENTED_LINE(counter->m_phrase_index, token, linebuf);
+
+        last_token = cur_token;
+        cur_token = token;
+
+        /* skip null_token in second word. */
+        if ( null_token == cur_token )
+            continue;
+
+        /* training uni-gram */
+        accumulate_ngram(hash_of_ngram, null_token, cur_token);
+
+        /* skip pi-gram training. */
+        if ( null_token == last_token ){
+            if ( !train_pi_gram )
+                continue;
+            last_token = sentence_start;
+        }
+
+        /* train bi-gram */
+        accumulate_ngram(hash_of_ngram, last_token, cur_token);
+    }
+
+    add_ngram_run(counter, spill_ngram_run(hash_of_ngram));
+    g_hash_table_destroy(hash_of_ngram);
+}
+
+static void count_ngram_chunk_thread(gpointer data, gpointer user_data){
+    ngram_chunk_t * chunk = (ngram_chunk_t *) data;
+    ngram_counter_t * counter = (ngram_counter_t *) user_data;
+
+    count_ngram_chunk(counter, chunk);
+    free_ngram_chunk(chunk);
+
+    g_mutex_lock(&counter->m_mutex);
+    --counter->m_pending;
+    g_cond_signal(&counter->m_cond);
+    g_mutex_unlock(&counter->m_mutex);
+}
+
+static void submit_ngram_chunk(ngram_counter_t * counter,
+                               GThreadPool * pool,
+                               ngram_chunk_t * chunk){
+    if (NULL == pool) {
+        count_ngram_chunk(counter, chunk);
+        free_ngram_chunk(chunk);
+        return;
+    }
+
+    g_mutex_lock(&counter->m_mutex);
+    while (counter->m_pending >= 2 * num_of_threads)
+        g_cond_wait(&counter->m_cond, &counter->m_mutex);
+    ++counter->m_pending;
+    g_mutex_unlock(&counter->m_mutex);
+
+    g_thread_pool_push(pool, chunk, NULL);
+}
+
+/* apply the merged counts to the phrase index and the bi-gram. */
+struct ngram_writer_t{
+    FacadePhraseIndex * m_phrase_index;
+    Bigram * m_bigram;
+
+    phrase_token_t m_prev;
+    SingleGram * m_single_gram;
+};
+
+static void flush_single_gram(ngram_writer_t * writer){
+    if (NULL == writer->m_single_gram)
+        return;
+
+    writer->m_bigram->store(writer->m_prev, writer->m_single_gram);
+    delete writer->m_single_gram;
+    writer->m_single_gram = NULL;
+}
+
+static void write_ngram_record(const ngram_record_t * record,
+                               gpointer user_data){
+    ngram_writer_t * writer = (ngram_writer_t *) user_data;
+
+    if (null_token == record->m_prev) {
+        writer->m_phrase_index->add_unigram_frequency
+            (record->m_cur, record->m_count);
+        return;
+    }
+
+    /* the records are sorted by the prev token. */
+    if (NULL == writer->m_single_gram ||
+        record->m_prev != writer->m_prev) {
+        flush_single_gram(writer);
+
+        writer->m_prev = record->m_prev;
+        writer->m_bigram->load(writer->m_prev, writer->m_single_gram);
+        if (NULL == writer->m_single_gram)
+            writer->m_single_gram = new SingleGram;
+    }
+
+    SingleGram * single_gram = writer->m_single_gram;
+    guint32 freq, total_freq;
+    /* increase freq */
+    if (single_gram->get_freq(record->m_cur, freq))
+        assert(single_gram->set_freq(record->m_cur, freq + record->m_count));
+    else
+        assert(single_gram->insert_freq(record->m_cur, record->m_count));
+    /* increase total freq */
+    single_gram->get_total_freq(total_freq);
+    single_gram->set_total_freq(total_freq + record->m_count);
+}
+
 int main(int argc, char * argv[]){
     FILE * input = stdin;
 
@@ -52,6 +397,11 @@ int main(int argc, char * argv[]){
         exit(EINVAL);
     }
 
+    if (num_of_threads < 1 || chunk_size < 1) {
+        fprintf(stderr, "invalid threads or chunk size.\n");
+        exit(EINVAL);
+    }
+
     SystemTableInfo2 system_table_info;
 
     bool retval = system_table_info.load(SYSTEM_TABLE_INFO);
@@ -71,8 +421,24 @@ int main(int argc, char * argv[]){
     Bigram bigram;
     bigram.attach(bigram_filename, ATTACH_CREATE|ATTACH_READWRITE);
 
+    /* the phrase index is only read when counting. */
+    ngram_counter_t counter;
+    counter.m_phrase_index = &phrase_index;
+    g_mutex_init(&counter.m_mutex);
+    g_cond_init(&counter.m_cond);
+    counter.m_pending = 0;
+    counter.m_runs = g_ptr_array_new();
+
+    GThreadPool * pool = NULL;
+    if (num_of_threads > 1)
+        pool = g_thread_pool_new(count_ngram_chunk_thread, &counter,
+                                 num_of_threads, TRUE, NULL);
+
+    ngram_chunk_t * chunk = new ngram_chunk_t;
+    chunk->m_context = NULL;
+    chunk->m_lines = g_ptr_array_new();
+
     char* linebuf = NULL; size_t size = 0;
-    phrase_token_t last_token, cur_token = last_token = 0;
     while( getline(&linebuf, &size, input) ){
 	if ( feof(input) )
 	    break;
@@ -81,48 +447,42 @@ int main(int argc, char * argv[]){
             linebuf[strlen(linebuf) - 1] = '\0';
         }
 
-        TAGLIB_PARSE_SEGMENTED_LINE(&phrase_index, token, linebuf);
+        g_ptr_array_add(chunk->m_lines, g_strdup(linebuf));
 
-	last_token = cur_token;
-	cur_token = token;
+        if (chunk->m_lines->len >= (guint) chunk_size) {
+            ngram_chunk_t * next = new ngram_chunk_t;
+            next->m_context = g_strdup(linebuf);
+            next->m_lines = g_ptr_array_new();
 
-        /* skip null_token in second word. */
-        if ( null_token == cur_token )
-            continue;
+            submit_ngram_chunk(&counter, pool, chunk);
+            chunk = next;
+        }
+    }
 
-        /* training uni-gram */
-        phrase_index.add_unigram_frequency(cur_token, 1);
+    free(linebuf);
 
-        /* skip pi-gram training. */
-        if ( null_token == last_token ){
-            if ( !train_pi_gram )
-                continue;
-            last_token = sentence_start;
-        }
+    if (chunk->m_lines->len)
+        submit_ngram_chunk(&counter, pool, chunk);
+    else
+        free_ngram_chunk(chunk);
 
-        /* train bi-gram */
-        SingleGram * single_gram = NULL;
-        bigram.load(last_token, single_gram);
+    /* wait for the queued chunks. */
+    if (pool)
+        g_thread_pool_free(pool, FALSE, TRUE);
 
-        if ( NULL == single_gram ){
-            single_gram = new SingleGram;
-        }
-        guint32 freq, total_freq;
-        /* increase freq */
-        if (single_gram->get_freq(cur_token, freq))
-            assert(single_gram->set_freq(cur_token, freq + 1));
-        else
-            assert(single_gram->insert_freq(cur_token, 1));
-        /* increase total freq */
-        single_gram->get_total_freq(total_freq);
-        single_gram->set_total_freq(total_freq + 1);
+    ngram_writer_t writer;
+    writer.m_phrase_index = &phrase_index;
+    writer.m_bigram = &bigram;
+    writer.m_prev = null_token;
+    writer.m_single_gram = NULL;
 
-        bigram.store(last_token, single_gram);
-        delete single_gram;
-    }
+    merge_ngram_runs(counter.m_runs, write_ngram_record, &writer);
+    flush_single_gram(&writer);
+
+    g_ptr_array_free(counter.m_runs, TRUE);
+    g_cond_clear(&counter.m_cond);
+    g_mutex_clear(&counter.m_mutex);
 
-    free(linebuf);
-    
     if (!save_phrase_index(phrase_files, &phrase_index))
         exit(ENOENT);
 